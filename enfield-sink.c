@@ -1,5 +1,6 @@
 #include "contiki.h"
 #include "groot-sink.h"
+#include "groot-trace.h"
 #include <stdio.h>
 #if CONTIKI_TARGET_ORISENPRIME
 	#include "button-sensors.h"
@@ -36,11 +37,25 @@ PROCESS_THREAD(enfield_sink, ev, data){
 	
 	sink_bootstrap(&sensor_support);
 
+#if DEBUG_LEVEL > 0
+	static struct etimer trace_timer;
+	etimer_set(&trace_timer, GROOT_TRACE_WRITE);
+#endif
 	SENSORS_ACTIVATE(button_sensor);
 	while(1){
 
-		PROCESS_WAIT_EVENT_UNTIL(ev == sensors_event &&
-									data == &button_sensor);
+		PROCESS_WAIT_EVENT();
+#if DEBUG_LEVEL > 0
+		//Write the trace out between events
+		if(ev == PROCESS_EVENT_TIMER && data == &trace_timer){
+			groot_trace_write();
+			etimer_reset(&trace_timer);
+			continue;
+		}
+#endif
+		if(ev != sensors_event || data != &button_sensor){
+			continue;
+		}
 		numb_clicks += 1;
 		if(numb_clicks == 2){
 			printf("UNSUBSCRIBE CLICK \n");
@@ -0,0 +1,780 @@
+/**
+ * @file
+ * 	GROOT aggregation kernels.
+ */
+
+#include "contiki.h"
+#include "groot-aggregate.h"
+#include "groot-digest.h"
+#include "groot-wire.h"
+#include "string.h"
+#include <stddef.h>
+
+#define AGG_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define AGG_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define AGG_SUM(a, b) ((a) + (b))
+
+struct GROOT_CHILD_SLOTS groot_child_slots;
+/*------------------------------------------------- Child Pool ----------------------------------------------------------*/
+void
+groot_child_pool_init(void){
+	uint8_t i;
+
+	for(i = 0; i < GROOT_CHILD_POOL; i++){
+		groot_child_slots.next[i] = (i + 1 < GROOT_CHILD_POOL) ? i + 1 : GROOT_NO_SLOT;
+	}
+	groot_child_slots.free = 0;
+	for(i = 0; i < GROOT_EXTRA_POOL; i++){
+		groot_child_slots.extra_next[i] = (i + 1 < GROOT_EXTRA_POOL) ? i + 1 : GROOT_NO_SLOT;
+	}
+	groot_child_slots.extra_free = 0;
+}
+
+uint8_t
+groot_child_alloc(void){
+	uint8_t slot = groot_child_slots.free;
+
+	if(slot == GROOT_NO_SLOT){
+		return GROOT_NO_SLOT;
+	}
+	groot_child_slots.free = groot_child_slots.next[slot];
+
+	groot_child_slots.last_set[slot] = 0;
+	groot_child_slots.count[slot] = 0;
+	groot_child_slots.extra[slot] = GROOT_NO_SLOT;
+	return slot;
+}
+
+void
+groot_child_free(uint8_t slot){
+	uint8_t extra = groot_child_slots.extra[slot];
+
+	if(extra != GROOT_NO_SLOT){
+		groot_child_slots.extra_next[extra] = groot_child_slots.extra_free;
+		groot_child_slots.extra_free = extra;
+	}
+	groot_child_slots.next[slot] = groot_child_slots.free;
+	groot_child_slots.free = slot;
+}
+
+uint8_t
+groot_child_extra(const struct GROOT_SRT_CHILDREN *children, uint8_t i){
+	uint8_t slot = children->slot[i], extra;
+
+	if(!GROOT_AGG_EXTRA(children->aggregator) || groot_child_slots.extra[slot] != GROOT_NO_SLOT){
+		return 1;
+	}
+
+	extra = groot_child_slots.extra_free;
+	if(extra == GROOT_NO_SLOT){
+		return 0;
+	}
+	groot_child_slots.extra_free = groot_child_slots.extra_next[extra];
+	groot_child_slots.extra[slot] = extra;
+	return 1;
+}
+/*------------------------------------------------- Kernel --------------------------------------------------------------*/
+/**
+ * @brief One pass over the children with op applied to every sensor
+ * @details Full blocks of GROOT_AGG_LANES children go into separate lane
+ *          accumulators, the remainder into lane 0, then the lanes are folded.
+ */
+#define AGG_KERNEL(op) \
+	for(i = 0; i + GROOT_AGG_LANES <= n; i += GROOT_AGG_LANES){ \
+		for(l = 0; l < GROOT_AGG_LANES; l++){ \
+			c = children->slot[i+l]; \
+			co2[l] = op(co2[l], pool->co2[c]); \
+			no[l] = op(no[l], pool->no[c]); \
+			temp[l] = op(temp[l], pool->temp[c]); \
+			humidity[l] = op(humidity[l], pool->humidity[c]); \
+		} \
+	} \
+	for(; i < n; i++){ \
+		c = children->slot[i]; \
+		co2[0] = op(co2[0], pool->co2[c]); \
+		no[0] = op(no[0], pool->no[c]); \
+		temp[0] = op(temp[0], pool->temp[c]); \
+		humidity[0] = op(humidity[0], pool->humidity[c]); \
+	} \
+	for(l = 1; l < GROOT_AGG_LANES; l++){ \
+		co2[0] = op(co2[0], co2[l]); \
+		no[0] = op(no[0], no[l]); \
+		temp[0] = op(temp[0], temp[l]); \
+		humidity[0] = op(humidity[0], humidity[l]); \
+	}
+
+void
+groot_aggregate(const struct GROOT_SRT_CHILDREN *children, const struct GROOT_SENSORS *required,
+	uint8_t aggregator, struct GROOT_SENSORS_DATA *result){
+	const struct GROOT_CHILD_SLOTS *pool = &groot_child_slots;
+	float co2[GROOT_AGG_LANES], no[GROOT_AGG_LANES], temp[GROOT_AGG_LANES], humidity[GROOT_AGG_LANES];
+	uint8_t n = children->present, i, l, c;
+
+	memset(result, 0, sizeof(struct GROOT_SENSORS_DATA));
+	if(n == 0){
+		return;
+	}
+
+	//MIN and MAX lanes start from the first child so no sentinel is needed
+	c = children->slot[0];
+	for(l = 0; l < GROOT_AGG_LANES; l++){
+		if(aggregator == GROOT_AVG){
+			co2[l] = no[l] = temp[l] = humidity[l] = 0;
+		} else {
+			co2[l] = pool->co2[c];
+			no[l] = pool->no[c];
+			temp[l] = pool->temp[c];
+			humidity[l] = pool->humidity[c];
+		}
+	}
+
+	switch(aggregator){
+		case GROOT_MAX:
+			AGG_KERNEL(AGG_MAX)
+			break;
+		case GROOT_MIN:
+			AGG_KERNEL(AGG_MIN)
+			break;
+		case GROOT_AVG:
+			AGG_KERNEL(AGG_SUM)
+			co2[0] /= n;
+			no[0] /= n;
+			temp[0] /= n;
+			humidity[0] /= n;
+			break;
+		default:
+			return;
+	}
+
+	if(required->co2 == 1){
+		result->co2 = co2[0];
+	}
+	if(required->no == 1){
+		result->no = no[0];
+	}
+	if(required->temp == 1){
+		result->temp = temp[0];
+	}
+	if(required->humidity == 1){
+		result->humidity = humidity[0];
+	}
+}
+/*------------------------------------------------- Partial States -----------------------------------------------------*/
+/**
+ * Fields an aggregator carries per required sensor on the wire
+ */
+#define AGG_WIRE_VALUE 0x01
+#define AGG_WIRE_M2 0x02
+#define AGG_WIRE_HISTOGRAM 0x04
+#define AGG_WIRE_DIGEST 0x08 //Once for all sensors. Node count then the nodes
+
+#define AGG_SENSORS 4
+#define AGG_DATA(data, s) (*(float *)((uint8_t *)(data) + agg_data_offset[s]))
+#define AGG_REQUIRED(required, s) (*((const uint8_t *)(required) + agg_required_offset[s]))
+
+/**
+ * Bytes of the largest partial state on the wire: the count, then a full digest,
+ * every histogram bucket or a value and m2 of every sensor. Floats are 4 bytes
+ */
+#define AGG_PARTIAL_MAX (2 + AGG_MAX(1 + GROOT_QUANTILE_NODES*GROOT_DIGEST_NODE_BYTES, \
+	AGG_MAX(AGG_SENSORS*GROOT_HISTOGRAM_BUCKETS*2, AGG_SENSORS*2*4)))
+
+//Sizes are counted in a byte, and a batch record with its state fits one frame
+#if AGG_PARTIAL_MAX > 0xFF || GROOT_WIRE_HDR_MAX + GROOT_WIRE_REC_MAX + AGG_PARTIAL_MAX > PACKETBUF_SIZE
+	#error "GROOT_QUANTILE_NODES or GROOT_HISTOGRAM_BUCKETS make a partial state too large for a frame"
+#endif
+
+static const uint8_t agg_data_offset[AGG_SENSORS] = {
+	offsetof(struct GROOT_SENSORS_DATA, co2), offsetof(struct GROOT_SENSORS_DATA, no),
+	offsetof(struct GROOT_SENSORS_DATA, temp), offsetof(struct GROOT_SENSORS_DATA, humidity)
+};
+static const uint8_t agg_required_offset[AGG_SENSORS] = {
+	offsetof(struct GROOT_SENSORS, co2), offsetof(struct GROOT_SENSORS, no),
+	offsetof(struct GROOT_SENSORS, temp), offsetof(struct GROOT_SENSORS, humidity)
+};
+
+/**
+ * @brief Operations of an aggregator on one sensor of a partial state
+ * @details merge runs before the counts are added. NULL merge leaves the value alone.
+ */
+struct AGG_OPS{
+	void (*init)(struct GROOT_PARTIAL *p, uint8_t s, float reading);
+	void (*merge)(struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *p, uint8_t s);
+	float (*finalize)(const struct GROOT_PARTIAL *p, uint8_t s);
+	uint8_t wire;
+};
+
+static uint8_t
+histogram_bucket(float reading){
+	int b = (reading - GROOT_HISTOGRAM_LOW) * GROOT_HISTOGRAM_BUCKETS / (GROOT_HISTOGRAM_HIGH - GROOT_HISTOGRAM_LOW);
+
+	if(b < 0){
+		return 0;
+	}
+	return (b >= GROOT_HISTOGRAM_BUCKETS) ? GROOT_HISTOGRAM_BUCKETS - 1 : b;
+}
+
+static void
+init_value(struct GROOT_PARTIAL *p, uint8_t s, float reading){
+	AGG_DATA(&p->value, s) = reading;
+}
+
+static void
+init_variance(struct GROOT_PARTIAL *p, uint8_t s, float reading){
+	AGG_DATA(&p->value, s) = reading;
+	AGG_DATA(&p->extra.m2, s) = 0;
+}
+
+static void
+init_histogram(struct GROOT_PARTIAL *p, uint8_t s, float reading){
+	p->extra.histogram[s][histogram_bucket(reading)] = 1;
+}
+
+static void
+init_quantile(struct GROOT_PARTIAL *p, uint8_t s, float reading){
+	groot_digest_add(&p->extra.digest, s, reading, 1);
+}
+
+static void
+merge_max(struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *p, uint8_t s){
+	AGG_DATA(&into->value, s) = AGG_MAX(AGG_DATA(&into->value, s), AGG_DATA(&p->value, s));
+}
+
+static void
+merge_min(struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *p, uint8_t s){
+	AGG_DATA(&into->value, s) = AGG_MIN(AGG_DATA(&into->value, s), AGG_DATA(&p->value, s));
+}
+
+static void
+merge_sum(struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *p, uint8_t s){
+	AGG_DATA(&into->value, s) += AGG_DATA(&p->value, s);
+}
+
+/**
+ * @brief Pairwise update of the mean and squared differences (Chan et al.)
+ */
+static void
+merge_variance(struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *p, uint8_t s){
+	float n = (float)into->count + p->count;
+	float delta = AGG_DATA(&p->value, s) - AGG_DATA(&into->value, s);
+
+	AGG_DATA(&into->value, s) += delta * p->count / n;
+	AGG_DATA(&into->extra.m2, s) += AGG_DATA(&p->extra.m2, s) + delta * delta * into->count * p->count / n;
+}
+
+static void
+merge_histogram(struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *p, uint8_t s){
+	uint8_t b;
+
+	for(b = 0; b < GROOT_HISTOGRAM_BUCKETS; b++){
+		into->extra.histogram[s][b] += p->extra.histogram[s][b];
+	}
+}
+
+static void
+merge_quantile(struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *p, uint8_t s){
+	groot_digest_merge(&into->extra.digest, &p->extra.digest, s, into->count + p->count);
+}
+
+static float
+finalize_value(const struct GROOT_PARTIAL *p, uint8_t s){
+	return AGG_DATA(&p->value, s);
+}
+
+static float
+finalize_avg(const struct GROOT_PARTIAL *p, uint8_t s){
+	return AGG_DATA(&p->value, s) / p->count;
+}
+
+static float
+finalize_count(const struct GROOT_PARTIAL *p, uint8_t s){
+	return p->count;
+}
+
+static float
+finalize_variance(const struct GROOT_PARTIAL *p, uint8_t s){
+	return AGG_DATA(&p->extra.m2, s) / p->count;
+}
+
+/**
+ * @brief Mean of the readings taken at the middle of their buckets
+ */
+static float
+finalize_histogram(const struct GROOT_PARTIAL *p, uint8_t s){
+	float width = (float)(GROOT_HISTOGRAM_HIGH - GROOT_HISTOGRAM_LOW) / GROOT_HISTOGRAM_BUCKETS, sum = 0;
+	uint8_t b;
+
+	for(b = 0; b < GROOT_HISTOGRAM_BUCKETS; b++){
+		sum += p->extra.histogram[s][b] * (GROOT_HISTOGRAM_LOW + (b + 0.5f) * width);
+	}
+	return sum / p->count;
+}
+
+static float
+finalize_quantile(const struct GROOT_PARTIAL *p, uint8_t s){
+	return groot_digest_quantile(&p->extra.digest, s, 50);
+}
+
+//Indexed by aggregator
+static const struct AGG_OPS agg_ops[] = {
+	{init_value, NULL, finalize_value, AGG_WIRE_VALUE}, //GROOT_NO_AGGREGATION. Never merged
+	{init_value, merge_max, finalize_value, AGG_WIRE_VALUE}, //GROOT_MAX
+	{init_value, merge_sum, finalize_avg, AGG_WIRE_VALUE}, //GROOT_AVG
+	{init_value, merge_min, finalize_value, AGG_WIRE_VALUE}, //GROOT_MIN
+	{init_value, merge_sum, finalize_value, AGG_WIRE_VALUE}, //GROOT_SUM
+	{NULL, NULL, finalize_count, 0}, //GROOT_COUNT
+	{init_variance, merge_variance, finalize_variance, AGG_WIRE_VALUE | AGG_WIRE_M2}, //GROOT_VARIANCE
+	{init_histogram, merge_histogram, finalize_histogram, AGG_WIRE_HISTOGRAM}, //GROOT_HISTOGRAM
+	{init_quantile, merge_quantile, finalize_quantile, AGG_WIRE_DIGEST} //GROOT_QUANTILE
+};
+
+#define AGG_KNOWN(aggregator) ((aggregator) < sizeof(agg_ops)/sizeof(agg_ops[0]))
+
+/**
+ * @brief Clear the sensors a query does not require
+ * @details Only the fields the aggregator uses. The extra fields share memory.
+ */
+static void
+partial_mask(uint8_t aggregator, const struct GROOT_SENSORS *required, struct GROOT_PARTIAL *partial){
+	uint8_t s;
+
+	for(s = 0; s < AGG_SENSORS; s++){
+		if(AGG_REQUIRED(required, s) == 1){
+			continue;
+		}
+		AGG_DATA(&partial->value, s) = 0;
+		if(aggregator == GROOT_VARIANCE){
+			AGG_DATA(&partial->extra.m2, s) = 0;
+		} else if(aggregator == GROOT_HISTOGRAM){
+			memset(partial->extra.histogram[s], 0, sizeof(partial->extra.histogram[s]));
+		} else if(aggregator == GROOT_QUANTILE){
+			groot_digest_drop(&partial->extra.digest, s);
+		}
+	}
+}
+
+void
+groot_partial_init(const struct GROOT_QUERY *qry, const struct GROOT_SENSORS_DATA *reading, struct GROOT_PARTIAL *partial){
+	uint8_t aggregator = qry->aggregator, s;
+
+	memset(partial, 0, sizeof(struct GROOT_PARTIAL));
+	if(!AGG_KNOWN(aggregator)){
+		return;
+	}
+
+	partial->count = 1;
+	if(aggregator == GROOT_QUANTILE){
+		partial->extra.digest.error = qry->error;
+		partial->extra.digest.low = qry->low;
+		partial->extra.digest.high = qry->high;
+	}
+	for(s = 0; s < AGG_SENSORS; s++){
+		if(AGG_REQUIRED(&qry->sensors_required, s) == 1 && agg_ops[aggregator].init != NULL){
+			agg_ops[aggregator].init(partial, s, AGG_DATA(reading, s));
+		}
+	}
+}
+
+void
+groot_partial_merge(uint8_t aggregator, struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *partial){
+	uint8_t s;
+
+	if(!AGG_KNOWN(aggregator) || partial->count == 0){
+		return;
+	}
+	//An empty state takes the other as it is, so MIN and MAX need no sentinel
+	if(into->count == 0){
+		memcpy(into, partial, sizeof(struct GROOT_PARTIAL));
+		return;
+	}
+
+	if(agg_ops[aggregator].merge != NULL){
+		for(s = 0; s < AGG_SENSORS; s++){
+			agg_ops[aggregator].merge(into, partial, s);
+		}
+	}
+	into->count += partial->count;
+}
+
+void
+groot_partial_finalize(uint8_t aggregator, const struct GROOT_PARTIAL *partial, struct GROOT_SENSORS_DATA *result){
+	uint8_t s;
+
+	memset(result, 0, sizeof(struct GROOT_SENSORS_DATA));
+	if(!AGG_KNOWN(aggregator) || partial->count == 0){
+		return;
+	}
+
+	for(s = 0; s < AGG_SENSORS; s++){
+		AGG_DATA(result, s) = agg_ops[aggregator].finalize(partial, s);
+	}
+}
+
+void
+groot_partial_quantile(const struct GROOT_PARTIAL *partial, uint8_t percent, struct GROOT_SENSORS_DATA *result){
+	uint8_t s;
+
+	for(s = 0; s < AGG_SENSORS; s++){
+		AGG_DATA(result, s) = groot_digest_quantile(&partial->extra.digest, s, percent);
+	}
+}
+
+/**
+ * @brief Bytes on the wire of a partial state with nodes digest nodes
+ */
+static uint8_t
+partial_size(uint8_t aggregator, const struct GROOT_SENSORS *required, uint8_t nodes){
+	uint8_t wire, s, size = sizeof(uint16_t);
+
+	if(!AGG_KNOWN(aggregator)){
+		return size;
+	}
+
+	wire = agg_ops[aggregator].wire;
+	if(wire & AGG_WIRE_DIGEST){
+		size += 1 + nodes*GROOT_DIGEST_NODE_BYTES;
+	}
+	for(s = 0; s < AGG_SENSORS; s++){
+		if(AGG_REQUIRED(required, s) != 1){
+			continue;
+		}
+		if(wire & AGG_WIRE_VALUE){
+			size += sizeof(float);
+		}
+		if(wire & AGG_WIRE_M2){
+			size += sizeof(float);
+		}
+		if(wire & AGG_WIRE_HISTOGRAM){
+			size += GROOT_HISTOGRAM_BUCKETS*sizeof(uint16_t);
+		}
+	}
+	return size;
+}
+
+/**
+ * @brief Copy a byte to or from the buffer and move past it
+ */
+static uint8_t
+*wire_u8(uint8_t *buf, uint8_t *field, uint8_t to_buf){
+	if(to_buf){
+		buf[0] = *field;
+	} else {
+		*field = buf[0];
+	}
+	return buf + 1;
+}
+
+/**
+ * @brief Copy a 16-bit field to or from the buffer, little endian, and move past it
+ */
+static uint8_t
+*wire_u16(uint8_t *buf, uint16_t *field, uint8_t to_buf){
+	if(to_buf){
+		GROOT_WIRE_PUT_U16(buf, 0, *field);
+	} else {
+		*field = GROOT_WIRE_U16(buf, 0);
+	}
+	return buf + sizeof(uint16_t);
+}
+
+/**
+ * @brief Copy a float to or from the buffer and move past it
+ */
+static uint8_t
+*wire_float(uint8_t *buf, float *field, uint8_t to_buf){
+	if(to_buf){
+		groot_wire_put_float(buf, *field);
+	} else {
+		*field = groot_wire_float(buf);
+	}
+	return buf + sizeof(float);
+}
+
+uint8_t
+groot_partial_size(const struct GROOT_QUERY *qry, const struct GROOT_PARTIAL *partial){
+	return partial_size(qry->aggregator, &qry->sensors_required, partial->extra.digest.length);
+}
+
+/**
+ * @brief Copy the wire fields of a partial state to or from a buffer
+ * @details The count, the digest nodes, then the fields of the aggregator for every
+ *          required sensor
+ */
+static void
+partial_wire(uint8_t aggregator, const struct GROOT_SENSORS *required, struct GROOT_PARTIAL *partial,
+	uint8_t *buf, uint8_t to_buf){
+	uint8_t wire = AGG_KNOWN(aggregator) ? agg_ops[aggregator].wire : 0, s, b;
+	struct GROOT_DIGEST *digest = &partial->extra.digest;
+
+	buf = wire_u16(buf, &partial->count, to_buf);
+	if(wire & AGG_WIRE_DIGEST){
+		buf = wire_u8(buf, &digest->length, to_buf);
+		for(s = 0; s < digest->length; s++){
+			buf = wire_u8(buf, &digest->key[s], to_buf);
+			buf = wire_u16(buf, &digest->count[s], to_buf);
+		}
+	}
+	for(s = 0; s < AGG_SENSORS; s++){
+		if(AGG_REQUIRED(required, s) != 1){
+			continue;
+		}
+		if(wire & AGG_WIRE_VALUE){
+			buf = wire_float(buf, &AGG_DATA(&partial->value, s), to_buf);
+		}
+		if(wire & AGG_WIRE_M2){
+			buf = wire_float(buf, &AGG_DATA(&partial->extra.m2, s), to_buf);
+		}
+		if(wire & AGG_WIRE_HISTOGRAM){
+			for(b = 0; b < GROOT_HISTOGRAM_BUCKETS; b++){
+				buf = wire_u16(buf, &partial->extra.histogram[s][b], to_buf);
+			}
+		}
+	}
+}
+
+uint8_t
+groot_partial_pack(const struct GROOT_QUERY *qry, const struct GROOT_PARTIAL *partial, uint8_t *buf){
+	partial_wire(qry->aggregator, &qry->sensors_required, (struct GROOT_PARTIAL *)partial, buf, 1);
+	return groot_partial_size(qry, partial);
+}
+
+uint8_t
+groot_partial_unpack(const struct GROOT_QUERY *qry, const uint8_t *buf, uint16_t len, struct GROOT_PARTIAL *partial){
+	uint8_t nodes = 0, size;
+
+	memset(partial, 0, sizeof(struct GROOT_PARTIAL));
+	if(qry->aggregator == GROOT_QUANTILE){
+		//Node count follows the readings count
+		if(len <= sizeof(uint16_t)){
+			return 0;
+		}
+		nodes = buf[sizeof(uint16_t)];
+		if(nodes > GROOT_QUANTILE_NODES){
+			return 0;
+		}
+		partial->extra.digest.error = qry->error;
+		partial->extra.digest.low = qry->low;
+		partial->extra.digest.high = qry->high;
+	}
+
+	size = partial_size(qry->aggregator, &qry->sensors_required, nodes);
+	if(len < size){
+		return 0;
+	}
+	partial_wire(qry->aggregator, &qry->sensors_required, partial, (uint8_t *)buf, 0);
+	//A bad key would index past the digest's buckets
+	if(qry->aggregator == GROOT_QUANTILE && !groot_digest_valid(&partial->extra.digest)){
+		return 0;
+	}
+	return size;
+}
+
+void
+groot_child_partial(const struct GROOT_SRT_CHILDREN *children, uint8_t i, struct GROOT_PARTIAL *partial){
+	uint8_t slot = children->slot[i], extra = groot_child_slots.extra[slot];
+
+	partial->count = groot_child_slots.count[slot];
+	partial->value.co2 = groot_child_slots.co2[slot];
+	partial->value.no = groot_child_slots.no[slot];
+	partial->value.temp = groot_child_slots.temp[slot];
+	partial->value.humidity = groot_child_slots.humidity[slot];
+	if(extra != GROOT_NO_SLOT){
+		memcpy(&partial->extra, &groot_child_slots.extras[extra], sizeof(union GROOT_PARTIAL_EXTRA));
+	} else {
+		memset(&partial->extra, 0, sizeof(union GROOT_PARTIAL_EXTRA));
+	}
+}
+
+void
+groot_child_set(const struct GROOT_SRT_CHILDREN *children, uint8_t i, const struct GROOT_PARTIAL *partial){
+	uint8_t slot = children->slot[i], extra = groot_child_slots.extra[slot];
+
+	groot_child_slots.count[slot] = partial->count;
+	groot_child_slots.co2[slot] = partial->value.co2;
+	groot_child_slots.no[slot] = partial->value.no;
+	groot_child_slots.temp[slot] = partial->value.temp;
+	groot_child_slots.humidity[slot] = partial->value.humidity;
+	if(extra != GROOT_NO_SLOT){
+		memcpy(&groot_child_slots.extras[extra], &partial->extra, sizeof(union GROOT_PARTIAL_EXTRA));
+	}
+}
+/*------------------------------------------------- Running Aggregates --------------------------------------------------*/
+/**
+ * @brief Add a value of one sensor to its running value
+ */
+static void
+running_add(uint8_t aggregator, float *running, float value){
+	switch(aggregator){
+		case GROOT_SUM:
+		case GROOT_AVG:
+			*running += value;
+			break;
+		case GROOT_MIN:
+			if(value < *running){
+				*running = value;
+			}
+			break;
+		case GROOT_MAX:
+			if(value > *running){
+				*running = value;
+			}
+			break;
+	}
+}
+
+/**
+ * @brief Replace a value of one sensor in its running value
+ * @details A min or max that is replaced by a worse value is only known to be
+ *          wrong, so the sensor is marked stale and rescanned when needed.
+ */
+static void
+running_set(uint8_t aggregator, float *running, uint8_t *stale, uint8_t sensor, float old, float value){
+	switch(aggregator){
+		case GROOT_SUM:
+		case GROOT_AVG:
+			*running += value - old;
+			break;
+		case GROOT_MIN:
+			if(value <= *running){
+				*running = value;
+			} else if(old == *running){
+				*stale |= sensor;
+			}
+			break;
+		case GROOT_MAX:
+			if(value >= *running){
+				*running = value;
+			} else if(old == *running){
+				*stale |= sensor;
+			}
+			break;
+	}
+}
+
+/**
+ * @brief Retract a value of one sensor from its running value
+ */
+static void
+running_rm(uint8_t aggregator, float *running, uint8_t *stale, uint8_t sensor, float old){
+	switch(aggregator){
+		case GROOT_SUM:
+		case GROOT_AVG:
+			*running -= old;
+			break;
+		case GROOT_MIN:
+		case GROOT_MAX:
+			if(old == *running){
+				*stale |= sensor;
+			}
+			break;
+	}
+}
+
+void
+groot_running_add(struct GROOT_SRT_CHILDREN *children, uint8_t i){
+	uint8_t a = children->aggregator, c = children->slot[i];
+
+	//First child starts the running value
+	if(children->present == 1){
+		groot_running_rebuild(children);
+		return;
+	}
+
+	children->total += groot_child_slots.count[c];
+	running_add(a, &children->running.co2, groot_child_slots.co2[c]);
+	running_add(a, &children->running.no, groot_child_slots.no[c]);
+	running_add(a, &children->running.temp, groot_child_slots.temp[c]);
+	running_add(a, &children->running.humidity, groot_child_slots.humidity[c]);
+}
+
+void
+groot_running_set(struct GROOT_SRT_CHILDREN *children, uint8_t i, const struct GROOT_PARTIAL *partial){
+	const struct GROOT_SENSORS_DATA *data = &partial->value;
+	uint8_t a = children->aggregator, c = children->slot[i];
+
+	children->total += partial->count - groot_child_slots.count[c];
+	running_set(a, &children->running.co2, &children->stale, GROOT_AGG_CO2, groot_child_slots.co2[c], data->co2);
+	running_set(a, &children->running.no, &children->stale, GROOT_AGG_NO, groot_child_slots.no[c], data->no);
+	running_set(a, &children->running.temp, &children->stale, GROOT_AGG_TEMP, groot_child_slots.temp[c], data->temp);
+	running_set(a, &children->running.humidity, &children->stale, GROOT_AGG_HUMIDITY,
+		groot_child_slots.humidity[c], data->humidity);
+	children->updates += 1;
+}
+
+void
+groot_running_rm(struct GROOT_SRT_CHILDREN *children, uint8_t i){
+	uint8_t a = children->aggregator, c = children->slot[i];
+
+	children->total -= groot_child_slots.count[c];
+	running_rm(a, &children->running.co2, &children->stale, GROOT_AGG_CO2, groot_child_slots.co2[c]);
+	running_rm(a, &children->running.no, &children->stale, GROOT_AGG_NO, groot_child_slots.no[c]);
+	running_rm(a, &children->running.temp, &children->stale, GROOT_AGG_TEMP, groot_child_slots.temp[c]);
+	running_rm(a, &children->running.humidity, &children->stale, GROOT_AGG_HUMIDITY, groot_child_slots.humidity[c]);
+	children->updates += 1;
+}
+
+void
+groot_running_rebuild(struct GROOT_SRT_CHILDREN *children){
+	static const struct GROOT_SENSORS all = {1, 1, 1, 1};
+	uint8_t i, c;
+
+	memset(&children->running, 0, sizeof(struct GROOT_SENSORS_DATA));
+	children->total = 0;
+	for(i = 0; i < children->present; i++){
+		c = children->slot[i];
+		children->total += groot_child_slots.count[c];
+		if(children->aggregator == GROOT_SUM || children->aggregator == GROOT_AVG){
+			children->running.co2 += groot_child_slots.co2[c];
+			children->running.no += groot_child_slots.no[c];
+			children->running.temp += groot_child_slots.temp[c];
+			children->running.humidity += groot_child_slots.humidity[c];
+		}
+	}
+	if(children->aggregator == GROOT_MIN || children->aggregator == GROOT_MAX){
+		groot_aggregate(children, &all, children->aggregator, &children->running);
+	}
+
+	children->stale = 0;
+	children->updates = 0;
+}
+
+void
+groot_running_result(struct GROOT_SRT_CHILDREN *children, const struct GROOT_QUERY *qry, struct GROOT_PARTIAL *result){
+	const struct GROOT_SENSORS *required = &qry->sensors_required;
+	uint8_t aggregator = qry->aggregator, i;
+	struct GROOT_PARTIAL child;
+
+	memset(result, 0, sizeof(struct GROOT_PARTIAL));
+	if(children->present == 0){
+		return;
+	}
+
+	if(children->updates >= GROOT_AGG_REBUILD ||
+		(children->stale != 0 && (aggregator == GROOT_MIN || aggregator == GROOT_MAX))){
+		groot_running_rebuild(children);
+	}
+
+	switch(aggregator){
+		case GROOT_MAX:
+		case GROOT_MIN:
+		case GROOT_SUM:
+		case GROOT_AVG:
+			result->value = children->running;
+			break;
+		case GROOT_COUNT:
+			break;
+		case GROOT_VARIANCE:
+		case GROOT_HISTOGRAM:
+		case GROOT_QUANTILE:
+			//Nothing running to read. Merge the children's states
+			for(i = 0; i < children->present; i++){
+				groot_child_partial(children, i, &child);
+				groot_partial_merge(aggregator, result, &child);
+			}
+			break;
+		default:
+			return;
+	}
+	result->count = children->total;
+	partial_mask(aggregator, required, result);
+}
@@ -0,0 +1,263 @@
+/**
+ * @file
+ * 	Header file for GROOT aggregation kernels.
+ */
+#ifndef __GROOT_AGGREGATE_H__
+#define __GROOT_AGGREGATE_H__
+
+#include "groot.h"
+
+/**
+ * @brief Independent accumulators per sensor in the aggregation kernel
+ * @details The four sensors already give four independent chains, which is best
+ *          for small tables. Large tables get extra lanes so host compilers can
+ *          vectorize across children. The order of the float operations is fixed,
+ *          so results do not depend on the compiler.
+ */
+#ifndef GROOT_AGG_LANES
+	#if GROOT_CHILD_LIMIT >= 16
+		#define GROOT_AGG_LANES 4
+	#else
+		#define GROOT_AGG_LANES 1
+	#endif
+#endif
+
+/**
+ * @brief Updates after which the running aggregates are rebuilt from the children
+ * @details Bounds the float error the running sums pick up from retractions
+ */
+#ifndef GROOT_AGG_REBUILD
+	#define GROOT_AGG_REBUILD 128
+#endif
+
+/**
+ * Running Aggregate Sensors
+ */
+#define GROOT_AGG_CO2 0x01
+#define GROOT_AGG_NO 0x02
+#define GROOT_AGG_TEMP 0x04
+#define GROOT_AGG_HUMIDITY 0x08
+
+/**
+ * @brief Aggregators whose children keep a GROOT_PARTIAL_EXTRA
+ */
+#define GROOT_AGG_EXTRA(aggregator) ((aggregator) == GROOT_VARIANCE || (aggregator) == GROOT_HISTOGRAM || \
+	(aggregator) == GROOT_QUANTILE)
+
+/**
+ * @brief Children of every query of the node
+ */
+extern struct GROOT_CHILD_SLOTS groot_child_slots;
+
+/**
+ * @brief Chain every slot of the child pool as free
+ */
+void
+groot_child_pool_init(void);
+
+/**
+ * @brief Take a slot of the child pool
+ * @details The child has no state and no extra
+ * 
+ * @return slot or GROOT_NO_SLOT if the pool is full
+ */
+uint8_t
+groot_child_alloc(void);
+
+/**
+ * @brief Give a slot back to the child pool
+ * @details Its extra goes back too
+ * 
+ * @param slot Slot of the child
+ */
+void
+groot_child_free(uint8_t slot);
+
+/**
+ * @brief Make sure a child can hold a state of the query's aggregator
+ * @details Takes an extra for the child when the aggregator needs one
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param i Index of the child
+ * @return 1 the state fits 0 no extra is left
+ */
+uint8_t
+groot_child_extra(const struct GROOT_SRT_CHILDREN *children, uint8_t i);
+
+/**
+ * @brief Aggregate all sensors of the children in one pass
+ * @details Computes GROOT_MAX, GROOT_MIN or GROOT_AVG for every sensor in a single
+ *          pass over the values of the children that reported, in full float
+ *          precision. Sensors that are not required are set to 0.
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param GROOT_SENSORS Sensors required by the query
+ * @param aggregator Aggregation type
+ * @param GROOT_SENSORS_DATA Where the result is stored
+ */
+void
+groot_aggregate(const struct GROOT_SRT_CHILDREN *children, const struct GROOT_SENSORS *required,
+	uint8_t aggregator, struct GROOT_SENSORS_DATA *result);
+
+/**
+ * @brief Start a partial state from one reading
+ * @details Start a partial state from one reading of the sensors the query requires
+ * 
+ * @param GROOT_QUERY Query
+ * @param GROOT_SENSORS_DATA Reading
+ * @param GROOT_PARTIAL Where the state is stored
+ */
+void
+groot_partial_init(const struct GROOT_QUERY *qry, const struct GROOT_SENSORS_DATA *reading, struct GROOT_PARTIAL *partial);
+
+/**
+ * @brief Merge a partial state into another
+ * @details Merging is associative, so states can be merged in any order up the tree
+ * 
+ * @param aggregator Aggregation type
+ * @param GROOT_PARTIAL State merged into
+ * @param GROOT_PARTIAL State to merge
+ */
+void
+groot_partial_merge(uint8_t aggregator, struct GROOT_PARTIAL *into, const struct GROOT_PARTIAL *partial);
+
+/**
+ * @brief Get the result of a partial state
+ * @details GROOT_AVG divides the sum by the count, GROOT_COUNT gives the count for every
+ *          sensor, GROOT_VARIANCE the population variance, GROOT_HISTOGRAM the mean of
+ *          the bucket middles and GROOT_QUANTILE the median. The buckets and digest
+ *          themselves are in the state.
+ * 
+ * @param aggregator Aggregation type
+ * @param GROOT_PARTIAL State
+ * @param GROOT_SENSORS_DATA Where the result is stored
+ */
+void
+groot_partial_finalize(uint8_t aggregator, const struct GROOT_PARTIAL *partial, struct GROOT_SENSORS_DATA *result);
+
+/**
+ * @brief Get a quantile of a GROOT_QUANTILE partial state
+ * @details Any quantile can be read from the same digest, within the query's rank error
+ * 
+ * @param GROOT_PARTIAL State
+ * @param percent Quantile in percent. 50 is the median
+ * @param GROOT_SENSORS_DATA Where the result is stored
+ */
+void
+groot_partial_quantile(const struct GROOT_PARTIAL *partial, uint8_t percent, struct GROOT_SENSORS_DATA *result);
+
+/**
+ * @brief Bytes of a partial state on the wire
+ * @details Only the fields the aggregator uses of the required sensors are sent,
+ *          and the digest nodes in use. The build stops when the largest state
+ *          does not fit a byte and a frame with its batch record
+ * 
+ * @param GROOT_QUERY Query of the state
+ * @param GROOT_PARTIAL State
+ * @return bytes
+ */
+uint8_t
+groot_partial_size(const struct GROOT_QUERY *qry, const struct GROOT_PARTIAL *partial);
+
+/**
+ * @brief Write a partial state to a packet
+ * @details Write a partial state to a packet
+ * 
+ * @param GROOT_QUERY Query of the state
+ * @param GROOT_PARTIAL State to write
+ * @param buf Where it is written. Needs groot_partial_size() bytes
+ * @return bytes written
+ */
+uint8_t
+groot_partial_pack(const struct GROOT_QUERY *qry, const struct GROOT_PARTIAL *partial, uint8_t *buf);
+
+/**
+ * @brief Read a partial state from a packet
+ * @details Read a partial state from a packet
+ * 
+ * @param GROOT_QUERY Query of the state
+ * @param buf Where it is read from
+ * @param len Bytes left in the packet
+ * @param GROOT_PARTIAL Where the state is stored
+ * @return bytes read or 0 if the packet is too short or its digest nodes are not valid
+ */
+uint8_t
+groot_partial_unpack(const struct GROOT_QUERY *qry, const uint8_t *buf, uint16_t len, struct GROOT_PARTIAL *partial);
+
+/**
+ * @brief Get the partial state a child reported
+ * @details Get the partial state a child reported
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param i Index of the child
+ * @param GROOT_PARTIAL Where the state is stored
+ */
+void
+groot_child_partial(const struct GROOT_SRT_CHILDREN *children, uint8_t i, struct GROOT_PARTIAL *partial);
+
+/**
+ * @brief Store the partial state a child reported
+ * @details The child must have passed groot_child_extra()
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param i Index of the child
+ * @param GROOT_PARTIAL State
+ */
+void
+groot_child_set(const struct GROOT_SRT_CHILDREN *children, uint8_t i, const struct GROOT_PARTIAL *partial);
+
+/**
+ * @brief Account for a child that reported for the first time
+ * @details Call after the child's state is stored at index present - 1
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param i Index of the new child
+ */
+void
+groot_running_add(struct GROOT_SRT_CHILDREN *children, uint8_t i);
+
+/**
+ * @brief Account for a new state of a child
+ * @details Call before the state at index i is overwritten
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param i Index of the child
+ * @param GROOT_PARTIAL New state
+ */
+void
+groot_running_set(struct GROOT_SRT_CHILDREN *children, uint8_t i, const struct GROOT_PARTIAL *partial);
+
+/**
+ * @brief Retract a child that is removed from the table
+ * @details Call before a child that reported is removed from index i
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param i Index of the child
+ */
+void
+groot_running_rm(struct GROOT_SRT_CHILDREN *children, uint8_t i);
+
+/**
+ * @brief Recompute the running value of the children's aggregator from the children
+ * @details Also call when the aggregator changed
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ */
+void
+groot_running_rebuild(struct GROOT_SRT_CHILDREN *children);
+
+/**
+ * @brief Get the partial state of the children from the running value
+ * @details The merge of every child's state. Only rescans the children when a
+ *          retracted value was the min or max, after GROOT_AGG_REBUILD updates, or
+ *          for GROOT_VARIANCE, GROOT_HISTOGRAM and GROOT_QUANTILE which have nothing
+ *          running.
+ * 
+ * @param GROOT_SRT_CHILDREN Children of the query
+ * @param GROOT_QUERY Query
+ * @param GROOT_PARTIAL Where the state is stored
+ */
+void
+groot_running_result(struct GROOT_SRT_CHILDREN *children, const struct GROOT_QUERY *qry, struct GROOT_PARTIAL *result);
+
+#endif /* __GROOT_AGGREGATE_H__ */
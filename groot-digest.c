@@ -0,0 +1,243 @@
+/**
+ * @file
+ * 	GROOT quantile digest (q-digest, Shrivastava et al.) over the query's range.
+ * @details
+ * 	A node at level l of the tree covers 2^(GROOT_QUANTILE_BITS-l) buckets. A family,
+ * 	two siblings and their parent, with no more than error*n/GROOT_QUANTILE_BITS
+ * 	readings is folded into the parent, so a quantile is off by at most error*n
+ * 	in rank. Families are folded further when the nodes do not fit.
+ */
+
+#include "groot-digest.h"
+#include "string.h"
+
+#define DIGEST_LEAVES (1 << GROOT_QUANTILE_BITS)
+#define DIGEST_KEY(sensor, id) (((sensor) << 6) | (id))
+#define DIGEST_SENSOR(key) ((key) >> 6)
+#define DIGEST_ID(key) ((key) & 0x3F)
+#define DIGEST_ALL 0xFFFFFFFFUL
+/*------------------------------------------------- Nodes ---------------------------------------------------------------*/
+static int
+digest_find(const struct GROOT_DIGEST *digest, uint8_t key){
+	uint8_t i;
+
+	for(i = 0; i < digest->length; i++){
+		if(digest->key[i] == key){
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Remove a node. The last node moves into its place
+ * @return readings the node had
+ */
+static uint16_t
+digest_take(struct GROOT_DIGEST *digest, uint8_t key){
+	int i = digest_find(digest, key);
+	uint16_t count;
+
+	if(i < 0){
+		return 0;
+	}
+	count = digest->count[i];
+	digest->length -= 1;
+	digest->key[i] = digest->key[digest->length];
+	digest->count[i] = digest->count[digest->length];
+	return count;
+}
+
+/**
+ * @brief Add readings to a node, creating it if there is room
+ */
+static void
+digest_put(struct GROOT_DIGEST *digest, uint8_t key, uint16_t count){
+	int i = digest_find(digest, key);
+
+	if(i < 0){
+		if(digest->length >= GROOT_QUANTILE_NODES || count == 0){
+			return;
+		}
+		i = digest->length;
+		digest->length += 1;
+		digest->key[i] = key;
+		digest->count[i] = 0;
+	}
+	digest->count[i] += count;
+}
+
+static uint8_t
+digest_level(uint8_t key){
+	uint8_t level = 0;
+
+	while((DIGEST_ID(key) >> (level + 1)) != 0){
+		level += 1;
+	}
+	return level;
+}
+
+static uint16_t
+digest_count(const struct GROOT_DIGEST *digest, uint8_t key){
+	int i = digest_find(digest, key);
+
+	return (i < 0) ? 0 : digest->count[i];
+}
+/*------------------------------------------------- Compression ---------------------------------------------------------*/
+/**
+ * @brief Most readings a family can have and still be folded
+ */
+static uint32_t
+digest_limit(const struct GROOT_DIGEST *digest, uint16_t total){
+	return (uint32_t)digest->error * total / (100 * GROOT_QUANTILE_BITS);
+}
+
+/**
+ * @brief Fold the families of a sensor with no more than limit readings, bottom up
+ */
+static void
+digest_compress(struct GROOT_DIGEST *digest, uint8_t sensor, uint32_t limit){
+	uint8_t level, id;
+	uint32_t family;
+
+	for(level = GROOT_QUANTILE_BITS; level > 0; level--){
+		for(id = 1 << level; id < (2 << level); id += 2){
+			family = digest_count(digest, DIGEST_KEY(sensor, id)) + digest_count(digest, DIGEST_KEY(sensor, id + 1));
+			if(family == 0 || family + digest_count(digest, DIGEST_KEY(sensor, id >> 1)) > limit){
+				continue;
+			}
+			family = digest_take(digest, DIGEST_KEY(sensor, id)) + digest_take(digest, DIGEST_KEY(sensor, id + 1));
+			digest_put(digest, DIGEST_KEY(sensor, id >> 1), family);
+		}
+	}
+}
+
+/**
+ * @brief Make room for more nodes
+ * @details Folds every sensor with a limit that doubles until they fit. At the end
+ *          every sensor is down to its root, which always fits.
+ */
+static void
+digest_fit(struct GROOT_DIGEST *digest, uint16_t total, uint8_t need){
+	uint32_t limit = digest_limit(digest, total);
+	uint8_t sensor;
+
+	while(digest->length + need > GROOT_QUANTILE_NODES){
+		limit = (limit == 0) ? 1 : ((limit > 0xFFFF) ? DIGEST_ALL : 2*limit);
+		for(sensor = 0; sensor < 4; sensor++){
+			digest_compress(digest, sensor, limit);
+		}
+	}
+}
+/*------------------------------------------------- Main Methods --------------------------------------------------------*/
+void
+groot_digest_add(struct GROOT_DIGEST *digest, uint8_t sensor, float reading, uint16_t total){
+	int leaf = (reading - digest->low) * DIGEST_LEAVES / (digest->high - digest->low);
+	uint8_t key;
+
+	if(leaf < 0){
+		leaf = 0;
+	} else if(leaf >= DIGEST_LEAVES){
+		leaf = DIGEST_LEAVES - 1;
+	}
+	key = DIGEST_KEY(sensor, DIGEST_LEAVES + leaf);
+
+	if(digest_find(digest, key) < 0){
+		digest_fit(digest, total, 1);
+	}
+	digest_put(digest, key, 1);
+}
+
+void
+groot_digest_merge(struct GROOT_DIGEST *into, const struct GROOT_DIGEST *digest, uint8_t sensor, uint16_t total){
+	uint8_t i;
+
+	for(i = 0; i < digest->length; i++){
+		if(DIGEST_SENSOR(digest->key[i]) != sensor){
+			continue;
+		}
+		if(digest_find(into, digest->key[i]) < 0){
+			digest_fit(into, total, 1);
+		}
+		digest_put(into, digest->key[i], digest->count[i]);
+	}
+	digest_compress(into, sensor, digest_limit(into, total));
+}
+
+void
+groot_digest_drop(struct GROOT_DIGEST *digest, uint8_t sensor){
+	uint8_t i = 0;
+
+	while(i < digest->length){
+		if(DIGEST_SENSOR(digest->key[i]) == sensor){
+			digest_take(digest, digest->key[i]);
+			continue;
+		}
+		i += 1;
+	}
+}
+
+uint8_t
+groot_digest_valid(const struct GROOT_DIGEST *digest){
+	uint8_t i;
+
+	if(digest->length > GROOT_QUANTILE_NODES){
+		return 0;
+	}
+	for(i = 0; i < digest->length; i++){
+		if(DIGEST_ID(digest->key[i]) == 0 || DIGEST_ID(digest->key[i]) >= 2*DIGEST_LEAVES){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+float
+groot_digest_quantile(const struct GROOT_DIGEST *digest, uint8_t sensor, uint8_t percent){
+	uint8_t used[GROOT_QUANTILE_NODES], i, level, next, next_level = 0;
+	uint16_t hi[GROOT_QUANTILE_NODES];
+	uint32_t total = 0, rank, seen = 0;
+	int pick;
+
+	//Highest bucket and level of every node of the sensor
+	for(i = 0; i < digest->length; i++){
+		used[i] = (DIGEST_SENSOR(digest->key[i]) != sensor);
+		if(used[i]){
+			continue;
+		}
+		level = digest_level(digest->key[i]);
+		hi[i] = ((DIGEST_ID(digest->key[i]) - (1 << level) + 1) << (GROOT_QUANTILE_BITS - level)) - 1;
+		total += digest->count[i];
+	}
+	if(total == 0){
+		return 0;
+	}
+	rank = total * percent / 100;
+
+	//Nodes by highest bucket, smaller ranges first
+	next = 0;
+	while(1){
+		pick = -1;
+		for(i = 0; i < digest->length; i++){
+			if(used[i]){
+				continue;
+			}
+			level = digest_level(digest->key[i]);
+			if(pick < 0 || hi[i] < hi[pick] || (hi[i] == hi[pick] && level > next_level)){
+				pick = i;
+				next_level = level;
+			}
+		}
+		if(pick < 0){
+			break;
+		}
+		used[pick] = 1;
+		next = hi[pick];
+		seen += digest->count[pick];
+		if(seen > rank){
+			break;
+		}
+	}
+
+	return digest->low + (next + 0.5f) * (digest->high - digest->low) / DIGEST_LEAVES;
+}
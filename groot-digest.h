@@ -0,0 +1,76 @@
+/**
+ * @file
+ * 	Header file for the GROOT quantile digest used by GROOT_QUANTILE.
+ */
+#ifndef __GROOT_DIGEST_H__
+#define __GROOT_DIGEST_H__
+
+#include "contiki.h"
+#include "groot.h"
+
+/**
+ * @brief Bytes of a digest node on the wire. Key and count
+ */
+#define GROOT_DIGEST_NODE_BYTES 3
+
+/**
+ * @brief Count readings of a sensor in the digest
+ * @details Count readings of a sensor in the bucket of the reading
+ *
+ * @param GROOT_DIGEST Digest
+ * @param sensor Sensor index, in the order of the fields of GROOT_SENSORS_DATA
+ * @param reading Reading
+ * @param total Readings of the sensor in the digest once added
+ */
+void
+groot_digest_add(struct GROOT_DIGEST *digest, uint8_t sensor, float reading, uint16_t total);
+
+/**
+ * @brief Merge the nodes of a sensor of one digest into another
+ * @details Nodes with few readings are then folded into their parents while the
+ *          rank error stays within the digest's error, and further if the nodes
+ *          would not fit in GROOT_QUANTILE_NODES.
+ *
+ * @param GROOT_DIGEST Digest merged into
+ * @param GROOT_DIGEST Digest to merge
+ * @param sensor Sensor index
+ * @param total Readings of the sensor in the digest once merged
+ */
+void
+groot_digest_merge(struct GROOT_DIGEST *into, const struct GROOT_DIGEST *digest, uint8_t sensor, uint16_t total);
+
+/**
+ * @brief Drop the nodes of a sensor
+ * @details Drop the nodes of a sensor
+ *
+ * @param GROOT_DIGEST Digest
+ * @param sensor Sensor index
+ */
+void
+groot_digest_drop(struct GROOT_DIGEST *digest, uint8_t sensor);
+
+/**
+ * @brief Check the nodes of a digest read from a packet
+ * @details Every key must name a node of the tree, 1 to 2^(GROOT_QUANTILE_BITS+1) - 1,
+ *          and there must be no more than GROOT_QUANTILE_NODES
+ *
+ * @param GROOT_DIGEST Digest
+ * @return 1 valid 0 otherwise
+ */
+uint8_t
+groot_digest_valid(const struct GROOT_DIGEST *digest);
+
+/**
+ * @brief Estimate a quantile of a sensor
+ * @details The middle of the highest bucket of the node where the readings counted
+ *          in rank order pass the quantile.
+ *
+ * @param GROOT_DIGEST Digest
+ * @param sensor Sensor index
+ * @param percent Quantile in percent. 50 is the median
+ * @return reading at the quantile or 0 when the sensor has no readings
+ */
+float
+groot_digest_quantile(const struct GROOT_DIGEST *digest, uint8_t sensor, uint8_t percent);
+
+#endif /* __GROOT_DIGEST_H__ */
@@ -27,15 +27,17 @@ recv_runic(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno){
 
 static void 
 sent_runic(struct runicast_conn *c, const rimeaddr_t *from, uint8_t retransmissions){
-	printf("SUCCESS");
+	GROOT_PRINTF("SUCCESS");
+	groot_runicast_done(retransmissions, 0);
 }
 
 static void 
 timedout_runic(struct runicast_conn *c, const rimeaddr_t *from, uint8_t retransmissions){
-	printf("TIMEDOUT!! \n");
+	GROOT_PRINTF("TIMEDOUT!! \n");
+	groot_runicast_done(retransmissions, 1);
 }
 
-static const struct broadcast_callbacks sensor_routing_bcast = {recv_routing};
+static const struct broadcast_callbacks sensor_routing_bcast = {recv_routing, NULL};
 static const struct runicast_callbacks sensor_data_rcast = {
 	recv_runic,
 	sent_runic,
@@ -44,7 +46,7 @@ static const struct runicast_callbacks sensor_data_rcast = {
 
 /*------------------------------ Main Functions ---------------------------*/
 void sensor_bootstrap(struct GROOT_SENSORS *support){	
-	printf("Sensor Starting.....\n");
+	GROOT_PRINTF("Sensor Starting.....\n");
 	//Open Channels needed
 	broadcast_open(&sensor_chan.bc, GROOT_ROUTING_CHANNEL, &sensor_routing_bcast);
 	runicast_open(&sensor_chan.rc, GROOT_DATA_CHANNEL, &sensor_data_rcast);
@@ -53,7 +55,7 @@ void sensor_bootstrap(struct GROOT_SENSORS *support){
 	groot_prot_init(support, &sensor_chan, 0);
 }
 
-int
+void
 sensor_destroy(){
 	broadcast_close(&sensor_chan.bc);
 	runicast_close(&sensor_chan.rc);
@@ -19,5 +19,5 @@ sensor_bootstrap(struct GROOT_SENSORS *support);
  * @brief Kill sensor mote
  * @details Kill sensor mote
  */
-int
+void
 sensor_destroy();
\ No newline at end of file
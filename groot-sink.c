@@ -2,13 +2,27 @@
 #include "contiki.h"
 #include <stdio.h>
 #include "net/rime.h"
+#include "string.h"
+#include "groot-aggregate.h"
+
+//Results are the sink's output, not debug output
+#if GROOT_SINK_PRINT
+	#define SINK_PRINTF(...) printf(__VA_ARGS__)
+#else
+	#define SINK_PRINTF(...)
+#endif
 
 static struct GROOT_CHANNELS sink_chan;
+static struct GROOT_SINK_QUERY sink_queries[GROOT_SINK_QUERY_LIMIT];
+static struct GROOT_SINK_STORE sink_stores[GROOT_SINK_QUERY_LIMIT]; //Of the user query at the same index
+static struct GROOT_SINK_NETWORK sink_networks[GROOT_QUERY_LIMIT];
+static uint16_t sink_next_id;
+static uint8_t sink_merge;
 /*------------------------------ Callbacks ---------------------------------*/
 
 static void
 recv_routing(struct broadcast_conn *c, const rimeaddr_t *from){
-	printf("Received Published data!!");
+	GROOT_PRINTF("Received Published data!!");
 	//Handle new query
 	int is_success = groot_rcv(from);
 	if(!is_success){
@@ -27,30 +41,309 @@ recv_runic(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno){
 
 static void 
 sent_runic(struct runicast_conn *c, const rimeaddr_t *from, uint8_t retransmissions){
-
+	groot_runicast_done(retransmissions, 0);
 }
 
 static void 
 timedout_runic(struct runicast_conn *c, const rimeaddr_t *from, uint8_t retransmissions){
-
+	groot_runicast_done(retransmissions, 1);
 }
 
-static const struct broadcast_callbacks sink_routing_bcast = {recv_routing};
+static const struct broadcast_callbacks sink_routing_bcast = {recv_routing, NULL};
 static const struct runicast_callbacks sink_data_rcast = {
 	recv_runic,
 	sent_runic,
 	timedout_runic
 };
 
+/*------------------------------- Query Merging -----------------------------*/
+static uint16_t
+rate_gcd(uint16_t a, uint16_t b){
+	uint16_t t;
+
+	while(b != 0){
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static struct GROOT_SINK_QUERY
+*find_user_query(uint16_t query_id){
+	uint8_t i;
+
+	for(i = 0; i < GROOT_SINK_QUERY_LIMIT; i++){
+		if(sink_queries[i].query_id == query_id){
+			return &sink_queries[i];
+		}
+	}
+	return NULL;
+}
+
+static struct GROOT_SINK_NETWORK
+*find_network_query(uint16_t query_id){
+	uint8_t i;
+
+	for(i = 0; i < GROOT_QUERY_LIMIT; i++){
+		if(sink_networks[i].query_id == query_id){
+			return &sink_networks[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Number of user queries a network query answers
+ */
+static uint8_t
+network_users(struct GROOT_SINK_NETWORK *net){
+	uint8_t i, users = 0;
+
+	for(i = 0; i < GROOT_SINK_QUERY_LIMIT; i++){
+		if(sink_queries[i].query_id != 0 && sink_queries[i].network_id == net->query_id){
+			users += 1;
+		}
+	}
+	return users;
+}
+
+/**
+ * @brief Check if a user query can be answered by a network query
+ * @details The aggregator and options must match, and the merged query must not run more
+ *          epochs than its users would on their own. Users at rates r1..rn share a query
+ *          at rate g = gcd(r1..rn) only while g/r1 + ... + g/rn >= 1.
+ * 
+ * @param GROOT_SINK_NETWORK Network query
+ * @param GROOT_SINK_QUERY User query
+ */
+static uint8_t
+can_merge(struct GROOT_SINK_NETWORK *net, struct GROOT_SINK_QUERY *user){
+	uint16_t rate = user->sample_rate;
+	float load = 0;
+	uint8_t i;
+
+	if(net->aggregator != user->aggregator || net->options.error != user->options.error ||
+		net->options.epsilon != user->options.epsilon ||
+		net->options.low != user->options.low || net->options.high != user->options.high ||
+		memcmp(net->options.where.term, user->options.where.term, sizeof(net->options.where.term)) != 0 ||
+		memcmp(net->options.where.value, user->options.where.value, sizeof(net->options.where.value)) != 0){
+		return 0;
+	}
+	if(!GROOT_SINK_MERGE_SENSORS && memcmp(&net->sensors_required, &user->sensors_required, sizeof(struct GROOT_SENSORS)) != 0){
+		return 0;
+	}
+
+	for(i = 0; i < GROOT_SINK_QUERY_LIMIT; i++){
+		if(sink_queries[i].query_id != 0 && sink_queries[i].network_id == net->query_id){
+			rate = rate_gcd(rate, sink_queries[i].sample_rate);
+		}
+	}
+	for(i = 0; i < GROOT_SINK_QUERY_LIMIT; i++){
+		if(sink_queries[i].query_id != 0 && sink_queries[i].network_id == net->query_id){
+			load += (float)rate / sink_queries[i].sample_rate;
+		}
+	}
+	load += (float)rate / user->sample_rate;
+	return load >= 1;
+}
+
+/**
+ * @brief Find the network query to answer a user query, or start one
+ * @return network query or NULL if the table is full
+ */
+static struct GROOT_SINK_NETWORK
+*assign_network(struct GROOT_SINK_QUERY *user){
+	struct GROOT_SINK_NETWORK *net = NULL;
+	uint8_t i;
+
+	for(i = 0; sink_merge && i < GROOT_QUERY_LIMIT; i++){
+		if(sink_networks[i].query_id != 0 && can_merge(&sink_networks[i], user)){
+			user->network_id = sink_networks[i].query_id;
+			return &sink_networks[i];
+		}
+	}
+
+	net = find_network_query(0);
+	if(net == NULL){
+		return NULL;
+	}
+	//Ids of network queries are the sink's own
+	do{
+		sink_next_id += 1;
+	} while(sink_next_id == 0 || find_network_query(sink_next_id) != NULL);
+	net->query_id = sink_next_id;
+	net->sample_rate = 0;
+	net->aggregator = user->aggregator;
+	memset(&net->sensors_required, 0, sizeof(struct GROOT_SENSORS));
+	memcpy(&net->options, &user->options, sizeof(struct GROOT_QUERY_OPTIONS));
+	user->network_id = net->query_id;
+	return net;
+}
+
+/**
+ * @brief Bring a network query in line with its users
+ * @details A new query is subscribed, one whose sensors or rate changed is altered and
+ *          one left without users is unsubscribed. Its rate and sensors are only kept
+ *          once the query is sent, and a new query that could not be is released.
+ * 
+ * @param GROOT_SINK_NETWORK Network query
+ * @param changed 1 its aggregator changed and it must be altered regardless
+ * @return 1 sent or nothing to send 0 not sent
+ */
+static int
+refresh_network(struct GROOT_SINK_NETWORK *net, uint8_t changed){
+	struct GROOT_SENSORS sensors;
+	uint16_t rate = 0;
+	uint8_t i, type;
+
+	memset(&sensors, 0, sizeof(struct GROOT_SENSORS));
+	for(i = 0; i < GROOT_SINK_QUERY_LIMIT; i++){
+		if(sink_queries[i].query_id == 0 || sink_queries[i].network_id != net->query_id){
+			continue;
+		}
+		rate = rate_gcd(rate, sink_queries[i].sample_rate);
+		sensors.co2 |= sink_queries[i].sensors_required.co2;
+		sensors.no |= sink_queries[i].sensors_required.no;
+		sensors.temp |= sink_queries[i].sensors_required.temp;
+		sensors.humidity |= sink_queries[i].sensors_required.humidity;
+	}
+
+	if(rate == 0){
+		i = groot_unsubscribe_snd(net->query_id);
+		net->query_id = 0;
+		return i;
+	}
+	if(!changed && rate == net->sample_rate && memcmp(&sensors, &net->sensors_required, sizeof(struct GROOT_SENSORS)) == 0){
+		return 1;
+	}
+
+	type = (net->sample_rate == 0) ? GROOT_SUBSCRIBE_TYPE : GROOT_ALTERATION_TYPE;
+	GROOT_PRINTF("SINK - { NETWORK QUERY %d RATE %d }\n", net->query_id, rate);
+	if(!groot_qry_snd(net->query_id, type, rate, &sensors, net->aggregator, &net->options)){
+		if(type == GROOT_SUBSCRIBE_TYPE){
+			net->query_id = 0;
+		}
+		return 0;
+	}
+	net->sample_rate = rate;
+	memcpy(&net->sensors_required, &sensors, sizeof(struct GROOT_SENSORS));
+	return 1;
+}
+
+/*------------------------------- Result Store ------------------------------*/
+/**
+ * @brief Append a result to a user query's store
+ * @details The oldest result is overwritten once the store is full
+ * 
+ * @param GROOT_SINK_STORE Store of the query
+ * @param GROOT_SINK_RESULT Result
+ */
+static void
+store_result(struct GROOT_SINK_STORE *store, struct GROOT_SINK_RESULT *result){
+	memcpy(&store->results[store->head], result, sizeof(struct GROOT_SINK_RESULT));
+	store->head = (store->head + 1) % GROOT_SINK_STORE_LENGTH;
+	if(store->length < GROOT_SINK_STORE_LENGTH){
+		store->length += 1;
+	}
+}
+
+/**
+ * @brief Get the i-th oldest stored result
+ */
+static struct GROOT_SINK_RESULT
+*stored_result(struct GROOT_SINK_STORE *store, uint8_t i){
+	return &store->results[(store->head + GROOT_SINK_STORE_LENGTH - store->length + i) % GROOT_SINK_STORE_LENGTH];
+}
+
+static void
+print_result(struct GROOT_SINK_RESULT *result){
+	SINK_PRINTF("READINGS %d - { CO2 %.2f NO - %.2f TEMP - %.2f HUMIDITY - %.2f } \n", result->count,
+		result->values.co2, result->values.no, result->values.temp, result->values.humidity);
+}
+
+/**
+ * @brief Keep only the values of the sensors a query needs
+ */
+static void
+mask_values(struct GROOT_SENSORS *required, struct GROOT_SENSORS_DATA *values){
+	values->co2 = required->co2 ? values->co2 : 0;
+	values->no = required->no ? values->no : 0;
+	values->temp = required->temp ? values->temp : 0;
+	values->humidity = required->humidity ? values->humidity : 0;
+}
+
+/**
+ * @brief Hand a network query's result to the user queries it answers
+ * @details Each user query takes the epochs of its own rate and only its sensors. The
+ *          result is stored for the user query and printed.
+ * 
+ * @param query_id Network query
+ * @param epoch Epoch of the result
+ * @param GROOT_PARTIAL Result
+ */
+static void
+sink_result(uint16_t query_id, uint16_t epoch, struct GROOT_PARTIAL *partial){
+	struct GROOT_SINK_NETWORK *net = find_network_query(query_id);
+	struct GROOT_SINK_QUERY *user;
+	struct GROOT_SINK_RESULT result;
+	struct GROOT_SENSORS_DATA data, p95;
+	uint16_t every;
+	uint8_t i;
+
+	if(net == NULL || query_id == 0){
+		return;
+	}
+
+	groot_partial_finalize(net->aggregator, partial, &data);
+	if(net->aggregator == GROOT_QUANTILE){
+		groot_partial_quantile(partial, 95, &p95);
+	}
+	for(i = 0; i < GROOT_SINK_QUERY_LIMIT; i++){
+		user = &sink_queries[i];
+		if(user->query_id == 0 || user->network_id != query_id){
+			continue;
+		}
+		every = user->sample_rate / net->sample_rate;
+		if(epoch % every != 0){
+			continue;
+		}
+
+		result.query_id = user->query_id;
+		result.sample_id = (net->aggregator == GROOT_NO_AGGREGATION) ? epoch : epoch / every;
+		result.timestamp = clock_seconds();
+		result.count = partial->count;
+		memcpy(&result.values, &data, sizeof(struct GROOT_SENSORS_DATA));
+		mask_values(&user->sensors_required, &result.values);
+		store_result(&sink_stores[i], &result);
+
+		SINK_PRINTF("------- RESULT QID - %d ------\n", user->query_id);
+		print_result(&result);
+		if(net->aggregator == GROOT_QUANTILE){
+			memcpy(&result.values, &p95, sizeof(struct GROOT_SENSORS_DATA));
+			mask_values(&user->sensors_required, &result.values);
+			SINK_PRINTF("P95 - ");
+			print_result(&result);
+		}
+		SINK_PRINTF("------------------------------------\n");
+	}
+}
 /*------------------------------- Main Function -----------------------------*/
 void
 sink_bootstrap(struct GROOT_SENSORS *supported_sensors){
-	printf("Sink Starting.....\n");
+	GROOT_PRINTF("Sink Starting.....\n");
 	//Open Channels needed
 	broadcast_open(&sink_chan.bc, GROOT_ROUTING_CHANNEL, &sink_routing_bcast);
 	runicast_open(&sink_chan.rc, GROOT_DATA_CHANNEL, &sink_data_rcast);
 	//Initialize protocol library
 	groot_prot_init(supported_sensors, &sink_chan, 1);
+	groot_result_callback(sink_result);
+
+	memset(sink_queries, 0, sizeof(sink_queries));
+	memset(sink_stores, 0, sizeof(sink_stores));
+	memset(sink_networks, 0, sizeof(sink_networks));
+	sink_next_id = 0;
+	sink_merge = 1;
 }
 
 void
@@ -59,19 +352,162 @@ sink_destroy(){
 	runicast_close(&sink_chan.rc);
 }
 
+void
+sink_merge_queries(uint8_t enabled){
+	sink_merge = enabled;
+}
+
 int
 sink_subscribe(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation){
-	//Send Subscribtion
-	groot_qry_snd(query_id, GROOT_SUBSCRIBE_TYPE, sample_rate, data_required, aggregation);
+	struct GROOT_QUERY_OPTIONS options;
+
+	memset(&options, 0, sizeof(struct GROOT_QUERY_OPTIONS));
+	options.error = GROOT_QUANTILE_ERROR;
+	return sink_subscribe_options(query_id, sample_rate, data_required, aggregation, &options);
+}
+
+int
+sink_subscribe_options(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation,
+	struct GROOT_QUERY_OPTIONS *options){
+	struct GROOT_SINK_QUERY *user;
+	struct GROOT_SINK_NETWORK *net;
+
+	if(query_id == 0 || sample_rate == 0 || find_user_query(query_id) != NULL){
+		return 0;
+	}
+	user = find_user_query(0);
+	if(user == NULL){
+		return 0;
+	}
+	memset(&sink_stores[user - sink_queries], 0, sizeof(struct GROOT_SINK_STORE));
+
+	user->sample_rate = sample_rate;
+	user->aggregator = aggregation;
+	memcpy(&user->sensors_required, data_required, sizeof(struct GROOT_SENSORS));
+	memcpy(&user->options, options, sizeof(struct GROOT_QUERY_OPTIONS));
+	net = assign_network(user);
+	if(net == NULL){
+		return 0;
+	}
+	user->query_id = query_id;
+
+	//Send Subscribtion. The slot is freed if it did not go out so the id can be tried again
+	if(!refresh_network(net, 0)){
+		user->query_id = 0;
+		return 0;
+	}
+	return 1;
+}
+
+int
+sink_subscribe_quantile(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t error){
+	struct GROOT_QUERY_OPTIONS options;
+
+	memset(&options, 0, sizeof(struct GROOT_QUERY_OPTIONS));
+	options.error = error;
+	return sink_subscribe_options(query_id, sample_rate, data_required, GROOT_QUANTILE, &options);
+}
+
+int
+sink_subscribe_where(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation,
+	struct GROOT_WHERE *where){
+	struct GROOT_QUERY_OPTIONS options;
+
+	memset(&options, 0, sizeof(struct GROOT_QUERY_OPTIONS));
+	options.error = GROOT_QUANTILE_ERROR;
+	memcpy(&options.where, where, sizeof(struct GROOT_WHERE));
+	return sink_subscribe_options(query_id, sample_rate, data_required, aggregation, &options);
 }
 
 int
 sink_unsubscribe(uint16_t query_id){
-	groot_unsubscribe_snd(query_id);
+	struct GROOT_SINK_QUERY *user = find_user_query(query_id);
+	struct GROOT_SINK_NETWORK *net;
+
+	if(query_id == 0 || user == NULL){
+		return 0;
+	}
+	net = find_network_query(user->network_id);
+	user->query_id = 0;
+	return (net != NULL) ? refresh_network(net, 0) : 1;
 }
 
 int
 sink_send(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation){
-	//Send Subscribtion
-	groot_qry_snd(query_id, GROOT_ALTERATION_TYPE, sample_rate, data_required, aggregation);
-}
\ No newline at end of file
+	struct GROOT_SINK_QUERY *user = find_user_query(query_id);
+	struct GROOT_SINK_QUERY old;
+	struct GROOT_SINK_NETWORK *net, *joined;
+
+	if(query_id == 0 || sample_rate == 0 || user == NULL){
+		return 0;
+	}
+
+	//Put back if the altered query cannot be sent
+	memcpy(&old, user, sizeof(struct GROOT_SINK_QUERY));
+	net = find_network_query(user->network_id);
+	user->sample_rate = sample_rate;
+	user->aggregator = aggregation;
+	memcpy(&user->sensors_required, data_required, sizeof(struct GROOT_SENSORS));
+	//Its only user alters the network query in place
+	if(net != NULL && network_users(net) == 1){
+		net->aggregator = aggregation;
+		if(!refresh_network(net, 1)){
+			net->aggregator = old.aggregator;
+			memcpy(user, &old, sizeof(struct GROOT_SINK_QUERY));
+			return 0;
+		}
+		return 1;
+	}
+
+	//Join the network query that fits the new details, then leave the old one
+	user->query_id = 0;
+	joined = assign_network(user);
+	user->query_id = query_id;
+	if(joined == NULL || !refresh_network(joined, 0)){
+		memcpy(user, &old, sizeof(struct GROOT_SINK_QUERY));
+		return 0;
+	}
+	if(net != NULL && net != joined){
+		refresh_network(net, 0);
+	}
+	return 1;
+}
+
+uint8_t
+sink_results_latest(uint16_t query_id, uint8_t max, struct GROOT_SINK_RESULT *results){
+	struct GROOT_SINK_QUERY *user = find_user_query(query_id);
+	struct GROOT_SINK_STORE *store;
+	uint8_t i, skip;
+
+	if(query_id == 0 || user == NULL){
+		return 0;
+	}
+	store = &sink_stores[user - sink_queries];
+	skip = (store->length > max) ? store->length - max : 0;
+	for(i = skip; i < store->length; i++){
+		memcpy(&results[i - skip], stored_result(store, i), sizeof(struct GROOT_SINK_RESULT));
+	}
+	return store->length - skip;
+}
+
+uint8_t
+sink_results_range(uint16_t query_id, unsigned long from, unsigned long to, uint8_t max, struct GROOT_SINK_RESULT *results){
+	struct GROOT_SINK_QUERY *user = find_user_query(query_id);
+	struct GROOT_SINK_STORE *store;
+	struct GROOT_SINK_RESULT *result;
+	uint8_t i, copied = 0;
+
+	if(query_id == 0 || user == NULL){
+		return 0;
+	}
+	store = &sink_stores[user - sink_queries];
+	for(i = 0; i < store->length && copied < max; i++){
+		result = stored_result(store, i);
+		//Compared as ages from from so a range across the clock wrap still holds
+		if(result->timestamp - from <= to - from){
+			memcpy(&results[copied], result, sizeof(struct GROOT_SINK_RESULT));
+			copied += 1;
+		}
+	}
+	return copied;
+}
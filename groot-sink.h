@@ -16,11 +16,22 @@
 void
 sink_bootstrap(struct GROOT_SENSORS *supported_sensors);
 
+/**
+ * @brief Turn merging of user queries on or off
+ * @details On after sink_bootstrap(). With it off every user query is its own network query.
+ * 
+ * @param enabled 1 merge 0 do not
+ */
+void
+sink_merge_queries(uint8_t enabled);
+
 /**
  * @brief When calling this function, a query will be generated and sent to sensors.
  * @details When calling this function. A query is generated and will be proliferated to the other sensors.
  *          First the query is broadcasted to all the sensors. The sensors will then create aggregations and
- *          start sending data back to the sink.
+ *          start sending data back to the sink. User queries with the same aggregator and options share one
+ *          network query for the union of their sensors at the greatest common divisor of their rates, as
+ *          long as it runs no more epochs than they would apart. Each gets its own results.
  * 
  * @param sample_rate The rate at which the sensors should gather information from the sensor
  * @param data_required The sensor data required
@@ -29,6 +40,50 @@ sink_bootstrap(struct GROOT_SENSORS *supported_sensors);
 int
 sink_subscribe(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation);
 
+/**
+ * @brief Subscribe a query with its optional settings
+ * @details With an epsilon nodes and aggregating parents publish only when a value moved
+ *          more than epsilon from the one they last sent, and at least every
+ *          GROOT_HEARTBEAT epochs. Parents and the sink aggregate the last values they
+ *          hold, so each published value is within epsilon of the one it stands for.
+ * 
+ * @param sample_rate The rate at which the sensors should gather information from the sensor
+ * @param data_required The sensor data required
+ * @param aggregation The aggregation needed on the data
+ * @param options Quantile error, epsilon and predicates
+ */
+int
+sink_subscribe_options(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation,
+	struct GROOT_QUERY_OPTIONS *options);
+
+/**
+ * @brief Subscribe a GROOT_QUANTILE query with its own rank error
+ * @details sink_subscribe() uses GROOT_QUANTILE_ERROR. The smaller the error the more
+ *          digest nodes a publish carries, up to GROOT_QUANTILE_NODES.
+ *          The digest spans GROOT_HISTOGRAM_LOW..HIGH; sink_subscribe_options() takes another range.
+ * 
+ * @param sample_rate The rate at which the sensors should gather information from the sensor
+ * @param data_required The sensor data required
+ * @param error Rank error of the quantiles in percent of the readings
+ */
+int
+sink_subscribe_quantile(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t error);
+
+/**
+ * @brief Subscribe a query that only nodes whose readings pass the predicates answer
+ * @details Nodes check the predicates every epoch and stay silent when their readings
+ *          do not pass, so a query watching for a rare condition costs no frames
+ *          while it does not hold.
+ * 
+ * @param sample_rate The rate at which the sensors should gather information from the sensor
+ * @param data_required The sensor data required
+ * @param aggregation The aggregation needed on the data
+ * @param where Predicates ANDed together
+ */
+int
+sink_subscribe_where(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation,
+	struct GROOT_WHERE *where);
+
 /**
  * @brief When calling remove the query from the network
  * @details When called sends broadcast to remove query from the network
@@ -40,7 +95,8 @@ sink_unsubscribe(uint16_t query_id);
 
 /**
  * @brief Used to update any queries already running om the network
- * @details Used to update any queries already running on the network
+ * @details Used to update any queries already running on the network. The query keeps
+ *          its options
  * 
  * @param query_id [description]
  * @param sample_rate [description]
@@ -50,6 +106,33 @@ sink_unsubscribe(uint16_t query_id);
 int
 sink_send(uint16_t query_id, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregation);
 
+/**
+ * @brief Read the latest results of a query
+ * @details Copies up to max of the latest stored results, oldest first
+ * 
+ * @param query_id User query
+ * @param max Most results to copy
+ * @param results Where the results are copied
+ * @return results copied
+ */
+uint8_t
+sink_results_latest(uint16_t query_id, uint8_t max, struct GROOT_SINK_RESULT *results);
+
+/**
+ * @brief Read the stored results of a query that came in between two times
+ * @details Copies up to max stored results with from <= timestamp <= to, oldest first.
+ *          Times are clock_seconds() of the sink. A range can span the clock wrap
+ * 
+ * @param query_id User query
+ * @param from Earliest sink time in seconds
+ * @param to Latest sink time in seconds
+ * @param max Most results to copy
+ * @param results Where the results are copied
+ * @return results copied
+ */
+uint8_t
+sink_results_range(uint16_t query_id, unsigned long from, unsigned long to, uint8_t max, struct GROOT_SINK_RESULT *results);
+
 /**
  * @brief Remove sink from adhoc network
  * @details Remove sink from adhoc network
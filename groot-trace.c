@@ -0,0 +1,102 @@
+/**
+ * @file
+ * 	GROOT binary trace ring.
+ * @details
+ * 	Events are kept as GROOT_TRACE_RECORD in a RAM ring instead of being formatted
+ * 	with printf, which takes milliseconds on an MSP430 and holds up the event loop.
+ * 	At DEBUG_LEVEL 0 the ring is not built and GROOT_TRACE compiles to nothing.
+ */
+
+#include "groot-trace.h"
+#include "string.h"
+#include <stdio.h>
+
+#if DEBUG_LEVEL > 0
+static struct GROOT_TRACE_RING groot_trace_ring;
+
+/**
+ * @brief Print bytes as hex
+ */
+static void
+trace_hex(const void *data, uint8_t length){
+	const uint8_t *byte = data;
+	uint8_t i;
+
+	for(i = 0; i < length; i++){
+		printf("%02x", byte[i]);
+	}
+}
+#endif
+/*------------------------------------------------- Main Methods --------------------------------------------------------*/
+void
+groot_trace_init(void){
+#if DEBUG_LEVEL > 0
+	memset(&groot_trace_ring, 0, sizeof(struct GROOT_TRACE_RING));
+#endif
+}
+
+void
+groot_trace(uint8_t event, uint16_t query_id, const rimeaddr_t *a, const rimeaddr_t *b, uint8_t arg){
+#if DEBUG_LEVEL > 0
+	struct GROOT_TRACE_RECORD *record = &groot_trace_ring.records[groot_trace_ring.head];
+
+	record->timestamp = clock_time();
+	record->query_id = query_id;
+	rimeaddr_copy(&record->a, (a != NULL) ? a : &rimeaddr_null);
+	rimeaddr_copy(&record->b, (b != NULL) ? b : &rimeaddr_null);
+	record->event = event;
+	record->arg = arg;
+
+	groot_trace_ring.head = (groot_trace_ring.head + 1) % GROOT_TRACE_LENGTH;
+	if(groot_trace_ring.length < GROOT_TRACE_LENGTH){
+		groot_trace_ring.length += 1;
+	} else if(groot_trace_ring.overwritten < 0xFFFF){
+		groot_trace_ring.overwritten += 1;
+	}
+#endif
+}
+
+uint8_t
+groot_trace_drain(struct GROOT_TRACE_RECORD *records, uint8_t max){
+	uint8_t taken = 0;
+#if DEBUG_LEVEL > 0
+	uint8_t oldest;
+
+	while(taken < max && groot_trace_ring.length > 0){
+		oldest = (groot_trace_ring.head + GROOT_TRACE_LENGTH - groot_trace_ring.length) % GROOT_TRACE_LENGTH;
+		memcpy(&records[taken], &groot_trace_ring.records[oldest], sizeof(struct GROOT_TRACE_RECORD));
+		groot_trace_ring.length -= 1;
+		taken += 1;
+	}
+#endif
+	return taken;
+}
+
+void
+groot_trace_write(void){
+#if DEBUG_LEVEL > 0
+	struct GROOT_TRACE_RECORD record;
+	uint8_t count = groot_trace_ring.length, i;
+
+	if(count == 0){
+		return;
+	}
+	printf("TRACE ");
+	trace_hex(&rimeaddr_node_addr, sizeof(rimeaddr_t));
+	trace_hex(&count, 1);
+	//A record at a time, the ring is too large for the stack of a mote
+	for(i = 0; i < count && groot_trace_drain(&record, 1) == 1; i++){
+		trace_hex(&record, sizeof(struct GROOT_TRACE_RECORD));
+	}
+	printf("\n");
+#endif
+}
+
+uint16_t
+groot_trace_overwritten(void){
+#if DEBUG_LEVEL > 0
+	return groot_trace_ring.overwritten;
+#else
+	return 0;
+#endif
+}
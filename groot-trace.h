@@ -0,0 +1,73 @@
+/**
+ * @file
+ * 	Header file for the GROOT binary trace. Replaces printf on the packet paths.
+ */
+#ifndef __GROOT_TRACE_H__
+#define __GROOT_TRACE_H__
+
+#include "contiki.h"
+#include "groot.h"
+
+/**
+ * @brief Trace an event. Compiles to nothing at DEBUG_LEVEL 0
+ */
+#if DEBUG_LEVEL > 0
+	#define GROOT_TRACE(event, query_id, a, b, arg) groot_trace(event, query_id, a, b, arg)
+#else
+	#define GROOT_TRACE(event, query_id, a, b, arg)
+#endif
+
+/**
+ * @brief Reading count as a trace argument
+ */
+#define GROOT_TRACE_COUNT(count) (((count) > 0xFF) ? 0xFF : (count))
+
+/**
+ * @brief Empty the trace ring
+ * @details Empty the trace ring
+ */
+void
+groot_trace_init(void);
+
+/**
+ * @brief Append a record to the trace ring
+ * @details Call through GROOT_TRACE. The oldest record is overwritten when the ring is full.
+ *
+ * @param event GROOT_TRACE event
+ * @param query_id Query or 0
+ * @param a First address of the event or NULL
+ * @param b Second address of the event or NULL
+ * @param arg Event detail
+ */
+void
+groot_trace(uint8_t event, uint16_t query_id, const rimeaddr_t *a, const rimeaddr_t *b, uint8_t arg);
+
+/**
+ * @brief Take the oldest records out of the trace ring
+ * @details Called when the node is idle, e.g. to write them to the serial line. The
+ *          host decoder reads the records as they are in memory.
+ *
+ * @param records Where the records are copied
+ * @param max Most records to take
+ * @return records taken
+ */
+uint8_t
+groot_trace_drain(struct GROOT_TRACE_RECORD *records, uint8_t max);
+
+/**
+ * @brief Drain the trace ring to the serial line
+ * @details Writes one line, TRACE then the frame in hex: node address, record count and
+ *          the records. trace-decode -s reads these lines out of a serial log. Call it
+ *          when the node is idle, often enough that the ring does not wrap.
+ */
+void
+groot_trace_write(void);
+
+/**
+ * @brief Records overwritten before they were drained
+ * @details Records overwritten before they were drained
+ */
+uint16_t
+groot_trace_overwritten(void);
+
+#endif /* __GROOT_TRACE_H__ */
@@ -0,0 +1,64 @@
+/**
+ * @file
+ * 	GROOT Trickle timer (RFC 6206) on the GROOT timer wheel.
+ * @details
+ * 	Every interval I the node picks a transmit point in [I/2, I) and sends only if
+ * 	it heard fewer than GROOT_TRICKLE_K consistent copies before it. Intervals double
+ * 	from GROOT_TRICKLE_IMIN to GROOT_TRICKLE_IMAX while neighbours agree, and drop back
+ * 	to GROOT_TRICKLE_IMIN when they do not.
+ */
+
+#include "groot-trickle.h"
+#include "groot-wheel.h"
+#include "stdlib.h"
+
+/**
+ * @brief Start an interval of the current length
+ */
+static void
+trickle_interval(struct GROOT_TRICKLE *tr){
+	clock_time_t half = tr->interval / 2, at;
+
+	at = half + ((half > 0) ? rand()%half : 0);
+	tr->rest = tr->interval - at;
+	tr->counter = 0;
+	groot_timer_set(&tr->timer, at, GROOT_EV_TRICKLE_SEND);
+}
+
+void
+groot_trickle_reset(struct GROOT_TRICKLE *tr){
+	if(!groot_timer_expired(&tr->timer) && tr->interval == GROOT_TRICKLE_IMIN){
+		return;
+	}
+	tr->interval = GROOT_TRICKLE_IMIN;
+	trickle_interval(tr);
+}
+
+void
+groot_trickle_consistent(struct GROOT_TRICKLE *tr){
+	if(tr->counter < 0xFF){
+		tr->counter += 1;
+	}
+}
+
+uint8_t
+groot_trickle_fired(struct GROOT_TRICKLE *tr){
+	//Transmit point. Wait out the rest of the interval
+	if(tr->timer.event == GROOT_EV_TRICKLE_SEND){
+		groot_timer_set(&tr->timer, tr->rest, GROOT_EV_TRICKLE_END);
+		return tr->counter < GROOT_TRICKLE_K;
+	}
+
+	//End of the interval
+	tr->interval *= 2;
+	if(tr->interval > GROOT_TRICKLE_IMAX){
+		tr->interval = GROOT_TRICKLE_IMAX;
+	}
+	trickle_interval(tr);
+	return 0;
+}
+
+void
+groot_trickle_stop(struct GROOT_TRICKLE *tr){
+	groot_timer_stop(&tr->timer);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file
+ * 	Header file for the GROOT Trickle timer used to disseminate queries.
+ */
+#ifndef __GROOT_TRICKLE_H__
+#define __GROOT_TRICKLE_H__
+
+#include "contiki.h"
+#include "groot.h"
+
+/**
+ * @brief Start a new interval at GROOT_TRICKLE_IMIN
+ * @details Called when the node takes on new query state or hears a neighbour with
+ *          state that does not match its own. Nothing happens if the timer is
+ *          already running at GROOT_TRICKLE_IMIN, so a burst of inconsistencies
+ *          costs one transmission.
+ *
+ * @param GROOT_TRICKLE Trickle timer
+ */
+void
+groot_trickle_reset(struct GROOT_TRICKLE *tr);
+
+/**
+ * @brief Count a consistent copy heard from a neighbour
+ * @details Count a consistent copy heard from a neighbour
+ *
+ * @param GROOT_TRICKLE Trickle timer
+ */
+void
+groot_trickle_consistent(struct GROOT_TRICKLE *tr);
+
+/**
+ * @brief Run the expired trickle timer
+ * @details At the transmit point of the interval tells the caller to send unless
+ *          GROOT_TRICKLE_K consistent copies were heard. At the end of the interval
+ *          doubles it up to GROOT_TRICKLE_IMAX and starts the next one.
+ *
+ * @param GROOT_TRICKLE Trickle timer
+ * @return 1 send now 0 do nothing
+ */
+uint8_t
+groot_trickle_fired(struct GROOT_TRICKLE *tr);
+
+/**
+ * @brief Stop the trickle timer
+ * @details Stop the trickle timer
+ *
+ * @param GROOT_TRICKLE Trickle timer
+ */
+void
+groot_trickle_stop(struct GROOT_TRICKLE *tr);
+
+#endif /* __GROOT_TRICKLE_H__ */
@@ -0,0 +1,238 @@
+/**
+ * @file
+ * 	GROOT timer wheel. Hierarchical timing wheel driven by a single ctimer.
+ * @details
+ * 	Level l has 2^GROOT_WHEEL_BITS slots of 2^(GROOT_WHEEL_BITS*l) clock ticks each.
+ * 	A timer sits in the lowest level whose range holds its expiry. Every time a
+ * 	level wraps the current slot of the level above is cascaded down. The ctimer
+ * 	is only set for the next slot that has timers in it.
+ */
+
+#include "groot-wheel.h"
+#include "string.h"
+
+#define WHEEL_SLOTS (1 << GROOT_WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_SHIFT(level) (GROOT_WHEEL_BITS*(level))
+
+static struct GROOT_TIMER *wheel[GROOT_WHEEL_LEVELS][WHEEL_SLOTS];
+static clock_time_t wheel_now; //Tick the wheel was last advanced to
+static clock_time_t wheel_wake; //Tick the ctimer is set for
+static uint16_t wheel_count; //Timers pending
+static uint8_t wheel_busy; //Advancing. Timers set by the events wait for the reschedule
+static struct ctimer wheel_ct;
+static void (*wheel_fire)(struct GROOT_TIMER *t);
+/*------------------------------------------------- Slots ---------------------------------------------------------------*/
+static void
+slot_add(struct GROOT_TIMER **slot, struct GROOT_TIMER *t){
+	t->next = *slot;
+	if(*slot != NULL){
+		(*slot)->pprev = &t->next;
+	}
+	*slot = t;
+	t->pprev = slot;
+}
+
+static void
+slot_rm(struct GROOT_TIMER *t){
+	*t->pprev = t->next;
+	if(t->next != NULL){
+		t->next->pprev = t->pprev;
+	}
+	t->next = NULL;
+	t->pprev = NULL;
+}
+
+/**
+ * @brief Put a timer in the slot of its expiry
+ * @details Lowest level whose range holds the expiry. Anything further than the
+ *          wheel reaches goes in the top level and is placed again when cascaded.
+ */
+static void
+wheel_place(struct GROOT_TIMER *t){
+	clock_time_t delta = t->expires - wheel_now;
+	uint8_t level = 0;
+
+	while(level < GROOT_WHEEL_LEVELS - 1 && (delta >> WHEEL_SHIFT(level + 1)) != 0){
+		level += 1;
+	}
+	slot_add(&wheel[level][(t->expires >> WHEEL_SHIFT(level)) & WHEEL_MASK], t);
+}
+/*------------------------------------------------- Wheel ---------------------------------------------------------------*/
+/**
+ * @brief Move the timers of the current slot of a level to the levels below
+ */
+static void
+wheel_cascade(uint8_t level){
+	uint8_t i = (wheel_now >> WHEEL_SHIFT(level)) & WHEEL_MASK;
+	struct GROOT_TIMER *list = wheel[level][i], *t;
+
+	//Detach first, a timer can be placed back in this slot
+	wheel[level][i] = NULL;
+	while(list != NULL){
+		t = list;
+		list = t->next;
+		wheel_place(t);
+	}
+}
+
+/**
+ * @brief Fire the timers expiring now
+ */
+static void
+wheel_expire(void){
+	struct GROOT_TIMER **slot = &wheel[0][wheel_now & WHEEL_MASK];
+	struct GROOT_TIMER *t;
+
+	while(*slot != NULL){
+		t = *slot;
+		slot_rm(t);
+		wheel_count -= 1;
+		wheel_fire(t);
+	}
+}
+
+/**
+ * @brief Find the next tick a slot with timers is due
+ * @details A slot of level 0 is due when its timers expire, a slot above when it is
+ *          cascaded. The current slot of level 0 counts, it may hold timers set now.
+ *
+ * @param next Where the tick is stored
+ * @return 1 found 0 no timers
+ */
+static uint8_t
+wheel_next(clock_time_t *next){
+	clock_time_t at, base;
+	uint8_t level, k, found = 0;
+
+	for(level = 0; level < GROOT_WHEEL_LEVELS; level++){
+		base = wheel_now >> WHEEL_SHIFT(level);
+		for(k = (level == 0) ? 0 : 1; k <= WHEEL_SLOTS; k++){
+			if(wheel[level][(base + k) & WHEEL_MASK] != NULL){
+				break;
+			}
+		}
+		if(k > WHEEL_SLOTS || (level == 0 && k == WHEEL_SLOTS)){
+			continue;
+		}
+		at = (base + k) << WHEEL_SHIFT(level);
+		if(!found || (clock_time_t)(at - wheel_now) < (clock_time_t)(*next - wheel_now)){
+			*next = at;
+			found = 1;
+		}
+	}
+	return found;
+}
+
+/**
+ * @brief Advance the wheel up to target
+ * @details Jumps straight to the next tick a slot is due, the ticks between have
+ *          nothing to fire or cascade. Looked up again after every step, the
+ *          events can set earlier timers.
+ */
+static void
+wheel_advance(clock_time_t target){
+	clock_time_t next;
+	uint8_t level;
+
+	wheel_expire();
+	while(wheel_now != target){
+		if(wheel_next(&next) && (clock_time_t)(next - wheel_now) < (clock_time_t)(target - wheel_now)){
+			wheel_now = next;
+		} else {
+			wheel_now = target;
+		}
+		for(level = 1; level < GROOT_WHEEL_LEVELS; level++){
+			if((wheel_now & (((clock_time_t)1 << WHEEL_SHIFT(level)) - 1)) != 0){
+				break;
+			}
+			wheel_cascade(level);
+		}
+		wheel_expire();
+	}
+}
+
+static void cb_wheel(void *ptr);
+
+/**
+ * @brief Set the ctimer for the next slot with timers
+ * @details A slot above level 0 is woken for when it is cascaded.
+ */
+static void
+wheel_schedule(void){
+	clock_time_t now = clock_time(), next = 0;
+
+	if(wheel_count == 0 || !wheel_next(&next)){
+		ctimer_stop(&wheel_ct);
+		return;
+	}
+
+	wheel_wake = next;
+	if((clock_time_t)(next - wheel_now) <= (clock_time_t)(now - wheel_now)){
+		ctimer_set(&wheel_ct, 0, cb_wheel, NULL);
+	} else {
+		ctimer_set(&wheel_ct, next - now, cb_wheel, NULL);
+	}
+}
+
+/**
+ * @brief The wheel's ctimer. Catch up with the clock and fire what expired
+ */
+static void
+cb_wheel(void *ptr){
+	wheel_busy = 1;
+	wheel_advance(clock_time());
+	wheel_busy = 0;
+	wheel_schedule();
+}
+/*------------------------------------------------- Main Methods --------------------------------------------------------*/
+void
+groot_wheel_init(void (*fire)(struct GROOT_TIMER *t)){
+	ctimer_stop(&wheel_ct);
+	memset(wheel, 0, sizeof(wheel));
+	wheel_now = clock_time();
+	wheel_wake = wheel_now;
+	wheel_count = 0;
+	wheel_busy = 0;
+	wheel_fire = fire;
+}
+
+void
+groot_timer_set(struct GROOT_TIMER *t, clock_time_t delay, uint8_t event){
+	groot_timer_stop(t);
+
+	//Idle wheel jumps to the clock rather than catching up
+	if(wheel_count == 0 && !wheel_busy){
+		wheel_now = clock_time();
+	}
+
+	t->expires = clock_time() + delay;
+	t->event = event;
+	wheel_place(t);
+	wheel_count += 1;
+
+	if(wheel_busy){
+		return;
+	}
+
+	//Wake earlier for the new timer
+	if(ctimer_expired(&wheel_ct) ||
+		(clock_time_t)(t->expires - wheel_now) < (clock_time_t)(wheel_wake - wheel_now)){
+		wheel_wake = t->expires;
+		ctimer_set(&wheel_ct, delay, cb_wheel, NULL);
+	}
+}
+
+void
+groot_timer_stop(struct GROOT_TIMER *t){
+	if(t->pprev == NULL){
+		return;
+	}
+	slot_rm(t);
+	wheel_count -= 1;
+}
+
+uint8_t
+groot_timer_expired(struct GROOT_TIMER *t){
+	return t->pprev == NULL;
+}
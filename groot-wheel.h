@@ -0,0 +1,60 @@
+/**
+ * @file
+ * 	Header file for the GROOT timer wheel. All GROOT timers share one ctimer.
+ */
+#ifndef __GROOT_WHEEL_H__
+#define __GROOT_WHEEL_H__
+
+#include "contiki.h"
+#include "groot.h"
+#include <stddef.h>
+
+/**
+ * @brief Get the structure a timer is embedded in
+ *
+ * @param t GROOT_TIMER
+ * @param type Type of the owner
+ * @param member Name of the timer in the owner
+ */
+#define GROOT_TIMER_OWNER(t, type, member) ((type *)((char *)(t) - offsetof(type, member)))
+
+/**
+ * @brief Initialise the timer wheel
+ * @details Initialise the timer wheel
+ *
+ * @param fire Called with every timer that expires
+ */
+void
+groot_wheel_init(void (*fire)(struct GROOT_TIMER *t));
+
+/**
+ * @brief Set a timer
+ * @details Set a timer. A pending timer is moved. O(1)
+ *
+ * @param GROOT_TIMER Timer to set
+ * @param delay Clock ticks until it expires
+ * @param event Event passed back when it expires
+ */
+void
+groot_timer_set(struct GROOT_TIMER *t, clock_time_t delay, uint8_t event);
+
+/**
+ * @brief Stop a timer
+ * @details Stop a timer. Nothing happens if it is not pending. O(1)
+ *
+ * @param GROOT_TIMER Timer to stop
+ */
+void
+groot_timer_stop(struct GROOT_TIMER *t);
+
+/**
+ * @brief Check whether the timer is not pending
+ * @details Check whether the timer is not pending
+ *
+ * @param GROOT_TIMER Timer to check
+ * @return 1 expired or stopped 0 pending
+ */
+uint8_t
+groot_timer_expired(struct GROOT_TIMER *t);
+
+#endif /* __GROOT_WHEEL_H__ */
@@ -0,0 +1,259 @@
+/**
+ * @file
+ * 	GROOT wire format.
+ * @details
+ * 	Packets are written and read a field at a time at the offsets in groot-wire.h.
+ * 	The checks below stop the build when a struct no longer matches its codec.
+ */
+
+#include "groot-wire.h"
+#include "string.h"
+#include <stddef.h>
+
+/**
+ * @brief Stop the build when the condition does not hold
+ */
+#define WIRE_CHECK(name, condition) typedef char wire_check_##name[(condition) ? 1 : -1]
+
+struct WIRE_ADDR_ALIGN{
+	uint8_t before;
+	rimeaddr_t addr;
+};
+
+//Addresses are read in place at odd offsets
+WIRE_CHECK(addr_bytes, sizeof(rimeaddr_t) == 2);
+WIRE_CHECK(addr_align, offsetof(struct WIRE_ADDR_ALIGN, addr) == 1);
+WIRE_CHECK(float_bytes, sizeof(float) == 4);
+WIRE_CHECK(hdr_bytes, GROOT_WIRE_HDR_BYTES == GROOT_WIRE_HDR_EPOCH_OFFSET + 2);
+WIRE_CHECK(version, GROOT_VERSION <= 0x0F);
+WIRE_CHECK(capability, (GROOT_SENSOR_BIT(SENSOR_CO2) | GROOT_SENSOR_BIT(SENSOR_NO) | GROOT_SENSOR_BIT(SENSOR_TEMP) |
+	GROOT_SENSOR_BIT(SENSOR_HUMIDITY)) == GROOT_WIRE_CAPABILITY);
+WIRE_CHECK(qry_bytes, GROOT_WIRE_QRY_WHERE == GROOT_WIRE_QRY_EPSILON + 1);
+WIRE_CHECK(rec_bytes, GROOT_WIRE_REC_QUERY == GROOT_WIRE_REC_EPOCH_OFFSET + 2);
+//A counter added to GROOT_STATS needs GROOT_WIRE_STATS_LENGTH raised
+WIRE_CHECK(stats_counters, sizeof(struct GROOT_STATS) == GROOT_WIRE_STATS_LENGTH*sizeof(uint16_t));
+WIRE_CHECK(stats_fit, GROOT_WIRE_HDR_MAX + GROOT_WIRE_STATS_BYTES <= PACKETBUF_SIZE);
+WIRE_CHECK(record_fits, GROOT_WIRE_HDR_MAX + GROOT_WIRE_REC_MAX <= PACKETBUF_SIZE);
+
+static void
+wire_put_addr(uint8_t *buf, const rimeaddr_t *addr){
+	buf[0] = addr->u8[0];
+	buf[1] = addr->u8[1];
+}
+
+static void
+wire_addr(const uint8_t *buf, rimeaddr_t *addr){
+	addr->u8[0] = buf[0];
+	addr->u8[1] = buf[1];
+}
+
+/**
+ * @brief Query floods carry the key of their query
+ */
+static uint8_t
+wire_keyed(uint8_t type){
+	return type == GROOT_SUBSCRIBE_TYPE || type == GROOT_ALTERATION_TYPE || type == GROOT_UNSUBSCRIBE_TYPE;
+}
+
+uint8_t
+groot_wire_is_groot(const uint8_t *buf, uint16_t len){
+	if(len < GROOT_WIRE_HDR_BYTES || buf[GROOT_WIRE_HDR_PROTOCOL] != (GROOT_WIRE_MAGIC | GROOT_VERSION)){
+		return 0;
+	}
+	return len >= GROOT_HDR_SIZE(buf);
+}
+
+uint8_t
+groot_wire_hdr_write(uint8_t *buf, const struct GROOT_HEADER *hdr){
+	uint8_t flags = hdr->capability & GROOT_WIRE_CAPABILITY, *at = buf + GROOT_WIRE_HDR_BYTES;
+
+	if(hdr->is_cluster_head){
+		flags |= GROOT_WIRE_CLUSTER;
+	}
+	if((hdr->to.u8[0] != 0 || hdr->to.u8[1] != 0) && hdr->type != GROOT_CLUSTER_JOIN_TYPE){
+		flags |= GROOT_WIRE_TO;
+		wire_put_addr(at, &hdr->to);
+		at += GROOT_WIRE_TO_BYTES;
+	}
+	if(hdr->handle != 0){
+		flags |= GROOT_WIRE_SINK;
+		wire_put_addr(at, &hdr->ereceiver);
+		at += GROOT_WIRE_SINK_BYTES;
+	}
+	if(wire_keyed(hdr->type)){
+		flags |= GROOT_WIRE_KEY;
+		GROOT_WIRE_PUT_U16(at, GROOT_WIRE_KEY_QUERY_ID, hdr->query_id);
+		wire_put_addr(at + GROOT_WIRE_KEY_RECEIVED_FROM, &hdr->received_from);
+		at += GROOT_WIRE_KEY_BYTES;
+	}
+
+	buf[GROOT_WIRE_HDR_PROTOCOL] = GROOT_WIRE_MAGIC | (hdr->protocol.version & 0x0F);
+	buf[GROOT_WIRE_HDR_TYPE] = hdr->type;
+	buf[GROOT_WIRE_HDR_FLAGS] = flags;
+	buf[GROOT_WIRE_HDR_HANDLE] = hdr->handle;
+	buf[GROOT_WIRE_HDR_DEPTH] = hdr->depth;
+	buf[GROOT_WIRE_HDR_HEIGHT] = hdr->height;
+	buf[GROOT_WIRE_HDR_SPAN] = hdr->span;
+	GROOT_WIRE_PUT_U16(buf, GROOT_WIRE_HDR_EPOCH_OFFSET, hdr->epoch_offset);
+	return at - buf;
+}
+
+uint8_t
+groot_wire_hdr_read(const uint8_t *buf, struct GROOT_HEADER *hdr){
+	uint8_t flags = buf[GROOT_WIRE_HDR_FLAGS];
+	const uint8_t *at = buf + GROOT_WIRE_HDR_BYTES;
+
+	memset(hdr, 0, sizeof(struct GROOT_HEADER));
+	hdr->protocol.version = buf[GROOT_WIRE_HDR_PROTOCOL] & 0x0F;
+	hdr->protocol.magic[0] = 'G';
+	hdr->protocol.magic[1] = 'T';
+	hdr->type = buf[GROOT_WIRE_HDR_TYPE];
+	hdr->is_cluster_head = (flags & GROOT_WIRE_CLUSTER) != 0;
+	hdr->capability = flags & GROOT_WIRE_CAPABILITY;
+	hdr->handle = buf[GROOT_WIRE_HDR_HANDLE];
+	hdr->depth = buf[GROOT_WIRE_HDR_DEPTH];
+	hdr->height = buf[GROOT_WIRE_HDR_HEIGHT];
+	hdr->span = buf[GROOT_WIRE_HDR_SPAN];
+	hdr->epoch_offset = GROOT_WIRE_U16(buf, GROOT_WIRE_HDR_EPOCH_OFFSET);
+	if(flags & GROOT_WIRE_TO){
+		wire_addr(at, &hdr->to);
+		at += GROOT_WIRE_TO_BYTES;
+	}
+	if(flags & GROOT_WIRE_SINK){
+		wire_addr(at, &hdr->ereceiver);
+		at += GROOT_WIRE_SINK_BYTES;
+	}
+	if(flags & GROOT_WIRE_KEY){
+		hdr->query_id = GROOT_WIRE_U16(at, GROOT_WIRE_KEY_QUERY_ID);
+		wire_addr(at + GROOT_WIRE_KEY_RECEIVED_FROM, &hdr->received_from);
+		at += GROOT_WIRE_KEY_BYTES;
+	}
+	return at - buf;
+}
+
+uint8_t
+groot_wire_qry_size(const struct GROOT_QUERY *qry){
+	return GROOT_WIRE_QRY_BYTES + ((qry->aggregator == GROOT_QUANTILE) ? GROOT_WIRE_RANGE_BYTES : 0);
+}
+
+uint8_t
+groot_wire_qry_write(uint8_t *buf, const struct GROOT_QUERY *qry){
+	const struct GROOT_SENSORS *sensors = &qry->sensors_required;
+	uint8_t i, *where = buf + GROOT_WIRE_QRY_WHERE;
+
+	GROOT_WIRE_PUT_U16(buf, GROOT_WIRE_QRY_SAMPLE_ID, qry->sample_id);
+	GROOT_WIRE_PUT_U16(buf, GROOT_WIRE_QRY_SAMPLE_RATE, qry->sample_rate);
+	buf[GROOT_WIRE_QRY_AGGREGATOR] = qry->aggregator;
+	buf[GROOT_WIRE_QRY_VERSION] = qry->version;
+	buf[GROOT_WIRE_QRY_ERROR] = qry->error;
+	buf[GROOT_WIRE_QRY_SENSORS] = ((sensors->co2 == 1) ? GROOT_SENSOR_BIT(SENSOR_CO2) : 0) |
+		((sensors->no == 1) ? GROOT_SENSOR_BIT(SENSOR_NO) : 0) |
+		((sensors->temp == 1) ? GROOT_SENSOR_BIT(SENSOR_TEMP) : 0) |
+		((sensors->humidity == 1) ? GROOT_SENSOR_BIT(SENSOR_HUMIDITY) : 0);
+	buf[GROOT_WIRE_QRY_EPSILON] = qry->epsilon;
+	for(i = 0; i < GROOT_WHERE_LIMIT; i++){
+		where[0] = qry->where.term[i];
+		GROOT_WIRE_PUT_U16(where, 1, qry->where.value[i]);
+		where += GROOT_WIRE_WHERE_BYTES;
+	}
+	if(qry->aggregator == GROOT_QUANTILE){
+		GROOT_WIRE_PUT_U16(where, GROOT_WIRE_RANGE_LOW, qry->low);
+		GROOT_WIRE_PUT_U16(where, GROOT_WIRE_RANGE_HIGH, qry->high);
+	}
+	return groot_wire_qry_size(qry);
+}
+
+uint8_t
+groot_wire_qry_read(const uint8_t *buf, struct GROOT_QUERY *qry){
+	uint8_t i, sensors = buf[GROOT_WIRE_QRY_SENSORS];
+	const uint8_t *where = buf + GROOT_WIRE_QRY_WHERE;
+
+	qry->sample_id = GROOT_WIRE_U16(buf, GROOT_WIRE_QRY_SAMPLE_ID);
+	qry->sample_rate = GROOT_WIRE_U16(buf, GROOT_WIRE_QRY_SAMPLE_RATE);
+	qry->aggregator = buf[GROOT_WIRE_QRY_AGGREGATOR];
+	qry->version = buf[GROOT_WIRE_QRY_VERSION];
+	qry->error = buf[GROOT_WIRE_QRY_ERROR];
+	qry->sensors_required.co2 = (sensors & GROOT_SENSOR_BIT(SENSOR_CO2)) != 0;
+	qry->sensors_required.no = (sensors & GROOT_SENSOR_BIT(SENSOR_NO)) != 0;
+	qry->sensors_required.temp = (sensors & GROOT_SENSOR_BIT(SENSOR_TEMP)) != 0;
+	qry->sensors_required.humidity = (sensors & GROOT_SENSOR_BIT(SENSOR_HUMIDITY)) != 0;
+	qry->epsilon = buf[GROOT_WIRE_QRY_EPSILON];
+	for(i = 0; i < GROOT_WHERE_LIMIT; i++){
+		qry->where.term[i] = where[0];
+		qry->where.value[i] = (int16_t)GROOT_WIRE_U16(where, 1);
+		where += GROOT_WIRE_WHERE_BYTES;
+	}
+	qry->low = GROOT_HISTOGRAM_LOW;
+	qry->high = GROOT_HISTOGRAM_HIGH;
+	if(qry->aggregator == GROOT_QUANTILE){
+		qry->low = (int16_t)GROOT_WIRE_U16(where, GROOT_WIRE_RANGE_LOW);
+		qry->high = (int16_t)GROOT_WIRE_U16(where, GROOT_WIRE_RANGE_HIGH);
+	}
+	return groot_wire_qry_size(qry);
+}
+
+uint8_t
+groot_wire_rec_write(uint8_t *buf, const struct GROOT_BATCH_RECORD *rec){
+	buf[GROOT_WIRE_REC_HANDLE] = rec->handle;
+	wire_put_addr(buf + GROOT_WIRE_REC_ERECEIVER, &rec->ereceiver);
+	buf[GROOT_WIRE_REC_CLUSTER] = rec->is_cluster_head;
+	buf[GROOT_WIRE_REC_DEPTH] = rec->depth;
+	buf[GROOT_WIRE_REC_HEIGHT] = rec->height;
+	buf[GROOT_WIRE_REC_SPAN] = rec->span;
+	GROOT_WIRE_PUT_U16(buf, GROOT_WIRE_REC_EPOCH_OFFSET, rec->epoch_offset);
+	return GROOT_WIRE_REC_QUERY + groot_wire_qry_write(buf + GROOT_WIRE_REC_QUERY, &rec->query);
+}
+
+uint8_t
+groot_wire_rec_read(const uint8_t *buf, struct GROOT_BATCH_RECORD *rec){
+	rec->handle = buf[GROOT_WIRE_REC_HANDLE];
+	wire_addr(buf + GROOT_WIRE_REC_ERECEIVER, &rec->ereceiver);
+	rec->is_cluster_head = buf[GROOT_WIRE_REC_CLUSTER];
+	rec->depth = buf[GROOT_WIRE_REC_DEPTH];
+	rec->height = buf[GROOT_WIRE_REC_HEIGHT];
+	rec->span = buf[GROOT_WIRE_REC_SPAN];
+	rec->epoch_offset = GROOT_WIRE_U16(buf, GROOT_WIRE_REC_EPOCH_OFFSET);
+	return GROOT_WIRE_REC_QUERY + groot_wire_qry_read(buf + GROOT_WIRE_REC_QUERY, &rec->query);
+}
+
+void
+groot_wire_stats_write(uint8_t *buf, const struct GROOT_STATS_REPORT *report){
+	uint16_t counters[GROOT_WIRE_STATS_LENGTH];
+	uint8_t i;
+
+	wire_put_addr(buf + GROOT_WIRE_STATS_NODE, &report->node);
+	memcpy(counters, &report->stats, sizeof(counters));
+	for(i = 0; i < GROOT_WIRE_STATS_LENGTH; i++){
+		GROOT_WIRE_PUT_U16(buf, GROOT_WIRE_STATS_COUNTERS + 2*i, counters[i]);
+	}
+}
+
+void
+groot_wire_stats_read(const uint8_t *buf, struct GROOT_STATS_REPORT *report){
+	uint16_t counters[GROOT_WIRE_STATS_LENGTH];
+	uint8_t i;
+
+	wire_addr(buf + GROOT_WIRE_STATS_NODE, &report->node);
+	for(i = 0; i < GROOT_WIRE_STATS_LENGTH; i++){
+		counters[i] = GROOT_WIRE_U16(buf, GROOT_WIRE_STATS_COUNTERS + 2*i);
+	}
+	memcpy(&report->stats, counters, sizeof(counters));
+}
+
+void
+groot_wire_put_float(uint8_t *buf, float value){
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	GROOT_WIRE_PUT_U16(buf, 0, bits & 0xFFFF);
+	GROOT_WIRE_PUT_U16(buf, 2, bits >> 16);
+}
+
+float
+groot_wire_float(const uint8_t *buf){
+	uint32_t bits = GROOT_WIRE_U16(buf, 0) | ((uint32_t)GROOT_WIRE_U16(buf, 2) << 16);
+	float value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file
+ * 	Header file for the GROOT wire format.
+ * @details
+ * 	Every field of a packet has a fixed byte offset. 16-bit fields are little endian
+ * 	and floats are their IEEE 754 bits, little endian, so motes of any architecture
+ * 	and compiler read the same packet. The in-memory structs are only the decoded
+ * 	form and are never sent as they are.
+ */
+#ifndef __GROOT_WIRE_H__
+#define __GROOT_WIRE_H__
+
+#include "contiki.h"
+#include "groot.h"
+
+/**
+ * Header. Protocol, type, flags, query handle, depth, height, span and epoch offset.
+ * The protocol byte is GROOT_WIRE_MAGIC and the version in the low 4 bits
+ */
+#define GROOT_WIRE_HDR_PROTOCOL 0
+#define GROOT_WIRE_HDR_TYPE 1
+#define GROOT_WIRE_HDR_FLAGS 2
+#define GROOT_WIRE_HDR_HANDLE 3
+#define GROOT_WIRE_HDR_DEPTH 4
+#define GROOT_WIRE_HDR_HEIGHT 5
+#define GROOT_WIRE_HDR_SPAN 6
+#define GROOT_WIRE_HDR_EPOCH_OFFSET 7
+#define GROOT_WIRE_HDR_BYTES 9 //Without the optional fields
+#define GROOT_WIRE_MAGIC 0xA0
+
+/**
+ * Header flags. The capability takes the low 4 bits
+ */
+#define GROOT_WIRE_CAPABILITY 0x0F
+#define GROOT_WIRE_CLUSTER 0x10
+#define GROOT_WIRE_TO 0x20 //to follows
+#define GROOT_WIRE_SINK 0x40 //ereceiver follows, after to if set
+#define GROOT_WIRE_KEY 0x80 //query id and received from follow, last
+
+/**
+ * Optional header fields, in this order. Joins go by runicast, which carries the
+ * receiver, and floods have none, so only publishes, batches and stats reports
+ * carry to. Every frame of a query carries its sink, which keys it with the
+ * handle. Floods also carry the query id so nodes learn it.
+ */
+#define GROOT_WIRE_TO_BYTES 2
+#define GROOT_WIRE_SINK_BYTES 2
+#define GROOT_WIRE_KEY_QUERY_ID 0
+#define GROOT_WIRE_KEY_RECEIVED_FROM 2
+#define GROOT_WIRE_KEY_BYTES 4
+#define GROOT_WIRE_HDR_MAX (GROOT_WIRE_HDR_BYTES + GROOT_WIRE_TO_BYTES + GROOT_WIRE_SINK_BYTES + GROOT_WIRE_KEY_BYTES)
+
+/**
+ * Query. The sensors are one byte of GROOT_SENSOR_BIT, the predicates a term
+ * byte and a 16-bit value each. GROOT_QUANTILE queries go on with the range of
+ * their digest, so the query is GROOT_QRY_SIZE bytes
+ */
+#define GROOT_WIRE_QRY_SAMPLE_ID 0
+#define GROOT_WIRE_QRY_SAMPLE_RATE 2
+#define GROOT_WIRE_QRY_AGGREGATOR 4
+#define GROOT_WIRE_QRY_VERSION 5
+#define GROOT_WIRE_QRY_ERROR 6
+#define GROOT_WIRE_QRY_SENSORS 7
+#define GROOT_WIRE_QRY_EPSILON 8
+#define GROOT_WIRE_QRY_WHERE 9
+#define GROOT_WIRE_WHERE_BYTES 3
+#define GROOT_WIRE_QRY_BYTES (GROOT_WIRE_QRY_WHERE + GROOT_WHERE_LIMIT*GROOT_WIRE_WHERE_BYTES) //Without the range
+#define GROOT_WIRE_RANGE_LOW 0
+#define GROOT_WIRE_RANGE_HIGH 2
+#define GROOT_WIRE_RANGE_BYTES 4
+#define GROOT_WIRE_QRY_MAX (GROOT_WIRE_QRY_BYTES + GROOT_WIRE_RANGE_BYTES)
+
+/**
+ * Batch record. The header fields that differ between publishes, then the query,
+ * so the record is GROOT_REC_SIZE bytes. The packed partial state follows
+ */
+#define GROOT_WIRE_REC_HANDLE 0
+#define GROOT_WIRE_REC_ERECEIVER 1
+#define GROOT_WIRE_REC_CLUSTER 3
+#define GROOT_WIRE_REC_DEPTH 4
+#define GROOT_WIRE_REC_HEIGHT 5
+#define GROOT_WIRE_REC_SPAN 6
+#define GROOT_WIRE_REC_EPOCH_OFFSET 7
+#define GROOT_WIRE_REC_QUERY 9
+#define GROOT_WIRE_REC_BYTES (GROOT_WIRE_REC_QUERY + GROOT_WIRE_QRY_BYTES) //Without the range
+#define GROOT_WIRE_REC_MAX (GROOT_WIRE_REC_QUERY + GROOT_WIRE_QRY_MAX)
+
+/**
+ * Stats report. The node, then every GROOT_STATS counter in the order of the struct
+ */
+#define GROOT_WIRE_STATS_NODE 0
+#define GROOT_WIRE_STATS_COUNTERS 2
+#define GROOT_WIRE_STATS_LENGTH 11 //Counters in GROOT_STATS
+#define GROOT_WIRE_STATS_BYTES (GROOT_WIRE_STATS_COUNTERS + 2*GROOT_WIRE_STATS_LENGTH)
+
+/**
+ * @brief Read a field of a packet in place
+ * @details The high byte is widened before the shift. A byte promotes to a signed int,
+ *          which a shift by 8 can overflow where int is 16 bits
+ */
+#define GROOT_WIRE_U8(buf, offset) (((const uint8_t *)(buf))[offset])
+#define GROOT_WIRE_U16(buf, offset) ((uint16_t)(GROOT_WIRE_U8(buf, offset) | ((uint16_t)GROOT_WIRE_U8(buf, (offset) + 1) << 8)))
+#define GROOT_WIRE_ADDR(buf, offset) ((const rimeaddr_t *)((const uint8_t *)(buf) + (offset)))
+
+/**
+ * @brief Write a field of a packet
+ */
+#define GROOT_WIRE_PUT_U16(buf, offset, value) do { \
+		((uint8_t *)(buf))[offset] = (uint16_t)(value) & 0xFF; \
+		((uint8_t *)(buf))[(offset) + 1] = (uint16_t)(value) >> 8; \
+	} while(0)
+
+/**
+ * @brief Header fields of a packet, read in place. GROOT_HDR_TO only with GROOT_WIRE_TO
+ */
+#define GROOT_HDR_TYPE(buf) GROOT_WIRE_U8(buf, GROOT_WIRE_HDR_TYPE)
+#define GROOT_HDR_FLAGS(buf) GROOT_WIRE_U8(buf, GROOT_WIRE_HDR_FLAGS)
+#define GROOT_HDR_HANDLE(buf) GROOT_WIRE_U8(buf, GROOT_WIRE_HDR_HANDLE)
+#define GROOT_HDR_TO(buf) GROOT_WIRE_ADDR(buf, GROOT_WIRE_HDR_BYTES)
+
+/**
+ * @brief Bytes of the header of a packet, read from its flags
+ */
+#define GROOT_HDR_SIZE(buf) (GROOT_WIRE_HDR_BYTES + ((GROOT_HDR_FLAGS(buf) & GROOT_WIRE_TO) ? GROOT_WIRE_TO_BYTES : 0) + \
+	((GROOT_HDR_FLAGS(buf) & GROOT_WIRE_SINK) ? GROOT_WIRE_SINK_BYTES : 0) + \
+	((GROOT_HDR_FLAGS(buf) & GROOT_WIRE_KEY) ? GROOT_WIRE_KEY_BYTES : 0))
+
+/**
+ * @brief Query fields of a packet, read in place from the start of the query
+ */
+#define GROOT_QRY_AGGREGATOR(buf) GROOT_WIRE_U8(buf, GROOT_WIRE_QRY_AGGREGATOR)
+#define GROOT_QRY_VERSION(buf) GROOT_WIRE_U8(buf, GROOT_WIRE_QRY_VERSION)
+
+/**
+ * @brief Bytes of a query or a batch record, read from its aggregator
+ */
+#define GROOT_QRY_SIZE(buf) (GROOT_WIRE_QRY_BYTES + ((GROOT_QRY_AGGREGATOR(buf) == GROOT_QUANTILE) ? GROOT_WIRE_RANGE_BYTES : 0))
+#define GROOT_REC_SIZE(buf) (GROOT_WIRE_REC_QUERY + GROOT_QRY_SIZE((const uint8_t *)(buf) + GROOT_WIRE_REC_QUERY))
+
+/**
+ * @brief Check the protocol byte of a packet
+ * @details The packet must also hold its whole header
+ *
+ * @param buf Packet
+ * @param len Bytes in the packet
+ * @return 1 GROOT packet 0 otherwise
+ */
+uint8_t
+groot_wire_is_groot(const uint8_t *buf, uint16_t len);
+
+/**
+ * @brief Write a header
+ * @details to is only written when it is set and the packet is not a join,
+ *          ereceiver when the packet names a query and the key only for query floods.
+ *
+ * @param buf Where it is written. Needs GROOT_WIRE_HDR_MAX
+ * @param GROOT_HEADER Header to write
+ * @return bytes written
+ */
+uint8_t
+groot_wire_hdr_write(uint8_t *buf, const struct GROOT_HEADER *hdr);
+
+/**
+ * @brief Read a header
+ * @details Fields the packet does not carry are left null. query_id is 0 without
+ *          the key.
+ *
+ * @param buf Where it is read from. Holds GROOT_HDR_SIZE(buf)
+ * @param GROOT_HEADER Where the header is stored
+ * @return bytes read
+ */
+uint8_t
+groot_wire_hdr_read(const uint8_t *buf, struct GROOT_HEADER *hdr);
+
+/**
+ * @brief Bytes of a query on the wire
+ * @details Bytes of a query on the wire
+ *
+ * @param GROOT_QUERY Query
+ * @return bytes
+ */
+uint8_t
+groot_wire_qry_size(const struct GROOT_QUERY *qry);
+
+/**
+ * @brief Write a query
+ * @details Write a query
+ *
+ * @param buf Where it is written. Needs GROOT_WIRE_QRY_MAX
+ * @param GROOT_QUERY Query to write
+ * @return bytes written
+ */
+uint8_t
+groot_wire_qry_write(uint8_t *buf, const struct GROOT_QUERY *qry);
+
+/**
+ * @brief Read a query
+ * @details A query without a range takes GROOT_HISTOGRAM_LOW..HIGH
+ *
+ * @param buf Where it is read from. Holds GROOT_QRY_SIZE(buf)
+ * @param GROOT_QUERY Where the query is stored
+ * @return bytes read
+ */
+uint8_t
+groot_wire_qry_read(const uint8_t *buf, struct GROOT_QUERY *qry);
+
+/**
+ * @brief Write a batch record without its partial state
+ * @details Write a batch record without its partial state
+ *
+ * @param buf Where it is written. Needs GROOT_WIRE_REC_MAX
+ * @param GROOT_BATCH_RECORD Record to write
+ * @return bytes written
+ */
+uint8_t
+groot_wire_rec_write(uint8_t *buf, const struct GROOT_BATCH_RECORD *rec);
+
+/**
+ * @brief Read a batch record without its partial state
+ * @details Read a batch record without its partial state
+ *
+ * @param buf Where it is read from. Holds GROOT_REC_SIZE(buf)
+ * @param GROOT_BATCH_RECORD Where the record is stored
+ * @return bytes read
+ */
+uint8_t
+groot_wire_rec_read(const uint8_t *buf, struct GROOT_BATCH_RECORD *rec);
+
+/**
+ * @brief Write a stats report
+ * @details Write a stats report
+ *
+ * @param buf Where it is written. Needs GROOT_WIRE_STATS_BYTES
+ * @param GROOT_STATS_REPORT Report to write
+ */
+void
+groot_wire_stats_write(uint8_t *buf, const struct GROOT_STATS_REPORT *report);
+
+/**
+ * @brief Read a stats report
+ * @details Read a stats report
+ *
+ * @param buf Where it is read from. Holds GROOT_WIRE_STATS_BYTES
+ * @param GROOT_STATS_REPORT Where the report is stored
+ */
+void
+groot_wire_stats_read(const uint8_t *buf, struct GROOT_STATS_REPORT *report);
+
+/**
+ * @brief Write a float
+ * @details Write a float
+ *
+ * @param buf Where it is written. Needs 4 bytes
+ * @param value Float to write
+ */
+void
+groot_wire_put_float(uint8_t *buf, float value);
+
+/**
+ * @brief Read a float
+ * @details Read a float
+ *
+ * @param buf Where it is read from. Holds 4 bytes
+ * @return float read
+ */
+float
+groot_wire_float(const uint8_t *buf);
+
+#endif /* __GROOT_WIRE_H__ */
@@ -7,59 +7,66 @@
 
 #include "contiki.h"
 #include "groot.h"
+#include "groot-aggregate.h"
+#include "groot-wire.h"
+#include "groot-wheel.h"
+#include "groot-trickle.h"
+#include "groot-trace.h"
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "stdio.h"
 #include "string.h"
 
-#define PRINT2ADDR(addr) printf("%02x%02x", (addr)->u8[1], (addr)->u8[0])
+#define PRINT2ADDR(addr) GROOT_PRINTF("%02x%02x", (addr)->u8[1], (addr)->u8[0])
+//Count an event for the node and for the query
+#define GROOT_STAT(itm, counter) do{ glocal.stats.counter += 1; (itm)->stats.counter += 1; }while(0)
 
 LIST(groot_qry_table);
 MEMB(groot_qrys, struct GROOT_QUERY_ITEM, GROOT_QUERY_LIMIT);
-MEMB(groot_children, struct GROOT_SRT_CHILD, GROOT_QUERY_LIMIT*(GROOT_CHILD_LIMIT+1));
+//Open addressing index on (query_id, ereceiver) into the groot_qrys items
+static struct GROOT_QUERY_ITEM *groot_qry_index[GROOT_QUERY_INDEX_SIZE];
+//Readings shared by the queries sampled on this node
+static struct GROOT_SAMPLE_CACHE groot_samples;
+//Publishes waiting for their coalescing window to end
+static struct GROOT_BATCH groot_batches[GROOT_BATCH_PARENTS];
 
-static void cb_publish_aggregate(void *i);
+static struct GROOT_NEIGHBORS groot_neighbors;
 
 static struct GROOT_LOCAL glocal;
 /*------------------------------------------------- Debug Methods -------------------------------------------------------*/
-static void
-print_raw_packetbuf(void){
-	uint16_t i;
-	for(i = 0; i < packetbuf_hdrlen(); i++) {
-		printf("%02x ", *(char *)(packetbuf_hdrptr() + i));
-	}
-	printf("| ");
-	for(i = 0; i < packetbuf_datalen(); i++) {
-		printf("%02x ", *(char *)(packetbuf_dataptr() + i));
-	}
-	printf("[%d]\n", (int16_t) (packetbuf_dataptr() - packetbuf_hdrptr()));
-}
-
 static void
 print_hdr(struct GROOT_HEADER *hdr){
-	printf("HEADER ");
+	GROOT_PRINTF("HEADER ");
 	PRINT2ADDR(&rimeaddr_node_addr);
-	printf(" - { Source: ");
+	GROOT_PRINTF(" - { Source: ");
 	PRINT2ADDR(&hdr->ereceiver);
-	printf(" Destination: ");
+	GROOT_PRINTF(" Destination: ");
 	PRINT2ADDR(&hdr->ereceiver);
-	printf(" Version: %d MAGIC: %c%c ", hdr->protocol.version, hdr->protocol.magic[0], hdr->protocol.magic[1]);
-	printf("Type: %02x Query ID: %d } \n", hdr->type, hdr->query_id);
+	GROOT_PRINTF(" Version: %d MAGIC: %c%c ", hdr->protocol.version, hdr->protocol.magic[0], hdr->protocol.magic[1]);
+	GROOT_PRINTF("Type: %02x Query ID: %d } \n", hdr->type, hdr->query_id);
 }
 
 static void
-print_qry(struct GROOT_QUERY *qry){
-	printf("QUERY ");
+print_data(struct GROOT_SENSORS_DATA *data){
+	GROOT_PRINTF("DATA ");
 	PRINT2ADDR(&rimeaddr_node_addr);
-	printf(" - { Sample Rate: %d Aggregator: %d } - ", qry->sample_rate, qry->aggregator);
-	printf(" { CO2 - %d NO - %d TEMP - %d HUMIDITY - %d } \n", qry->sensors_required.co2, qry->sensors_required.no, qry->sensors_required.temp, qry->sensors_required.humidity);
+	GROOT_PRINTF(" - { CO2 %.2f NO - %.2f TEMP - %.2f HUMIDITY - %.2f } \n", data->co2, data->no, data->temp, data->humidity);
 }
 
 static void
-print_data(struct GROOT_SENSORS_DATA *data){
-	printf("DATA ");
-	PRINT2ADDR(&rimeaddr_node_addr);
-	printf(" - { CO2 %.2f NO - %.2f TEMP - %.2f HUMIDITY - %.2f } \n", data->co2, data->no, data->temp, data->humidity);
+print_partial(uint8_t aggregator, struct GROOT_PARTIAL *partial){
+#if DEBUG_LEVEL > 1
+	struct GROOT_SENSORS_DATA data;
+
+	groot_partial_finalize(aggregator, partial, &data);
+	GROOT_PRINTF("READINGS %d - ", partial->count);
+	print_data(&data);
+	if(aggregator == GROOT_QUANTILE){
+		groot_partial_quantile(partial, 95, &data);
+		GROOT_PRINTF("P95 - ");
+		print_data(&data);
+	}
+#endif
 }
 
 static void
@@ -68,42 +75,79 @@ print_qrys(){
 
 	qry_itm = list_head(groot_qry_table);
 	while(qry_itm != NULL){
-		printf(" QUERY ITEM - [ ");
-		printf(" QUERY ID: %d ESENDER: ", qry_itm->query_id);
+		GROOT_PRINTF(" QUERY ITEM - [ ");
+		GROOT_PRINTF(" QUERY ID: %d ESENDER: ", qry_itm->query_id);
 		PRINT2ADDR(&qry_itm->ereceiver);
-		printf(" Parent: ");
+		GROOT_PRINTF(" Parent: ");
 		PRINT2ADDR(&qry_itm->parent);
-		printf(" ] \n");
+		GROOT_PRINTF(" ] \n");
 
 		qry_itm = qry_itm->next;
 	}
 }
 
 static void
-print_children(struct GROOT_SRT_CHILD *first_child){
-	struct GROOT_SRT_CHILD *tmp_child = first_child;
-
-	while(tmp_child != NULL){
-		printf("CHILD ");
-		PRINT2ADDR(&tmp_child->address);
-		printf(" {Last set: %d }\n", tmp_child->last_set);
+print_children(struct GROOT_SRT_CHILDREN *children){
+	uint8_t i;
 
-		tmp_child = tmp_child->next;
+	for(i = 0; i < children->length; i++){
+		GROOT_PRINTF("CHILD ");
+		PRINT2ADDR(&groot_child_slots.address[children->slot[i]]);
+		GROOT_PRINTF(" {Last set: %u }\n", groot_child_slots.last_set[children->slot[i]]);
 	}
 }
 
 /*------------------------------------------------- Other Methods ----------------------------------------------------------*/
 /**
- * @brief Calculate the minimum a child can be idle before removing
- * @details Calculate the minimumum a child can be idle before removing
+ * @brief Check if a query has predicates
+ * @details Nodes of such a query stay silent in epochs their readings do not pass,
+ *          so silence is not taken as a lost child or parent.
+ * 
+ * @param GROOT_QUERY Query
+ * @return 0 false 1 true
+ */
+static uint8_t
+has_where(struct GROOT_QUERY *qry){
+	uint8_t i;
+
+	for(i = 0; i < GROOT_WHERE_LIMIT; i++){
+		if(qry->where.term[i] != 0){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Check if a query only publishes values that changed
+ * @details Queries with predicates already go quiet and keep publishing every epoch
+ * 
+ * @param GROOT_QUERY Query
+ * @return 0 false 1 true
+ */
+static uint8_t
+publishes_on_change(struct GROOT_QUERY *qry){
+	return qry->epsilon > 0 && !has_where(qry);
+}
+
+/**
+ * @brief Calculate the seconds a child or parent can be idle before removing
+ * @details Compared with the GROOT_AGE of its last stamp, so never above GROOT_AGE_MAX
  * 
  * @param GROOT_QUERY_ITEM A query reference
  * @param retries Number of retries before removing
  * @param leeway Random leeway
  */
-static int
-least_idle_time(struct GROOT_QUERY_ITEM *qry_itm, int retries, int leeway){
-	return clock_seconds()-(((qry_itm->query.sample_rate/CLOCK_SECOND) + leeway) * retries);
+static unsigned long
+idle_limit(struct GROOT_QUERY_ITEM *qry_itm, int retries, int leeway){
+	unsigned long limit;
+
+	//Quiet for up to a heartbeat while nothing changes
+	if(publishes_on_change(&qry_itm->query)){
+		retries += GROOT_HEARTBEAT;
+	}
+	limit = ((qry_itm->query.sample_rate/CLOCK_SECOND) + leeway) * retries;
+	return (limit > GROOT_AGE_MAX) ? GROOT_AGE_MAX : limit;
 }
 
 /**
@@ -118,212 +162,632 @@ copy_qry(struct GROOT_QUERY *target, struct GROOT_QUERY *src){
 	target->sample_id = src->sample_id;
 	target->sample_rate = src->sample_rate;
 	target->aggregator = src->aggregator;
+	target->version = src->version;
+	target->error = src->error;
+	target->epsilon = src->epsilon;
 	memcpy(&target->sensors_required, &src->sensors_required, sizeof(struct GROOT_SENSORS));
+	memcpy(&target->where, &src->where, sizeof(struct GROOT_WHERE));
+	target->low = src->low;
+	target->high = src->high;
 }
 
 /**
  * @brief Get Query from packet buffer
- * @details Get Query from packet buffer
- * @return pointer to query in packet buf
+ * @details Its fields are read in place with GROOT_QRY_*
+ * @return start of the query in packet buf or NULL if the packet is too short
  */
-static struct GROOT_QUERY
-*packetbuf_get_qry(){
-	return (struct GROOT_QUERY*) (packetbuf_dataptr() + sizeof(struct GROOT_HEADER));
+static const uint8_t
+*packetbuf_qry(void){
+	const uint8_t *buf = (const uint8_t *)packetbuf_dataptr() + GROOT_HDR_SIZE(packetbuf_dataptr());
+
+	//The aggregator, which tells the size, is in the part every query has
+	if(packetbuf_datalen() < GROOT_HDR_SIZE(packetbuf_dataptr()) + GROOT_WIRE_QRY_BYTES ||
+		packetbuf_datalen() < GROOT_HDR_SIZE(packetbuf_dataptr()) + GROOT_QRY_SIZE(buf)){
+		return NULL;
+	}
+	return buf;
 }
 
 /**
- * @brief Get Data from packet buffer
- * @details Get Data from packet buffer
- * @return pointer to query in packet buf
+ * @brief Read the query of the packet buffer
+ * @details Read the query of the packet buffer
+ * 
+ * @param GROOT_QUERY Where the query is stored
+ * @return 1 read 0 packet too short
  */
-static struct GROOT_SENSORS_DATA
-*packetbuf_get_sensor_data(){
-	return (struct GROOT_SENSORS_DATA *) (packetbuf_dataptr() + sizeof(struct GROOT_HEADER) + sizeof(struct GROOT_QUERY));
+static uint8_t
+packetbuf_get_qry(struct GROOT_QUERY *qry){
+	const uint8_t *buf = packetbuf_qry();
+
+	if(buf == NULL){
+		return 0;
+	}
+	groot_wire_qry_read(buf, qry);
+	return 1;
 }
 
 /**
- * @brief Randomly generate values for sensors. 0 signals empty
+ * @brief Get the partial state from packet buffer
+ * @details Unpacked for the query that precedes it
+ * 
+ * @param GROOT_QUERY Query of the packet
+ * @param GROOT_PARTIAL Where the state is stored
+ * @return 1 read 0 packet too short
+ */
+static uint8_t
+packetbuf_get_partial(const struct GROOT_QUERY *qry, struct GROOT_PARTIAL *partial){
+	uint16_t offset = GROOT_HDR_SIZE(packetbuf_dataptr()) + groot_wire_qry_size(qry);
+
+	if(packetbuf_datalen() < offset){
+		return 0;
+	}
+	return groot_partial_unpack(qry, (uint8_t *)packetbuf_dataptr() + offset, packetbuf_datalen() - offset, partial) > 0;
+}
+
+/**
+ * @brief Randomly generate a value for a sensor
  * @details Since we do not know what sensors the sensor has, this method simulates results.
+ *          With GROOT_SENSOR_DRIFT readings walk from the last one like a slowly changing signal.
+ * 
+ * @param sensor Sensor type to read
+ */
+static float
+read_sensor(uint8_t sensor){
+	uint8_t i = sensor - 1;
+	int reading;
+
+	if(GROOT_SENSOR_DRIFT == 0 || (groot_samples.valid & (1 << i)) == 0){
+		return (rand()%(90))+10;
+	}
+
+	//Walk from the last reading
+	reading = (int)groot_samples.value[i] + rand()%(2*GROOT_SENSOR_DRIFT + 1) - GROOT_SENSOR_DRIFT;
+	if(reading < 10){
+		reading = 10;
+	} else if(reading > 99){
+		reading = 99;
+	}
+	return reading;
+}
+
+/**
+ * @brief Get a reading of a sensor
+ * @details Reuses the last reading when it was taken in the query's current epoch or
+ *          is not older than GROOT_SAMPLE_FRESHNESS. Queries whose epochs the sink
+ *          lined up then read the sensor once an epoch, whatever their slots.
+ * 
+ * @param sensor Sensor type to read
+ * @param epoch Start of the query's current epoch
+ */
+static float
+cached_reading(uint8_t sensor, clock_time_t epoch){
+	uint8_t i = sensor - 1;
+	clock_time_t now = clock_time();
+
+	if((groot_samples.valid & (1 << i)) && ((clock_time_t)(now - groot_samples.taken[i]) <= (clock_time_t)(now - epoch) ||
+		(clock_time_t)(now - groot_samples.taken[i]) <= GROOT_SAMPLE_FRESHNESS)){
+		return groot_samples.value[i];
+	}
+
+	groot_samples.value[i] = read_sensor(sensor);
+	groot_samples.taken[i] = now;
+	groot_samples.valid |= (1 << i);
+	return groot_samples.value[i];
+}
+
+/**
+ * @brief Get values of the sensors required. 0 signals empty
+ * @details Get values of the sensors required. 0 signals empty
  * 
  * @param GROOT_SENSORS Reference to the sensors data requried
  * @param GROOT_SENSORS_DATA Where the actual data should be stored
+ * @param epoch Start of the query's current epoch
  */
 static void
-random_sensor_readings(struct GROOT_SENSORS *required, struct GROOT_SENSORS_DATA *data){
-	if(required->co2 == 1){
-		data->co2 = (rand()%(90))+10;
-	} else {
-		data->co2 = 0;
+sensor_readings(struct GROOT_SENSORS *required, struct GROOT_SENSORS_DATA *data, clock_time_t epoch){
+	data->co2 = (required->co2 == 1) ? cached_reading(SENSOR_CO2, epoch) : 0;
+	data->no = (required->no == 1) ? cached_reading(SENSOR_NO, epoch) : 0;
+	data->temp = (required->temp == 1) ? cached_reading(SENSOR_TEMP, epoch) : 0;
+	data->humidity = (required->humidity == 1) ? cached_reading(SENSOR_HUMIDITY, epoch) : 0;
+}
+
+/**
+ * @brief Depth of the deepest node in the node's branch of the query tree
+ * @details A child of the sink takes the depth below it once that has not grown
+ *          for GROOT_SLOT_SETTLE epochs. Nodes below take it from their parent's
+ *          publishes, or their own deepest depth if that is deeper.
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ * @return depth. 0 not known yet
+ */
+static uint8_t
+branch_span(struct GROOT_QUERY_ITEM *itm){
+	uint16_t levels = itm->depth + itm->height;
+	uint8_t span = itm->span;
+
+	if(itm->depth == 1){
+		span = (itm->steady >= GROOT_SLOT_SETTLE) ? 1 : 0;
 	}
+	if(span == 0){
+		return 0;
+	}
+	if(levels > span){
+		span = (levels > 0xFF) ? 0xFF : levels;
+	}
+	return span;
+}
 
-	if(required->no == 1){
-		data->no = (rand()%(90))+10;
-	} else {
-		data->no = 0;
+/**
+ * @brief Where the query's transmit slot starts in its epoch on this node
+ * @details The epoch is cut into GROOT_SLOT_LENGTH slots and depth d uses the d-th
+ *          slot counted back from the end of the epoch, so a child reports before
+ *          its parent. Trees deeper than the epoch has slots wrap round into the
+ *          epoch before. A branch known to fit in sample_rate/GROOT_SLOT_MIN slots
+ *          is cut into one slot per depth instead, so its readings reach the sink
+ *          within the epoch. A child sees no deeper a branch than its parent and
+ *          gets slots at least as long, which keeps it before the parent.
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ */
+static clock_time_t
+slot_offset(struct GROOT_QUERY_ITEM *itm){
+	uint16_t rate = itm->query.sample_rate;
+	uint16_t slots = branch_span(itm);
+	clock_time_t length, phase;
+
+	if(rate == 0){
+		return 0;
+	}
+	if(slots < rate / GROOT_SLOT_LENGTH || slots > rate / GROOT_SLOT_MIN){
+		slots = rate / GROOT_SLOT_LENGTH;
+	}
+	if(slots == 0){
+		slots = 1;
+	}
+	length = rate / slots;
+	if(length > GROOT_SLOT_LENGTH){
+		length = GROOT_SLOT_LENGTH;
 	}
+	//The node's place in the slot shrinks with it
+	phase = groot_samples.phase * (length - GROOT_BATCH_WINDOW) / (GROOT_SLOT_LENGTH - GROOT_BATCH_WINDOW);
+	return ((clock_time_t)((slots - (itm->depth % slots)) % slots) * length + phase) % rate;
+}
 
-	if(required->temp == 1){
-		data->temp = (rand()%(90))+10;
-	} else {
-		data->temp = 0;
+/**
+ * @brief Ticks the node is into the query's current epoch
+ * @details Moves the start of the epoch up by whole epochs, so it stays within an
+ *          epoch of now and a 16-bit clock_time_t does not wrap past it on nodes
+ *          that do not sample the query.
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ */
+static clock_time_t
+epoch_elapsed(struct GROOT_QUERY_ITEM *itm){
+	uint16_t rate = itm->query.sample_rate;
+	clock_time_t elapsed = clock_time() - itm->epoch;
+
+	if(rate == 0){
+		return 0;
 	}
+	itm->epoch += elapsed - elapsed % rate;
+	return elapsed % rate;
+}
 
-	if(required->humidity == 1){
-		data->humidity = (rand()%(90))+10;
-	} else {
-		data->humidity = 0;
+/**
+ * @brief Time until the query's next transmit slot on this node
+ * @details The slot is kept in the item so the sampler counts the epoch from it
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ */
+static clock_time_t
+slot_delay(struct GROOT_QUERY_ITEM *itm){
+	uint16_t rate = itm->query.sample_rate;
+	clock_time_t elapsed, delay;
+
+	if(rate == 0){
+		return 0;
 	}
+	itm->slot = slot_offset(itm);
+	elapsed = epoch_elapsed(itm);
+	delay = (itm->slot + rate - elapsed) % rate;
+	return (delay == 0) ? rate : delay;
 }
 
 /**
- * @brief Parse through children and get child associated with address
- * @details Parse through children and get child associated with address
+ * @brief Line the epoch of one of the sink's queries up with its other queries
+ * @details A query whose rate is a multiple or a divisor of another query's starts
+ *          its epochs with that query's. Nodes at the same depth then sample queries
+ *          of the same rate on the same tick and read the sensors once for them all.
+ *          Otherwise the epoch starts now.
  * 
- * @param GROOT_SRT_CHILD pointer for start of list
+ * @param GROOT_QUERY_ITEM Query list item of the sink
+ */
+static void
+epoch_align(struct GROOT_QUERY_ITEM *itm){
+	struct GROOT_QUERY_ITEM *other;
+	uint16_t rate = itm->query.sample_rate;
+
+	itm->epoch = clock_time();
+	if(rate == 0){
+		return;
+	}
+	for(other = list_head(groot_qry_table); other != NULL; other = other->next){
+		if(other == itm || other->unsubscribed != 0 || other->query.sample_rate == 0 ||
+			!rimeaddr_cmp(&other->ereceiver, &rimeaddr_node_addr)){
+			continue;
+		}
+		if(rate % other->query.sample_rate == 0 || other->query.sample_rate % rate == 0){
+			itm->epoch = other->epoch;
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Set the epoch fields of a header
+ * @details Depth of the node and how far it is into the query's epoch
+ * 
+ * @param GROOT_HEADER Header to set
+ * @param GROOT_QUERY_ITEM Query list item
+ */
+static void
+hdr_set_epoch(struct GROOT_HEADER *hdr, struct GROOT_QUERY_ITEM *itm){
+	hdr->depth = itm->depth;
+	hdr->height = itm->height;
+	hdr->span = branch_span(itm);
+	hdr->epoch_offset = epoch_elapsed(itm);
+}
+
+/**
+ * @brief Get the index of the child associated with address
+ * @details Scan the children addresses for the child associated with address
+ * 
+ * @param GROOT_SRT_CHILDREN children of the query
  * @param address pointer to address of child needed
  * 
- * @return child poirnter or NULL
+ * @return child index or -1
  */
-static struct GROOT_SRT_CHILD
-*get_child(struct GROOT_SRT_CHILD *first_child, const rimeaddr_t *address){
-	struct GROOT_SRT_CHILD *tmp_child = first_child;
+static int
+get_child(struct GROOT_SRT_CHILDREN *children, const rimeaddr_t *address){
+	uint8_t i;
 
-	while(tmp_child != NULL){
-		if(rimeaddr_cmp(&tmp_child->address, address)){
-			return tmp_child;
+	for(i = 0; i < children->length; i++){
+		if(rimeaddr_cmp(&groot_child_slots.address[children->slot[i]], address)){
+			return i;
 		}
-		tmp_child = tmp_child->next;
 	}
 
-	return NULL;
+	return -1;
 }
 
 /**
- * @brief Calculate list length
- * @details Calculate list length
+ * @brief Add child to table
+ * @details Add child to the end of the table with a slot from the child pool.
+ *          It has no state until it reports
+ * 
+ * @param GROOT_SRT_CHILDREN children of the query
+ * @param address address of the new child
+ * @param last_set GROOT_STAMP of the child's last report
  * 
- * @param GROOT_SRT_CHILD child beginning pointer
+ * @return index of new child or -1 if the table or the pool is full
  */
 static int
-child_length(struct GROOT_SRT_CHILD *first_child){
-	struct GROOT_SRT_CHILD *tmp_children = first_child;
-	int numb_childs = 0;
+add_child(struct GROOT_SRT_CHILDREN *children, const rimeaddr_t *address, uint16_t last_set){
+	uint8_t i = children->length, slot;
 
-	while(tmp_children != NULL){
-		numb_childs += 1;
-		tmp_children = tmp_children->next;
+	if(i >= GROOT_CHILD_LIMIT){
+		return -1;
 	}
+	slot = groot_child_alloc();
+	if(slot == GROOT_NO_SLOT){
+		glocal.stats.memb_failures += 1;
+		return -1;
+	}
+
+	rimeaddr_copy(&groot_child_slots.address[slot], address);
+	groot_child_slots.last_set[slot] = last_set;
+	children->slot[i] = slot;
+	children->length += 1;
+	return i;
+}
+
+/**
+ * @brief Swap two children of the table
+ * @details Swap two children of the table
+ * 
+ * @param GROOT_SRT_CHILDREN children of the query
+ * @param i index of a child
+ * @param j index of a child
+ */
+static void
+swap_child(struct GROOT_SRT_CHILDREN *children, uint8_t i, uint8_t j){
+	uint8_t slot = children->slot[i];
 
-	return numb_childs;
+	children->slot[i] = children->slot[j];
+	children->slot[j] = slot;
 }
 
 /**
- * @brief Get end of list
- * @details Get end of list
+ * @brief Remove Child from table
+ * @details Remove Child from table and give its slot back to the pool. The last
+ *          child is moved into its place
  * 
- * @param GROOT_SRT_CHILD List pointer
- * @return pointer to end of list
+ * @param GROOT_SRT_CHILDREN children of the query
+ * @param i index of child to remove
  */
-static struct GROOT_SRT_CHILD
-*child_lst_tail(struct GROOT_SRT_CHILD *first_child){
-	struct GROOT_SRT_CHILD *tmp_children = first_child;
+static void
+rm_child(struct GROOT_SRT_CHILDREN *children, uint8_t i){
+	uint8_t last = children->length - 1;
 
-	while(tmp_children != NULL){
-		if(tmp_children->next == NULL){
-			return tmp_children;
+	if(i >= children->length){
+		return;
+	}
+
+	if(i < children->present){
+		//Retract its values from the running value
+		groot_running_rm(children, i);
+		//Last child that reported fills the gap so they stay first
+		children->present -= 1;
+		swap_child(children, i, children->present);
+		i = children->present;
+	}
+	swap_child(children, i, last);
+	groot_child_free(children->slot[last]);
+	children->length = last;
+}
+
+/**
+ * @brief Remove every child of a query
+ * @details Remove every child of a query
+ * 
+ * @param GROOT_SRT_CHILDREN children of the query
+ */
+static void
+rm_children(struct GROOT_SRT_CHILDREN *children){
+	while(children->length > 0){
+		children->length -= 1;
+		groot_child_free(children->slot[children->length]);
+	}
+	children->present = 0;
+}
+
+/**
+ * @brief Store the partial state received from a child
+ * @details A child reporting for the first time joins the children that reported.
+ *          An empty state, or one there is no extra left for, only refreshes the child.
+ * 
+ * @param GROOT_SRT_CHILDREN children of the query
+ * @param i index of child
+ * @param GROOT_PARTIAL state received
+ */
+static void
+set_child_data(struct GROOT_SRT_CHILDREN *children, uint8_t i, struct GROOT_PARTIAL *partial){
+	uint8_t first = (i >= children->present);
+
+	if(partial->count > 0 && !groot_child_extra(children, i)){
+		glocal.stats.memb_failures += 1;
+	} else if(partial->count > 0){
+		if(first){
+			//Swap with the first child that has not reported
+			swap_child(children, i, children->present);
+			i = children->present;
+		} else {
+			groot_running_set(children, i, partial);
+		}
+		groot_child_set(children, i, partial);
+		if(first){
+			children->present += 1;
+			groot_running_add(children, i);
 		}
-		tmp_children = tmp_children->next;
 	}
+	groot_child_slots.last_set[children->slot[i]] = GROOT_STAMP();
+}
 
-	return NULL;
+/**
+ * @brief Take a child's partial state out of the aggregate
+ * @details The child stays in the table after the children that reported
+ * 
+ * @param GROOT_SRT_CHILDREN children of the query
+ * @param i index of child
+ */
+static void
+clear_child(struct GROOT_SRT_CHILDREN *children, uint8_t i){
+	if(i >= children->present){
+		return;
+	}
+
+	groot_running_rm(children, i);
+	children->present -= 1;
+	//Last child that reported fills the gap so they stay first
+	swap_child(children, i, children->present);
+	groot_child_slots.count[children->slot[children->present]] = 0;
 }
 
 /**
- * @brief Add child to list
- * @details Add child to list
+ * @brief Hash a query key
+ * @details Hash a query handle and its sink into the query index
  * 
- * @param GROOT_SRT_CHILD Pointer to child list
- * @param GROOT_SRT_CHILD child to add
+ * @param handle Query handle
+ * @param ereceiver Query owner
  * 
- * @return pointer to new child
+ * @return slot where probing starts
  */
-static struct GROOT_SRT_CHILD
-*add_child(struct GROOT_SRT_CHILD *lst_child, struct GROOT_SRT_CHILD *new_child){
-	struct GROOT_SRT_CHILD *tmp_child = child_lst_tail(lst_child);
-	if(tmp_child == NULL){
-		return NULL;
+static uint16_t
+qry_hash(uint8_t handle, const rimeaddr_t *ereceiver){
+	//Unsigned arithmetic so a 16-bit int does not overflow
+	uint16_t h = handle * 0x9E37u;
+	h ^= (((uint16_t)ereceiver->u8[1] << 8) | ereceiver->u8[0]) * 0x79B9u;
+	return (h ^ (h >> 7)) & (GROOT_QUERY_INDEX_SIZE - 1);
+}
+
+/**
+ * @brief Find the index slot of a query
+ * @details Linear probe from the home slot until the query or an empty slot is found.
+ *          The index is never full so the probe always ends.
+ * 
+ * @param handle Query handle
+ * @param ereceiver Query owner
+ * 
+ * @return slot holding the query or the empty slot where it would go
+ */
+static uint16_t
+qry_index_slot(uint8_t handle, const rimeaddr_t *ereceiver){
+	uint16_t i = qry_hash(handle, ereceiver);
+	struct GROOT_QUERY_ITEM *qry_itm;
+
+	while((qry_itm = groot_qry_index[i]) != NULL){
+		if(qry_itm->handle == handle && rimeaddr_cmp(&qry_itm->ereceiver, ereceiver)){
+			break;
+		}
+		i = (i + 1) & (GROOT_QUERY_INDEX_SIZE - 1);
 	}
+	return i;
+}
 
-	tmp_child->next = new_child;
-	return new_child;
+/**
+ * @brief Add query to index
+ * @details Add query to index
+ * 
+ * @param GROOT_QUERY_ITEM query item, key already set
+ */
+static void
+qry_index_add(struct GROOT_QUERY_ITEM *qry_itm){
+	groot_qry_index[qry_index_slot(qry_itm->handle, &qry_itm->ereceiver)] = qry_itm;
 }
 
 /**
- * @brief Remove Child from list
- * @details Remove Child from list
+ * @brief Remove query from index
+ * @details Remove query from index. Entries after the hole are shifted back so
+ *          probes never need tombstones.
  * 
- * @param GROOT_QUERY_ITEM Pointer to list
- * @param GROOT_SRT_CHILD Child to remove
+ * @param GROOT_QUERY_ITEM query item
  */
 static void
-rm_child(struct GROOT_QUERY_ITEM *list, struct GROOT_SRT_CHILD *child){
-	struct GROOT_SRT_CHILD *prev_child = NULL, *tmp_child = NULL;
-	uint8_t isFound = 0;
-
-	tmp_child = list->children;
-	while(tmp_child != NULL){
-		if(tmp_child != child){
-			prev_child = tmp_child;
-			tmp_child = tmp_child->next;
+qry_index_rm(struct GROOT_QUERY_ITEM *qry_itm){
+	uint16_t i, j, home;
+
+	i = qry_index_slot(qry_itm->handle, &qry_itm->ereceiver);
+	if(groot_qry_index[i] != qry_itm){
+		return;
+	}
+	groot_qry_index[i] = NULL;
+
+	j = i;
+	while(1){
+		j = (j + 1) & (GROOT_QUERY_INDEX_SIZE - 1);
+		if(groot_qry_index[j] == NULL){
+			break;
+		}
+		//Move the entry into the hole unless its home slot lies cyclically in (i, j]
+		home = qry_hash(groot_qry_index[j]->handle, &groot_qry_index[j]->ereceiver);
+		if((i <= j) ? (i < home && home <= j) : (i < home || home <= j)){
 			continue;
 		}
-		isFound = 1;
-		//If root child update list
-		if(prev_child == NULL){
-			list->children = child->next;
-		} else { // update previous
-			prev_child->next = tmp_child->next;
+		groot_qry_index[i] = groot_qry_index[j];
+		groot_qry_index[j] = NULL;
+		i = j;
+	}
+}
+
+/*--------------------------------------------- Neighbors ---------------------------------------------------------------*/
+/**
+ * @brief Get the entry of a parent neighbour
+ * @details Get the entry of a parent neighbour
+ * 
+ * @param address Neighbour address
+ * @return index or -1 if it parents no query
+ */
+static int
+get_neighbor(const rimeaddr_t *address){
+	uint8_t i;
+
+	for(i = 0; i < GROOT_QUERY_LIMIT; i++){
+		if(groot_neighbors.queries[i] > 0 && rimeaddr_cmp(&groot_neighbors.address[i], address)){
+			return i;
 		}
-		
-		prev_child = tmp_child;
-		tmp_child = tmp_child->next;
 	}
-	
-	if(isFound == 1){
-		memset(child, 0, sizeof(struct GROOT_SRT_CHILD));
-		memb_free(&groot_children, child);
+	return -1;
+}
+
+/**
+ * @brief Set the parent of a query
+ * @details Moves the query from the old parent's neighbour entry to the new one's
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ * @param parent New parent or rimeaddr_null
+ */
+static void
+set_parent(struct GROOT_QUERY_ITEM *qry_itm, const rimeaddr_t *parent){
+	int i;
+
+	i = get_neighbor(&qry_itm->parent);
+	if(i >= 0){
+		groot_neighbors.queries[i] -= 1;
+	}
+	rimeaddr_copy(&qry_itm->parent, parent);
+	if(rimeaddr_cmp(parent, &rimeaddr_null)){
+		return;
+	}
+
+	i = get_neighbor(parent);
+	if(i < 0){
+		//A free entry always exists, there is one parent per query
+		for(i = 0; groot_neighbors.queries[i] > 0; i++);
+		rimeaddr_copy(&groot_neighbors.address[i], parent);
+		groot_neighbors.last_seen[i] = 0;
 	}
+	groot_neighbors.queries[i] += 1;
 }
 
 /**
  * @brief Update the time the parent was last seen
- * @details Every time a broadcast is sent update all queries that have sender as parent.
+ * @details Every time a broadcast is sent stamp the sender if it parents any query.
  *          Used to trekk whether the parent is still alive
  * 
  * @param parent address of parent
  */
 static void
 update_parent_last_seen(const rimeaddr_t *parent){
+	int i = get_neighbor(parent);
+
+	if(i >= 0){
+		groot_neighbors.last_seen[i] = GROOT_STAMP();
+	}
+}
+
+/**
+ * @brief Drop the parents that have not published for GROOT_RETRIES_PARENT epochs
+ * @details Runs every GROOT_PARENT_SWEEP while the node has queries. The query
+ *          stops sampling until it adopts a new parent.
+ */
+static void
+cb_parent_sweep(void){
 	struct GROOT_QUERY_ITEM *qry_itm = NULL;
-	int least_time;
-	qry_itm = list_head(groot_qry_table);
-	while(qry_itm != NULL){
-		if(rimeaddr_cmp(&qry_itm->parent, parent)){
-			qry_itm->parent_last_seen = clock_seconds();
-			qry_itm = qry_itm->next;
-			continue; 
+	unsigned long limit;
+	int i;
+
+	for(qry_itm = list_head(groot_qry_table); qry_itm != NULL; qry_itm = qry_itm->next){
+		i = get_neighbor(&qry_itm->parent);
+		//Parents of queries with predicates can be silent for good. Unsubscribed ones are only kept to repair
+		if(i < 0 || has_where(&qry_itm->query) || qry_itm->unsubscribed){
+			continue;
 		}
 
-		least_time = least_idle_time(qry_itm, GROOT_RETRIES_PARENT, 2);
-		if(least_time > 0 && qry_itm->parent_last_seen > 0 && qry_itm->parent_last_seen <= least_time){
-			if(!ctimer_expired(&qry_itm->query_timer)){
+		limit = idle_limit(qry_itm, GROOT_RETRIES_PARENT, 2);
+		if(clock_seconds() > limit && groot_neighbors.last_seen[i] != 0 &&
+			GROOT_AGE(groot_neighbors.last_seen[i]) >= limit){
+			if(!groot_timer_expired(&qry_itm->query_timer)){
 				//Stop Sampe timer
-				ctimer_stop(&qry_itm->query_timer);
+				groot_timer_stop(&qry_itm->query_timer);
 			}
-			rimeaddr_copy(&qry_itm->parent, &rimeaddr_null);
+			GROOT_TRACE(GROOT_TRACE_PARENT_LOST, qry_itm->query_id, &qry_itm->parent, NULL, 0);
+			GROOT_STAT(qry_itm, parent_losses);
+			set_parent(qry_itm, &rimeaddr_null);
 		}
+	}
 
-		qry_itm = qry_itm->next;
+	if(list_head(groot_qry_table) != NULL){
+		groot_timer_set(&groot_neighbors.sweep, GROOT_PARENT_SWEEP, GROOT_EV_PARENT_SWEEP);
 	}
 }
 
@@ -335,36 +799,23 @@ update_parent_last_seen(const rimeaddr_t *parent){
  */
 static void
 cb_rm_query(void *i){
-	printf("REMOVING QUERY!! \n");
+	GROOT_PRINTF("REMOVING QUERY!! \n");
 	struct GROOT_QUERY_ITEM *lst_itm = (struct GROOT_QUERY_ITEM *)i;
 
-	if(!ctimer_expired(&lst_itm->query_timer)){
+	if(!groot_timer_expired(&lst_itm->query_timer)){
 		//Stop Sampe timer
-		ctimer_stop(&lst_itm->query_timer);
+		groot_timer_stop(&lst_itm->query_timer);
 	}
+	groot_trickle_stop(&lst_itm->trickle);
+	set_parent(lst_itm, &rimeaddr_null);
+	rm_children(&lst_itm->children);
 
+	qry_index_rm(lst_itm);
 	list_remove(groot_qry_table, lst_itm);
 	memset(lst_itm, 0, sizeof(struct GROOT_QUERY_ITEM));
 	memb_free(&groot_qrys, lst_itm);
 }
 
-/**
- * @brief Check if the packet received is groot
- * @details Check if the packet received is groot
- * 
- * @param GROOT_HEADER 0 false 1 true
- */
-static uint8_t
-is_groot_protocol(struct GROOT_HEADER *hdr){
-	if(hdr->protocol.version != GROOT_VERSION){
-		return 0;
-	}
-	if(hdr->protocol.magic[0] != 'G' || hdr->protocol.magic[1] != 'T'){
-		return 0;
-	}
-	return 1;
-}
-
 /**
  * @brief Check if the node has all the sensors needed
  * @details Check if the node has all the sensors needed
@@ -382,153 +833,331 @@ is_capable(struct GROOT_SENSORS *qry_sensors){
 	return 1;
 }
 
+/*--------------------------------------------- Subtree -----------------------------------------------------------------*/
+/**
+ * @brief Capability bits of a set of sensors
+ * @details Capability bits of a set of sensors
+ * 
+ * @param GROOT_SENSORS Sensors
+ * @return GROOT_SENSOR_BIT of every sensor set
+ */
+static uint8_t
+sensors_capability(struct GROOT_SENSORS *sensors){
+	uint8_t capability = 0;
+
+	if(sensors->co2 == 1){
+		capability |= GROOT_SENSOR_BIT(SENSOR_CO2);
+	}
+	if(sensors->no == 1){
+		capability |= GROOT_SENSOR_BIT(SENSOR_NO);
+	}
+	if(sensors->humidity == 1){
+		capability |= GROOT_SENSOR_BIT(SENSOR_HUMIDITY);
+	}
+	if(sensors->temp == 1){
+		capability |= GROOT_SENSOR_BIT(SENSOR_TEMP);
+	}
+	return capability;
+}
+
+/**
+ * @brief Sensors of the node and its subtree
+ * @details Sensors of the node and the ones children reported within GROOT_SUBTREE_TIMEOUT
+ */
+static uint8_t
+subtree_capability(void){
+	uint8_t capability = sensors_capability(&glocal.sensors), i;
+	unsigned long now = clock_seconds();
+
+	for(i = 0; i < 4; i++){
+		if(glocal.subtree.seen[i] > 0 && now - glocal.subtree.seen[i] <= GROOT_SUBTREE_TIMEOUT){
+			capability |= 1 << i;
+		}
+	}
+	return capability;
+}
+
+/**
+ * @brief Check if the node or its subtree can answer a query
+ * @details Until GROOT_SUBTREE_SETTLE after its first query the node has not heard
+ *          from its children, so it takes part in every query. The sink always does.
+ *          A summary holds sensor types rather than nodes, so a subtree with the
+ *          sensors on different nodes still takes the query.
+ * 
+ * @param GROOT_SENSORS Sensors required by the query
+ * @return 0 false 1 true
+ */
+static uint8_t
+subtree_can_answer(struct GROOT_SENSORS *required){
+	uint8_t needed = sensors_capability(required);
+
+	if(glocal.is_sink == 1 || glocal.subtree.since == 0 ||
+		clock_seconds() - glocal.subtree.since < GROOT_SUBTREE_SETTLE){
+		return 1;
+	}
+	return (subtree_capability() & needed) == needed;
+}
+
+/**
+ * @brief Add the capability of a child to the subtree summary
+ * @details The sender is a child when it publishes or joins to the node or
+ *          rebroadcasts a query it received from the node.
+ * 
+ * @param GROOT_HEADER header
+ */
+static void
+subtree_heard(struct GROOT_HEADER *hdr){
+	unsigned long now = clock_seconds();
+	uint8_t i;
+
+	switch(hdr->type){
+		case GROOT_PUBLISH_TYPE:
+		case GROOT_BATCH_TYPE:
+			if(rimeaddr_cmp(&hdr->to, &rimeaddr_node_addr) == 0){
+				return;
+			}
+			break;
+		case GROOT_CLUSTER_JOIN_TYPE:
+			//Only ever sent to the parent
+			break;
+		case GROOT_SUBSCRIBE_TYPE:
+		case GROOT_ALTERATION_TYPE:
+		case GROOT_UNSUBSCRIBE_TYPE:
+			if(rimeaddr_cmp(&hdr->received_from, &rimeaddr_node_addr) == 0){
+				return;
+			}
+			break;
+		default:
+			return;
+	}
+
+	for(i = 0; i < 4; i++){
+		if(hdr->capability & (1 << i)){
+			glocal.subtree.seen[i] = now;
+		}
+	}
+}
+
 /**
  * @brief Load a packet into buff
  * @details Load: Header, query and data if available into buffer
  * 
  * @param GROOT_HEADER header to load
  * @param GROOT_QUERY query to load or NULL
- * @param GROOT_SENSORS_DATA data to load or NULL
+ * @param GROOT_PARTIAL partial state to load or NULL. Packed for the query so needs it
  */
 static void
-packet_loader_qry(struct GROOT_HEADER *hdr, struct GROOT_QUERY *qry, struct GROOT_SENSORS_DATA *sensors_data){
-	int data_l = sizeof(struct GROOT_HEADER);
-	struct GROOT_QUERY *pkt_qry = NULL;
-	struct GROOT_SENSORS_DATA *pkt_data = NULL;
+packet_loader_qry(struct GROOT_HEADER *hdr, struct GROOT_QUERY *qry, struct GROOT_PARTIAL *partial){
+	uint8_t *buf;
+
+	//Tell the parent what is below
+	hdr->capability = subtree_capability();
 
-	//Adding query?
+	//Clean buffer
+	packetbuf_clear();
+
+	//Write hdr in buffer
+	buf = packetbuf_dataptr();
+	buf += groot_wire_hdr_write(buf, hdr);
+	//If need be write qry
 	if(qry != NULL){
-		data_l += sizeof(struct GROOT_QUERY);
+		buf += groot_wire_qry_write(buf, qry);
 	}
-	//Adding sensor data?
-	if(sensors_data != NULL){
-		data_l += sizeof(struct GROOT_SENSORS_DATA);
+	//if need be write sensor data
+	if(qry != NULL && partial != NULL){
+		buf += groot_partial_pack(qry, partial, buf);
 	}
-	//Clean buffer and set length
-	packetbuf_clear();
-	packetbuf_set_datalen(data_l);
+	packetbuf_set_datalen(buf - (uint8_t *)packetbuf_dataptr());
+}
 
-	//Copy hdr in buffer
-	struct GROOT_HEADER *pkt_hdr = packetbuf_dataptr();
-	memcpy(pkt_hdr, hdr, sizeof(struct GROOT_HEADER));
-	//If need be copy qry
-	if(qry != NULL){
-		pkt_qry = (packetbuf_dataptr() + sizeof(struct GROOT_HEADER));
-		memcpy(pkt_qry, qry, sizeof(struct GROOT_QUERY));
+/**
+ * @brief Send the publishes waiting for a parent
+ * @details A single publish goes out as a plain publish packet. More are sent
+ *          as one batch frame, every record followed by its packed partial state.
+ * 
+ * @param b GROOT_BATCH to send
+ */
+static void
+cb_batch_flush(void *b){
+	struct GROOT_BATCH *batch = (struct GROOT_BATCH *)b;
+	struct GROOT_BATCH_RECORD *rec = &batch->records[0];
+	struct GROOT_HEADER hdr;
+	uint8_t *buf, i;
+
+	if(batch->length == 0){
+		return;
 	}
-	//if need be copy sensor data
-	if(sensors_data != NULL){
-		if(qry == NULL){
-			pkt_data = (packetbuf_dataptr()+sizeof(struct GROOT_HEADER));
-		} else {
-			pkt_data = (packetbuf_dataptr()+sizeof(struct GROOT_HEADER)+sizeof(struct GROOT_QUERY));
+	if(!groot_timer_expired(&batch->window)){
+		groot_timer_stop(&batch->window);
+	}
+
+	hdr.protocol.version = GROOT_VERSION;
+	hdr.protocol.magic[0] = 'G';
+	hdr.protocol.magic[1] = 'T';
+	rimeaddr_copy(&hdr.to, &batch->parent);
+	rimeaddr_copy(&hdr.ereceiver, &rimeaddr_null);
+	rimeaddr_copy(&hdr.received_from, &rimeaddr_null);
+	hdr.query_id = 0;
+
+	if(batch->length == 1){
+		hdr.is_cluster_head = rec->is_cluster_head;
+		hdr.type = GROOT_PUBLISH_TYPE;
+		hdr.handle = rec->handle;
+		rimeaddr_copy(&hdr.ereceiver, &rec->ereceiver);
+		hdr.depth = rec->depth;
+		hdr.height = rec->height;
+		hdr.span = rec->span;
+		hdr.epoch_offset = rec->epoch_offset;
+		packet_loader_qry(&hdr, &rec->query, &rec->data);
+	} else {
+		hdr.is_cluster_head = 0;
+		hdr.type = GROOT_BATCH_TYPE;
+		hdr.handle = 0;
+		hdr.depth = 0;
+		hdr.height = 0;
+		hdr.span = 0;
+		hdr.epoch_offset = 0;
+		hdr.capability = subtree_capability();
+
+		packetbuf_clear();
+		buf = packetbuf_dataptr();
+		buf += groot_wire_hdr_write(buf, &hdr);
+		packetbuf_set_datalen(buf - (uint8_t *)packetbuf_dataptr() + batch->size);
+		for(i = 0; i < batch->length; i++){
+			rec = &batch->records[i];
+			buf += groot_wire_rec_write(buf, rec);
+			buf += groot_partial_pack(&rec->query, &rec->data, buf);
 		}
-		memcpy(pkt_data, sensors_data, sizeof(struct GROOT_SENSORS_DATA));
 	}
+
+	GROOT_PRINTF("SENDING BATCH - { %d PUBLISHES } \n", batch->length);
+	batch->length = 0;
+	batch->size = 0;
+	broadcast_send(&glocal.channels->bc);
 }
 
 /**
- * @brief Get sensor data from struct
- * @details Get sensor data from struct 
+ * @brief Queue a publish for the query's parent
+ * @details Publishes to the same parent within GROOT_BATCH_WINDOW are sent in one
+ *          frame. The frame is sent early once it is full, and before a publish
+ *          that would not fit in the packet buffer.
  * 
- * @param sensor sensor id
- * @param GROOT_SENSORS_DATA Data struct
+ * @param GROOT_QUERY_ITEM Query the publish is sent for
+ * @param GROOT_HEADER Publish header
+ * @param GROOT_QUERY Publish query
+ * @param GROOT_PARTIAL Publish partial state
  */
-static float
-get_sensor_data(uint8_t sensor, struct GROOT_SENSORS_DATA *data){
-	int saved = 0;
-	switch(sensor){
-		case SENSOR_CO2:
-			saved = data->co2;
-			break;
-		case SENSOR_NO:
-			saved = data->no;
-			break;
-		case SENSOR_HUMIDITY:
-			saved = data->humidity;
-			break;
-		case SENSOR_TEMP:
-			saved = data->temp;
+static void
+batch_add(struct GROOT_QUERY_ITEM *itm, struct GROOT_HEADER *hdr, struct GROOT_QUERY *qry,
+	struct GROOT_PARTIAL *data){
+	const rimeaddr_t *parent = &itm->parent;
+	struct GROOT_BATCH *batch = NULL;
+	struct GROOT_BATCH_RECORD rec;
+	struct GROOT_HEADER epoch;
+	uint8_t i, size;
+
+	//Copy first. Arguments may point in the packet buffer which a flush overwrites
+	rec.handle = itm->handle;
+	rimeaddr_copy(&rec.ereceiver, &itm->ereceiver);
+	rec.is_cluster_head = hdr->is_cluster_head;
+	//Forwarded publishes carry this node's epoch
+	hdr_set_epoch(&epoch, itm);
+	rec.depth = epoch.depth;
+	rec.height = epoch.height;
+	rec.span = epoch.span;
+	rec.epoch_offset = epoch.epoch_offset;
+	memcpy(&rec.query, qry, sizeof(struct GROOT_QUERY));
+	memcpy(&rec.data, data, sizeof(struct GROOT_PARTIAL));
+	size = GROOT_WIRE_REC_QUERY + groot_wire_qry_size(qry) + groot_partial_size(qry, data);
+
+	//Batch pending for parent or else a free one
+	for(i = 0; i < GROOT_BATCH_PARENTS; i++){
+		if(groot_batches[i].length > 0 && rimeaddr_cmp(&groot_batches[i].parent, parent)){
+			batch = &groot_batches[i];
 			break;
+		}
+		if(groot_batches[i].length == 0 && batch == NULL){
+			batch = &groot_batches[i];
+		}
+	}
+	//All busy with other parents. Send one to make space
+	if(batch == NULL){
+		batch = &groot_batches[0];
+		cb_batch_flush(batch);
+	}
+
+	//No room left in the frame
+	if(batch->length > 0 && GROOT_WIRE_HDR_BYTES + GROOT_WIRE_TO_BYTES + batch->size + size > PACKETBUF_SIZE){
+		cb_batch_flush(batch);
+	}
+
+	if(batch->length == 0){
+		rimeaddr_copy(&batch->parent, parent);
+		if(GROOT_BATCH_WINDOW > 0){
+			groot_timer_set(&batch->window, GROOT_BATCH_WINDOW, GROOT_EV_BATCH_FLUSH);
+		}
 	}
+	memcpy(&batch->records[batch->length], &rec, sizeof(struct GROOT_BATCH_RECORD));
+	batch->length += 1;
+	batch->size += size;
 
-	return saved;
+	if(GROOT_BATCH_WINDOW == 0 || batch->length >= GROOT_BATCH_LIMIT){
+		cb_batch_flush(batch);
+	}
 }
 
 /**
- * @brief Aggregate Calcualtion
- * @details Aggregate Calculation
+ * @brief Check if every required value is within epsilon of the last one sent
+ * @details Check if every required value is within epsilon of the last one sent
  * 
- * @param GROOT_SRT_CHILD List of Children
- * @param sensor Sensors needed
- * @param aggregator Aggregation type
+ * @param GROOT_SENSORS Sensors required
+ * @param GROOT_SENSORS_DATA Values now
+ * @param GROOT_SENSORS_DATA Values last sent
+ * @param epsilon Tolerance
+ * @return 1 within 0 moved
  */
-static float
-aggregate_calc(struct GROOT_SRT_CHILD *children, uint8_t sensor, uint8_t aggregator){
-	struct GROOT_SRT_CHILD *tmp_child;
-	float result = 0, tmp_data = 0, tmp_result = 0, count = 0;
-
-	switch(aggregator){
-		case GROOT_MAX:
-			tmp_child = children;
-			while(tmp_child != NULL){
-				if(&tmp_child->data <= 0){
-					continue;
-				}
-				tmp_data = get_sensor_data(sensor, &tmp_child->data);
-				if(tmp_result < tmp_data){
-					tmp_result = tmp_data;
-				}
-				tmp_child = tmp_child->next;
-			}
-			result = tmp_result;
-			break;
-		case GROOT_AVG:
-			tmp_child = children;
-			while(tmp_child != NULL){
-				if(&tmp_child->data <= 0){
-					continue;
-				}
-				tmp_result += get_sensor_data(sensor, &tmp_child->data);
-				count += 1;
-				tmp_child = tmp_child->next;
-			}
-			result = tmp_result / count;
-			break;
-		case GROOT_MIN:
-			tmp_child = children;
-			while(tmp_child != NULL){
-				if(&tmp_child->data <= 0){
-					continue;
-				}
-				tmp_data = get_sensor_data(sensor, &tmp_child->data);
-				if(tmp_result > tmp_data){
-					tmp_result = tmp_data;
-				}
-				result = tmp_result;
-				tmp_child = tmp_child->next;
-			}
-			break;
+static uint8_t
+values_within(struct GROOT_SENSORS *required, struct GROOT_SENSORS_DATA *now, struct GROOT_SENSORS_DATA *last,
+	float epsilon){
+	if((required->co2 == 1 && (now->co2 - last->co2 > epsilon || last->co2 - now->co2 > epsilon)) ||
+		(required->no == 1 && (now->no - last->no > epsilon || last->no - now->no > epsilon)) ||
+		(required->temp == 1 && (now->temp - last->temp > epsilon || last->temp - now->temp > epsilon)) ||
+		(required->humidity == 1 && (now->humidity - last->humidity > epsilon || last->humidity - now->humidity > epsilon))){
+		return 0;
 	}
-	return result;
+	return 1;
 }
 
 /**
  * @brief Send the actual data sample
- * @details Send the actual data sample
+ * @details A query that publishes on change holds back values within epsilon of the
+ *          last ones sent, for at most GROOT_HEARTBEAT epochs. The parent keeps the
+ *          last values meanwhile.
  * 
  * @param GROOT_QUERY_ITEM Query list item
- * @param GROOT_SENSORS_DATA Sensor data calclated
+ * @param GROOT_PARTIAL Partial state calclated
  */
 static void
-send_sample(struct GROOT_QUERY_ITEM *qry_itm, struct GROOT_SENSORS_DATA *sensors_data){
+send_sample(struct GROOT_QUERY_ITEM *qry_itm, struct GROOT_PARTIAL *partial){
 	struct GROOT_HEADER hdr;
 	struct GROOT_QUERY qry;
+	struct GROOT_SENSORS_DATA data;
 
 	if(rimeaddr_cmp(&qry_itm->parent, &rimeaddr_null) > 0){
 		return;
 	}
 
+	groot_partial_finalize(qry_itm->query.aggregator, partial, &data);
+	if(publishes_on_change(&qry_itm->query) && qry_itm->last_published != 0 && qry_itm->quiet + 1 < GROOT_HEARTBEAT &&
+		values_within(&qry_itm->query.sensors_required, &data, &qry_itm->last_sent, qry_itm->query.epsilon)){
+		qry_itm->quiet += 1;
+		GROOT_STAT(qry_itm, samples_held);
+		GROOT_TRACE(GROOT_TRACE_HOLD, qry_itm->query_id, &qry_itm->parent, NULL, qry_itm->quiet);
+		return;
+	}
+	qry_itm->quiet = 0;
+	memcpy(&qry_itm->last_sent, &data, sizeof(struct GROOT_SENSORS_DATA));
+
 	hdr.protocol.version = GROOT_VERSION;
 	hdr.protocol.magic[0] = 'G';
 	hdr.protocol.magic[1] = 'T';
@@ -539,109 +1168,179 @@ send_sample(struct GROOT_QUERY_ITEM *qry_itm, struct GROOT_SENSORS_DATA *sensors
 	hdr.is_cluster_head = qry_itm->is_serviced;
 	hdr.type = GROOT_PUBLISH_TYPE;
 	hdr.query_id = qry_itm->query_id;
+	hdr.handle = qry_itm->handle;
+	hdr_set_epoch(&hdr, qry_itm);
 
 	//Increment Sample Id
 	qry_itm->query.sample_id += 1;
 	copy_qry(&qry, &qry_itm->query);
 
 	PRINT2ADDR(&rimeaddr_node_addr);
-	printf("- { SENDING SAMPLE %d - QID - %d } ", qry.sample_id, qry_itm->query_id);
-	printf("- [ CO2 - %.2f NO - %.2f TEMP - %.2f HUMIDITY - %.2f ] \n", sensors_data->co2, 
-			sensors_data->no, sensors_data->temp, sensors_data->humidity);
-
-	qry_itm->last_published = clock_seconds();
-	packet_loader_qry(&hdr, &qry, sensors_data);
-	broadcast_send(&glocal.channels->bc);
+	GROOT_PRINTF("- { SENDING SAMPLE %d - QID - %d } ", qry.sample_id, qry_itm->query_id);
+	GROOT_PRINTF("- [ READINGS - %d CO2 - %.2f NO - %.2f TEMP - %.2f HUMIDITY - %.2f ] \n", partial->count,
+			data.co2, data.no, data.temp, data.humidity);
+
+	qry_itm->last_published = GROOT_STAMP();
+	GROOT_STAT(qry_itm, samples_sent);
+	GROOT_TRACE(GROOT_TRACE_SEND, qry_itm->query_id, &qry_itm->parent, &qry_itm->ereceiver, GROOT_TRACE_COUNT(partial->count));
+	batch_add(qry_itm, &hdr, &qry, partial);
 }
 
 /**
- * @brief Check whether aggregates can be sent
- * @details Check whether children have replied and aggregation can be sent
+ * @brief Remove children that stopped reporting
+ * @details Children report in the slot before this node's. One that missed its slot
+ *          GROOT_RETRIES_AGGREGATION epochs in a row is taken to be dead. Children of
+ *          a query with predicates are silent when nothing in their subtree passes,
+ *          so they are kept and only left out of the epochs they missed.
  * 
  * @param GROOT_QUERY_ITEM query item to handle
  */
-static uint8_t
-can_send_aggregate(struct GROOT_QUERY_ITEM *qry_itm){
-	struct GROOT_SRT_CHILD *tmp_child = qry_itm->children;
-	struct GROOT_SRT_CHILD *nxt_child;
-	int lst_time;
-
-	while(tmp_child != NULL){
-
-		if(qry_itm->last_published != 0){
-			//Passed through 3 times without setting. Node is dead!
-		 	lst_time = least_idle_time(qry_itm, GROOT_RETRIES_AGGREGATION, 2);
-			if(lst_time > 0 && tmp_child->last_set <= lst_time){
-				nxt_child = tmp_child->next;
-				rm_child(qry_itm, tmp_child);
-				tmp_child = nxt_child;
+static void
+rm_idle_children(struct GROOT_QUERY_ITEM *qry_itm){
+	struct GROOT_SRT_CHILDREN *children = &qry_itm->children;
+	uint8_t i = 0;
+	unsigned long limit;
+
+	if(has_where(&qry_itm->query)){
+		limit = idle_limit(qry_itm, 1, 0);
+		while(i < children->present){
+			if(GROOT_AGE(groot_child_slots.last_set[children->slot[i]]) >= limit){
+				//Last child that reported moves into i so check i again
+				clear_child(children, i);
 				continue;
 			}
+			i += 1;
 		}
+		return;
+	}
 
-		if((tmp_child->last_set <= qry_itm->last_published && qry_itm->agg_passes < 3) && 
-			ctimer_expired(&qry_itm->maintainer_t))
-		{
-			//Increment Passes
-			qry_itm->agg_passes += 1;
-			ctimer_set(&qry_itm->maintainer_t, (rand()%(1*CLOCK_SECOND)), cb_publish_aggregate, qry_itm);
-			return 0;
-		}
+	if(qry_itm->last_published == 0){
+		return;
+	}
 
-		tmp_child = tmp_child->next;
+	limit = idle_limit(qry_itm, GROOT_RETRIES_AGGREGATION, 2);
+	while(i < children->length){
+		if(clock_seconds() > limit && GROOT_AGE(groot_child_slots.last_set[children->slot[i]]) >= limit){
+			//Last child moves into i so check i again
+			rm_child(children, i);
+			GROOT_STAT(qry_itm, children_evicted);
+			continue;
+		}
+		i += 1;
 	}
+}
 
-	return 1;
+/**
+ * @brief Check if a child did not report in the last epoch
+ * @details Children of queries with predicates or that publish on change can be
+ *          silent on purpose, so they are never missing
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ * @return 1 a child is missing 0 otherwise
+ */
+static uint8_t
+children_missing(struct GROOT_QUERY_ITEM *qry_itm){
+	unsigned long rate = qry_itm->query.sample_rate/CLOCK_SECOND;
+	uint8_t i;
+
+	if(has_where(&qry_itm->query) || publishes_on_change(&qry_itm->query) || clock_seconds() <= rate){
+		return 0;
+	}
+	for(i = 0; i < qry_itm->children.length; i++){
+		if(GROOT_AGE(groot_child_slots.last_set[qry_itm->children.slot[i]]) > rate){
+			return 1;
+		}
+	}
+	return 0;
 }
 
 /**
  * @brief Get the actual aggregate data
- * @details Get the actual aggregate data
+ * @details Merges the partial states of the children. Nodes send it to their
+ *          parent, the sink finalizes it as the epoch's result.
  * 
- * @param i List item
+ * @param GROOT_QUERY_ITEM List item
  */
 static void
-cb_publish_aggregate(void *i){
-	struct GROOT_QUERY_ITEM *lst_itm = (struct GROOT_QUERY_ITEM *)i;
-	struct GROOT_SENSORS_DATA data;
-	struct GROOT_SENSORS *req = NULL;
+publish_aggregate(struct GROOT_QUERY_ITEM *lst_itm){
+	struct GROOT_PARTIAL partial;
+
+	rm_idle_children(lst_itm);
 
-	if(can_send_aggregate(lst_itm) == 0){
+	//Children values are already aggregated as they arrived
+	groot_running_result(&lst_itm->children, &lst_itm->query, &partial);
+	//Nothing reported this epoch
+	if(partial.count == 0){
 		return;
 	}
-	
-	//Sending so aggregation pass is done!
-	lst_itm->agg_passes = 0;
-	req = &lst_itm->query.sensors_required;
 
-	if(req->co2 == 1){
-		data.co2 = aggregate_calc(lst_itm->children, SENSOR_CO2, lst_itm->query.aggregator);
+	if(glocal.is_sink == 1){
+		lst_itm->last_published = GROOT_STAMP();
+		GROOT_TRACE(GROOT_TRACE_RESULT, lst_itm->query_id, NULL, NULL, GROOT_TRACE_COUNT(partial.count));
+		//The sampler runs once an epoch so the epoch number goes up by one
+		if(glocal.result != NULL){
+			glocal.result(lst_itm->query_id, lst_itm->epochs, &partial);
+			return;
+		}
+		GROOT_PRINTF("------- RESULT QID - %d ------\n", lst_itm->query_id);
+		print_partial(lst_itm->query.aggregator, &partial);
+		GROOT_PRINTF("------------------------------------\n");
+		return;
 	}
 
-	if(req->no == 1){
-		data.no = aggregate_calc(lst_itm->children, SENSOR_NO, lst_itm->query.aggregator);
+	GROOT_PRINTF("Aggregating - ");
+	print_partial(lst_itm->query.aggregator, &partial);
+	if(children_missing(lst_itm)){
+		GROOT_STAT(lst_itm, partial_aggregates);
 	}
 
-	if(req->temp == 1){
-		data.temp = aggregate_calc(lst_itm->children, SENSOR_TEMP, lst_itm->query.aggregator);
-	}
+	//Send the data
+	send_sample(lst_itm, &partial);
+}
 
-	if(req->humidity == 1){
-		data.humidity = aggregate_calc(lst_itm->children, SENSOR_HUMIDITY, lst_itm->query.aggregator);
-	}
-	
-	printf("Aggregating - ");
-	print_data(&data);
+/**
+ * @brief Check the node's readings against the predicates of a query
+ * @details Readings come from the same cache as the query's samples
+ * 
+ * @param GROOT_WHERE Predicates
+ * @param epoch Start of the query's current epoch
+ * @return 1 all pass 0 otherwise
+ */
+static uint8_t
+where_matches(struct GROOT_WHERE *where, clock_time_t epoch){
+	uint8_t i, sensor, pass;
+	float reading;
 
-	//Send the data
-	send_sample(lst_itm, &data);
+	for(i = 0; i < GROOT_WHERE_LIMIT; i++){
+		if(where->term[i] == 0){
+			continue;
+		}
+		sensor = GROOT_WHERE_SENSOR(where->term[i]);
+		if(sensor == 0 || sensor > 4 || (sensors_capability(&glocal.sensors) & GROOT_SENSOR_BIT(sensor)) == 0){
+			return 0;
+		}
+
+		reading = cached_reading(sensor, epoch);
+		switch(GROOT_WHERE_OP(where->term[i])){
+			case GROOT_WHERE_LT: pass = reading < where->value[i]; break;
+			case GROOT_WHERE_GT: pass = reading > where->value[i]; break;
+			case GROOT_WHERE_LE: pass = reading <= where->value[i]; break;
+			case GROOT_WHERE_GE: pass = reading >= where->value[i]; break;
+			default: pass = 0; break;
+		}
+		if(!pass){
+			return 0;
+		}
+	}
+	return 1;
 }
 
 /**
  * @brief Call back called to periodically set/send sample
- * @details Call back called according to the sample rate. 
- *          If no Aggregation is given send the data if aggregation save data as child.
- *          This method also triggers the send aggregation.
+ * @details Called in the node's transmit slot of every epoch. 
+ *          If no Aggregation is given send the data if aggregation save data as child
+ *          and publish the aggregate. Children have reported in the slot before.
+ *          The sink has no readings and only finalizes what its children sent.
  * 
  * @param i Query Item that sample needs
  */
@@ -649,38 +1348,79 @@ static void
 cb_sampler(void *i){
 	struct GROOT_QUERY_ITEM *qry_itm = (struct GROOT_QUERY_ITEM *)i;
 	struct GROOT_SENSORS_DATA sensors_data;
-	struct GROOT_SRT_CHILD *child;
-
-	//Get Sensor readings - in this case random numbers due to the use of a simulator
-	random_sensor_readings(&qry_itm->query.sensors_required, &sensors_data);
+	struct GROOT_PARTIAL partial;
+	uint8_t sampled = 0;
+	clock_time_t delay;
+	uint16_t slot;
+	int child;
+
+	//Count the epoch from this slot so the clock wrapping does not move it
+	qry_itm->epoch = clock_time() - qry_itm->slot;
+	qry_itm->epochs += 1;
+	//Children have reported the epoch. Later reports count for the next one
+	if(qry_itm->height_next > qry_itm->height){
+		qry_itm->height = qry_itm->height_next;
+		qry_itm->steady = 0;
+		qry_itm->lower = 0;
+	} else {
+		if(qry_itm->steady < GROOT_SLOT_SETTLE){
+			qry_itm->steady++;
+		}
+		//Lost reports do not lower it. A tree lower for GROOT_SLOT_SETTLE epochs does, a level at a time
+		qry_itm->lower = (qry_itm->height_next < qry_itm->height) ? qry_itm->lower + 1 : 0;
+		if(qry_itm->lower >= GROOT_SLOT_SETTLE){
+			qry_itm->height--;
+			qry_itm->lower = 0;
+		}
+	}
+	qry_itm->height_next = 0;
+
+	//Readings that do not pass the predicates are not sent
+	if(qry_itm->is_serviced == 1 && where_matches(&qry_itm->query.where, qry_itm->epoch)){
+		//Get Sensor readings - in this case random numbers due to the use of a simulator
+		sensor_readings(&qry_itm->query.sensors_required, &sensors_data, qry_itm->epoch);
+		groot_partial_init(&qry_itm->query, &sensors_data, &partial);
+		sampled = 1;
+		GROOT_STAT(qry_itm, readings);
+	}
+	GROOT_TRACE(GROOT_TRACE_SAMPLE, qry_itm->query_id, NULL, NULL, sampled);
 	
 	//Send the data
 	if(qry_itm->query.aggregator == GROOT_NO_AGGREGATION){
-		send_sample(qry_itm, &sensors_data);
+		if(sampled == 1){
+			send_sample(qry_itm, &partial);
+		}
 	} else {
-		child = get_child(qry_itm->children, &rimeaddr_node_addr);
-		if(child != NULL){
-			memcpy(&child->data, &sensors_data, sizeof(struct GROOT_SENSORS_DATA));
-			print_data(&child->data);
-			child->last_set = clock_seconds();
+		if(sampled == 1){
+			child = get_child(&qry_itm->children, &rimeaddr_node_addr);
+			if(child < 0){
+				child = add_child(&qry_itm->children, &rimeaddr_node_addr, 0);
+			}
+			if(child >= 0){
+				set_child_data(&qry_itm->children, child, &partial);
+				print_data(&sensors_data);
+			}
 		}
 
-		////Initialize ctimer to check if all children arrived or check with every sample
-		if(ctimer_expired(&qry_itm->maintainer_t)){
-			ctimer_set(&qry_itm->maintainer_t, (rand()%(1*CLOCK_SECOND)), cb_publish_aggregate, qry_itm);
-		}
+		publish_aggregate(qry_itm);
 	}
 
 	//Check if timer is being used by someone else
-	if(ctimer_expired(&qry_itm->query_timer)){
-		printf("QUERY TIMER: %d \n", qry_itm->query.sample_rate);
-		ctimer_set(&qry_itm->query_timer, qry_itm->query.sample_rate, cb_sampler, qry_itm);
+	if(groot_timer_expired(&qry_itm->query_timer)){
+		GROOT_PRINTF("QUERY TIMER: %d \n", qry_itm->query.sample_rate);
+		slot = qry_itm->slot;
+		delay = slot_delay(qry_itm);
+		//A slot moved later is taken next epoch, not twice in this one
+		if(qry_itm->slot > slot){
+			delay += qry_itm->query.sample_rate;
+		}
+		groot_timer_set(&qry_itm->query_timer, delay, GROOT_EV_SAMPLE);
 	}
 }
 
 /**
  * @brief Used to reboradcast alteration
- * @details Used to rebroadcast alteration. Used to reduce collision by delay
+ * @details Used to rebroadcast alteration. Sent by the query's trickle timer
  * 
  * @param lst_itm List Query item
  */
@@ -700,8 +1440,11 @@ rebroadcast_alter(void *lst_itm){
 	hdr.is_cluster_head = itm->is_serviced;
 	hdr.type = GROOT_ALTERATION_TYPE;
 	hdr.query_id = itm->query_id;
+	hdr.handle = itm->handle;
+	hdr_set_epoch(&hdr, itm);
 
-	printf("Re-Broadcast ALTERATION - { QID: %d } \n",itm->query_id);
+	GROOT_TRACE(GROOT_TRACE_REBROADCAST, itm->query_id, NULL, &itm->ereceiver, GROOT_ALTERATION_TYPE);
+	GROOT_PRINTF("Re-Broadcast ALTERATION - { QID: %d } \n",itm->query_id);
 
 	packet_loader_qry(&hdr, &itm->query, NULL);
 	broadcast_send(&glocal.channels->bc);
@@ -709,7 +1452,7 @@ rebroadcast_alter(void *lst_itm){
 
 /**
  * @brief Rebroadcast unsubscribe
- * @details Used to delay broadcast to reduce collisions.
+ * @details Rebroadcast unsubscribe. Sent by the query's trickle timer
  * 
  * @param lst_itm Query list item
  */
@@ -729,17 +1472,19 @@ rebroadcast_unsubscribe(void *lst_itm){
 	hdr.is_cluster_head = itm->is_serviced;
 	hdr.type = GROOT_UNSUBSCRIBE_TYPE;
 	hdr.query_id = itm->query_id;
+	hdr.handle = itm->handle;
+	hdr_set_epoch(&hdr, itm);
 
-	printf("Re-Broadcast UNSUBSRIBE - { QID: %d } \n",itm->query_id);
+	GROOT_TRACE(GROOT_TRACE_REBROADCAST, itm->query_id, NULL, &itm->ereceiver, GROOT_UNSUBSCRIBE_TYPE);
+	GROOT_PRINTF("Re-Broadcast UNSUBSRIBE - { QID: %d } \n",itm->query_id);
 
 	packet_loader_qry(&hdr, &itm->query, NULL);
 	broadcast_send(&glocal.channels->bc);
-	ctimer_set(&itm->maintainer_t, GROOT_RM_UNSUBSCRIBE, cb_rm_query, itm);
 }
 
 /**
  * @brief Rebroadcast subscribe
- * @details Used to delay rebroadcast to reduce collisions
+ * @details Rebroadcast subscribe. Sent by the query's trickle timer
  * 
  * @param lst_itm List item query
  */
@@ -759,13 +1504,34 @@ rebroadcast_subscribe(void *lst_itm){
 	hdr.is_cluster_head = itm->is_serviced;
 	hdr.type = GROOT_SUBSCRIBE_TYPE;
 	hdr.query_id = itm->query_id;
+	hdr.handle = itm->handle;
+	hdr_set_epoch(&hdr, itm);
 
-	printf("Re-Broadcast SUBSCRIBE - { QID: %d } \n",itm->query_id);
+	GROOT_TRACE(GROOT_TRACE_REBROADCAST, itm->query_id, NULL, &itm->ereceiver, GROOT_SUBSCRIBE_TYPE);
+	GROOT_PRINTF("Re-Broadcast SUBSCRIBE - { QID: %d } \n",itm->query_id);
 
 	packet_loader_qry(&hdr, &itm->query, NULL);
 	broadcast_send(&glocal.channels->bc);
 }
 
+/**
+ * @brief Rebroadcast the latest state of the query
+ * @details An unsubscribed query spreads the unsubscribe, an altered one the
+ *          alteration and otherwise the subscribe.
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ */
+static void
+rebroadcast_query(struct GROOT_QUERY_ITEM *itm){
+	if(itm->unsubscribed != 0){
+		rebroadcast_unsubscribe(itm);
+	} else if(itm->altered != 0){
+		rebroadcast_alter(itm);
+	} else {
+		rebroadcast_subscribe(itm);
+	}
+}
+
 /**
  * @brief Send runicast to join cluster
  * @details Send runicast to join cluster
@@ -777,8 +1543,6 @@ cluster_join_send(void *lst_item){
 	struct GROOT_HEADER hdr;
 	struct GROOT_QUERY_ITEM *itm = (struct GROOT_QUERY_ITEM *)lst_item;
 
-	rebroadcast_subscribe(lst_item);
-
 	hdr.protocol.version = GROOT_VERSION;
 	hdr.protocol.magic[0] = 'G';
 	hdr.protocol.magic[1] = 'T';
@@ -790,13 +1554,52 @@ cluster_join_send(void *lst_item){
 	hdr.is_cluster_head = 1;
 	hdr.type = GROOT_CLUSTER_JOIN_TYPE;
 	hdr.query_id = itm->query_id;
+	hdr.handle = itm->handle;
+	hdr_set_epoch(&hdr, itm);
+
+	GROOT_PRINTF("JOIN REQUEST - { ");
+	PRINT2ADDR(&itm->parent);
+	GROOT_PRINTF(" } \n");
+
+	packet_loader_qry(&hdr, NULL, NULL);
+	runicast_send(&glocal.channels->rc, &itm->parent, MAX_RETRANSMISSION);
+}
+
+/**
+ * @brief Join the parent's cluster of a query after delay
+ * @details The node has one join timer. Queries that want to join while it is
+ *          pending wait for it
+ * 
+ * @param GROOT_QUERY_ITEM Query list item
+ * @param delay Ticks until the join
+ */
+static void
+join_later(struct GROOT_QUERY_ITEM *itm, clock_time_t delay){
+	itm->join_pending = 1;
+	if(groot_timer_expired(&glocal.join_timer)){
+		groot_timer_set(&glocal.join_timer, delay, GROOT_EV_CLUSTER_JOIN);
+	}
+}
 
-	printf("JOIN REQUEST - { ");
-	PRINT2ADDR(&itm->parent);
-	printf(" } \n");
+/**
+ * @brief Send the join of the first query waiting for one
+ * @details Runicast sends one join at a time, so the next query waits for the timer again
+ */
+static void
+cb_cluster_join(void){
+	struct GROOT_QUERY_ITEM *itm;
 
-	packet_loader_qry(&hdr, NULL, NULL);
-	runicast_send(&glocal.channels->rc, &itm->parent, MAX_RETRANSMISSION);
+	for(itm = list_head(groot_qry_table); itm != NULL && itm->join_pending == 0; itm = itm->next);
+	if(itm == NULL){
+		return;
+	}
+	itm->join_pending = 0;
+	cluster_join_send(itm);
+
+	for(itm = itm->next; itm != NULL && itm->join_pending == 0; itm = itm->next);
+	if(itm != NULL){
+		groot_timer_set(&glocal.join_timer, rand()%CLOCK_SECOND, GROOT_EV_CLUSTER_JOIN);
+	}
 }
 
 /**
@@ -811,36 +1614,61 @@ cluster_join_send(void *lst_item){
 static struct  GROOT_QUERY_ITEM
 *qry_to_list(struct GROOT_HEADER *hdr, struct GROOT_QUERY *qry_bdy, const rimeaddr_t *from){
 	struct GROOT_QUERY_ITEM *new_item;
-	struct GROOT_SRT_CHILD *new_child;
+
+	//Nothing below can answer. Do not hold or spread the query
+	if(!subtree_can_answer(&qry_bdy->sensors_required)){
+		return NULL;
+	}
 	
+	new_item = memb_alloc(&groot_qrys);
 	//LIST and all MEMORY USED
-	if(list_length(groot_qry_table) >= GROOT_QUERY_LIMIT){
+	if(new_item == NULL){
+		glocal.stats.memb_failures += 1;
 		return NULL;
 	}
-
-	new_item = memb_alloc(&groot_qrys);
+	//Timers must start off not pending
+	memset(new_item, 0, sizeof(struct GROOT_QUERY_ITEM));
 	list_add(groot_qry_table, new_item);
+	if(GROOT_QUERY_LIMIT - memb_numfree(&groot_qrys) > glocal.stats.memb_peak){
+		glocal.stats.memb_peak = GROOT_QUERY_LIMIT - memb_numfree(&groot_qrys);
+	}
+	if(groot_timer_expired(&groot_neighbors.sweep)){
+		groot_timer_set(&groot_neighbors.sweep, GROOT_PARENT_SWEEP, GROOT_EV_PARENT_SWEEP);
+	}
+	//Reports go out of step so neighbours do not all send at once
+	if(GROOT_STATS_PERIOD > 0 && glocal.is_sink == 0 && groot_timer_expired(&glocal.stats_timer)){
+		groot_timer_set(&glocal.stats_timer, GROOT_STATS_PERIOD*CLOCK_SECOND + rand()%CLOCK_SECOND, GROOT_EV_STATS);
+	}
+	if(glocal.subtree.since == 0){
+		glocal.subtree.since = clock_seconds();
+	}
 
 	new_item->query_id = hdr->query_id;
 	rimeaddr_copy(&new_item->ereceiver, &hdr->ereceiver);
-	rimeaddr_copy(&new_item->parent, from);
+	new_item->handle = hdr->handle;
+	qry_index_add(new_item);
+	set_parent(new_item, from);
 	new_item->parent_is_cluster = hdr->is_cluster_head;
 	//Check that I have all the sensors needed
 	new_item->is_serviced = is_capable(&qry_bdy->sensors_required);
-	//When unsubscribe received set this time
 	new_item->unsubscribed = 0;
+	//Learned past its first version, it spreads as an alteration
+	new_item->altered = (qry_bdy->version != 0);
 	new_item->last_published = 0;
 	//Copy Query Values into row
 	copy_qry(&new_item->query, qry_bdy);
+	new_item->children.aggregator = qry_bdy->aggregator;
+	//One hop below the sender and in step with its epoch. The sink is depth 0
+	new_item->depth = rimeaddr_cmp(from, &rimeaddr_node_addr) ? 0 : hdr->depth + 1;
+	new_item->span = hdr->span;
+	new_item->epoch = clock_time() - hdr->epoch_offset;
 	
-	new_item->children = NULL;
+	new_item->children.length = 0;
 
 	//Add node as child to keep data in it
-	new_child = memb_alloc(&groot_children);
-	rimeaddr_copy(&new_child->address, &rimeaddr_node_addr);
-	new_child->last_set = 0;
-	new_child->next = NULL;
-	new_item->children = new_child;
+	if(new_item->is_serviced == 1){
+		add_child(&new_item->children, &rimeaddr_node_addr, 0);
+	}
 	
 	print_qrys();
 	return new_item;
@@ -848,50 +1676,135 @@ static struct  GROOT_QUERY_ITEM
 
 /**
  * @brief Find query in list item
- * @details Find query in list item
+ * @details Find query in list item through the query index. O(1) on average
  * 
- * @param query_id ID
+ * @param handle Query handle
  * @param ereceiver Query owner
  * 
  * @return Pointer of query location
  */
 static struct GROOT_QUERY_ITEM
-*find_query(uint16_t query_id, const rimeaddr_t *ereceiver){
-	struct GROOT_QUERY_ITEM *i;
-	//If empty return
-	if(list_length(groot_qry_table) == 0){
-		return NULL;
-	}
-	//Get top of head a pass through all queries to find query
-	i = list_head(groot_qry_table);
-	while(i != NULL){
-		if(i->query_id == query_id && rimeaddr_cmp(&i->ereceiver, ereceiver)){
-			return i;
+*find_query(uint8_t handle, const rimeaddr_t *ereceiver){
+	return groot_qry_index[qry_index_slot(handle, ereceiver)];
+}
+
+/**
+ * @brief Find a query the node is the sink of
+ * @details Find a query the node is the sink of
+ * 
+ * @param query_id ID
+ * 
+ * @return Pointer of query location or NULL
+ */
+static struct GROOT_QUERY_ITEM
+*find_own_query(uint16_t query_id){
+	struct GROOT_QUERY_ITEM *itm;
+
+	for(itm = list_head(groot_qry_table); itm != NULL; itm = itm->next){
+		if(itm->query_id == query_id && rimeaddr_cmp(&itm->ereceiver, &rimeaddr_node_addr)){
+			return itm;
 		}
-		i = i->next;
 	}
 	return NULL;
 }
 
+/**
+ * @brief Fill in the query id of a received header
+ * @details Every frame of a query carries its handle and sink, which key it. Only
+ *          floods carry the query id as well. Other frames take it from the query,
+ *          left 0 if it is unknown, and queries learnt from publishes take it from
+ *          their first flood. A flood whose handle the node still holds for an
+ *          older query of the sink is not taken.
+ * 
+ * @param GROOT_HEADER header
+ * 
+ * @return 1 taken 0 handle held by another query
+ */
+static uint8_t
+hdr_set_key(struct GROOT_HEADER *hdr){
+	struct GROOT_QUERY_ITEM *itm = find_query(hdr->handle, &hdr->ereceiver);
+
+	if(itm == NULL){
+		return 1;
+	}
+	if(hdr->query_id == 0){
+		hdr->query_id = itm->query_id;
+		return 1;
+	}
+	if(itm->query_id == 0){
+		itm->query_id = hdr->query_id;
+	}
+	return itm->query_id == hdr->query_id;
+}
+
 /*--------------------------------------------- RCV METHODS -------------------------------------------------------------*/
+/**
+ * @brief Compare a query flood heard with the local state of the query
+ * @details A copy that matches counts towards suppressing the next rebroadcast.
+ *          A neighbour behind the node, on an older alteration or still subscribed
+ *          after an unsubscribe, resets the trickle so it is repaired quickly. Newer
+ *          state is taken on by the receive methods.
+ * 
+ * @param GROOT_HEADER header
+ */
+static void
+rcv_flood(struct GROOT_HEADER *hdr){
+	struct GROOT_QUERY_ITEM *lst_itm = NULL;
+	const uint8_t *qry_bdy;
+
+	if(hdr->type != GROOT_SUBSCRIBE_TYPE && hdr->type != GROOT_ALTERATION_TYPE &&
+		hdr->type != GROOT_UNSUBSCRIBE_TYPE){
+		return;
+	}
+
+	lst_itm = find_query(hdr->handle, &hdr->ereceiver);
+	if(lst_itm == NULL){
+		return;
+	}
+
+	if(lst_itm->unsubscribed != 0){
+		if(hdr->type == GROOT_UNSUBSCRIBE_TYPE){
+			groot_trickle_consistent(&lst_itm->trickle);
+		} else {
+			groot_trickle_reset(&lst_itm->trickle);
+		}
+		return;
+	}
+
+	if(hdr->type == GROOT_UNSUBSCRIBE_TYPE){
+		return;
+	}
+
+	//Only the version is needed, read in place
+	qry_bdy = packetbuf_qry();
+	if(qry_bdy == NULL){
+		return;
+	}
+	if(GROOT_QRY_VERSION(qry_bdy) == lst_itm->query.version){
+		groot_trickle_consistent(&lst_itm->trickle);
+	} else if(GROOT_VERSION_NEWER(lst_itm->query.version, GROOT_QRY_VERSION(qry_bdy))){
+		groot_trickle_reset(&lst_itm->trickle);
+	}
+}
+
 static int
 rcv_subscribe(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
-	struct GROOT_QUERY *qry_bdy;	
+	struct GROOT_QUERY qry_bdy;
 	struct GROOT_QUERY_ITEM *lst_itm = NULL;
-	struct GROOT_QUERY snd_bdy;
-	struct GROOT_HEADER snd_hdr;
 	
 	//Already Saved
-	lst_itm = find_query(hdr->query_id, &hdr->ereceiver);
+	lst_itm = find_query(hdr->handle, &hdr->ereceiver);
 	if(lst_itm != NULL){
 		return 0;
 	}
 
 	//Get Query from buffer
-	qry_bdy = packetbuf_get_qry();
+	if(!packetbuf_get_qry(&qry_bdy)){
+		return 0;
+	}
 	
 	//Add the new qry to the table
-	lst_itm = qry_to_list(hdr, qry_bdy, from);
+	lst_itm = qry_to_list(hdr, &qry_bdy, from);
 	//NOT added to the table do nothing. FOLLOWS ASSUMPTION ALL QUERIES WILL BE SAVED
 	if(lst_itm == NULL){
 		return 0;
@@ -900,16 +1813,16 @@ rcv_subscribe(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
 	//If the query is serviced by this node create callback function to send samples
 	if(lst_itm->is_serviced == 1){
 		//Timer for sampling
-		ctimer_set(&lst_itm->query_timer, qry_bdy->sample_rate+(rand()%(1*CLOCK_SECOND)), cb_sampler, lst_itm);
+		groot_timer_set(&lst_itm->query_timer, slot_delay(lst_itm), GROOT_EV_SAMPLE);
 	}
 
 	if(lst_itm->parent_is_cluster == 1){
 		//Timer to send out join cluster
-		ctimer_set(&lst_itm->maintainer_t, rand()%(CLOCK_SECOND/2), cluster_join_send, lst_itm);
-	} else {
-		//Rebroadcast even not cluster
-		ctimer_set(&lst_itm->maintainer_t, rand()%(CLOCK_SECOND/2), rebroadcast_subscribe, lst_itm);
+		join_later(lst_itm, rand()%(CLOCK_SECOND/2));
 	}
+
+	//Rebroadcast even not cluster
+	groot_trickle_reset(&lst_itm->trickle);
 	return 1;
 }
 
@@ -917,36 +1830,58 @@ static int
 rcv_unsubscribe(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
 	struct GROOT_QUERY_ITEM *lst_itm = NULL;
 
-	lst_itm = find_query(hdr->query_id, &hdr->ereceiver);
+	lst_itm = find_query(hdr->handle, &hdr->ereceiver);
 	//Return if item already deleted or already bcast the unsubscribed
 	if(lst_itm == NULL || lst_itm->unsubscribed != 0){
 		return 0;
 	}
 
-	//Keep the query in the file for a few seconds to stop rebroadcasting
-	lst_itm->unsubscribed = clock_seconds();
-	rimeaddr_copy(&lst_itm->parent, &rimeaddr_null);
-	rimeaddr_copy(&lst_itm->parent, from);
+	//Keep the query in the file to repair neighbours still subscribed
+	lst_itm->unsubscribed = 1;
+	lst_itm->join_pending = 0;
+	set_parent(lst_itm, from);
 
-	//Rebroadcast and then initialize removal
-	ctimer_set(&lst_itm->maintainer_t, rand()%(CLOCK_SECOND/2), rebroadcast_unsubscribe, lst_itm);
+	//Rebroadcast and then initialize removal. Sampling stops
+	groot_timer_set(&lst_itm->query_timer, GROOT_RM_UNSUBSCRIBE, GROOT_EV_RM_QUERY);
+	groot_trickle_reset(&lst_itm->trickle);
 	return 1;
 }
 
 static int
-rcv_publish(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
+rcv_publish(struct GROOT_HEADER *hdr, struct GROOT_QUERY *qry_bdy, struct GROOT_PARTIAL *sns_data,
+	const rimeaddr_t *from){
 	struct GROOT_QUERY_ITEM *lst_itm = NULL, *nm_itm = NULL;
-	struct GROOT_SENSORS_DATA *sns_data = NULL;
-	struct GROOT_SENSORS_DATA *sns_tmp;
-	struct GROOT_SRT_CHILD *child = NULL;
-	struct GROOT_QUERY *qry_bdy = NULL;
-	
+	int child;
+
+	GROOT_TRACE(GROOT_TRACE_PUBLISH, hdr->query_id, from, &hdr->ereceiver, GROOT_TRACE_COUNT(sns_data->count));
 	if(rimeaddr_cmp(&hdr->ereceiver, &rimeaddr_node_addr) > 0){
-		printf("------- RECEIVED DATA SUCCESS ------\n");
-		print_hdr((struct GROOT_HEADER*)packetbuf_dataptr());
-		sns_tmp = (struct GROOT_SENSORS_DATA*)(packetbuf_dataptr()+sizeof(struct GROOT_HEADER)+sizeof(struct GROOT_QUERY));
-		print_data(sns_tmp);
-		printf("------------------------------------\n");
+		//States sent to the sink are merged into the epoch's result. Every sender is a child
+		lst_itm = find_query(hdr->handle, &hdr->ereceiver);
+		if(lst_itm != NULL && lst_itm->unsubscribed == 0 && lst_itm->query.aggregator != GROOT_NO_AGGREGATION &&
+			rimeaddr_cmp(&hdr->to, &rimeaddr_node_addr) > 0){
+			child = get_child(&lst_itm->children, from);
+			if(child < 0){
+				child = add_child(&lst_itm->children, from, GROOT_STAMP());
+			}
+			if(child >= 0){
+				set_child_data(&lst_itm->children, child, sns_data);
+				return 1;
+			}
+		}
+
+		if(glocal.result != NULL){
+			//Copies overheard on their way to the sink are not results
+			if(lst_itm != NULL && lst_itm->unsubscribed == 0 && lst_itm->query.aggregator == GROOT_NO_AGGREGATION &&
+				rimeaddr_cmp(&hdr->to, &rimeaddr_node_addr) > 0){
+				glocal.result(hdr->query_id, qry_bdy->sample_id, sns_data);
+			}
+			return 0;
+		}
+
+		GROOT_PRINTF("------- RECEIVED DATA SUCCESS ------\n");
+		print_hdr(hdr);
+		print_partial(qry_bdy->aggregator, sns_data);
+		GROOT_PRINTF("------------------------------------\n");
 		return 0;
 	}
 
@@ -958,33 +1893,39 @@ rcv_publish(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
 	//Not for me!
 	if(rimeaddr_cmp(&hdr->to, &rimeaddr_node_addr) == 0){
 		update_parent_last_seen(from);
-		//Check if I have query. If not add!
-		nm_itm = find_query(hdr->query_id, &hdr->ereceiver);
+		//Check if I have query. If not add! Its key comes with its next flood
+		nm_itm = find_query(hdr->handle, &hdr->ereceiver);
 		if(nm_itm == NULL){
-			//Get Query from buffer
-			qry_bdy = packetbuf_get_qry();
 			//Add the new qry to the table
 			lst_itm = qry_to_list(hdr, qry_bdy, from);
 			if(lst_itm != NULL){
 				if(lst_itm->is_serviced == 1){
-					printf("QUERY TIMER: %d \n", qry_bdy->sample_rate);
+					GROOT_PRINTF("QUERY TIMER: %d \n", qry_bdy->sample_rate);
 					//Timer for sampling
-					ctimer_set(&lst_itm->query_timer, qry_bdy->sample_rate+(rand()%(1*CLOCK_SECOND)), cb_sampler, lst_itm);
+					groot_timer_set(&lst_itm->query_timer, slot_delay(lst_itm), GROOT_EV_SAMPLE);
 				}
 
 				if(lst_itm->parent_is_cluster == 1){
-					ctimer_set(&lst_itm->maintainer_t, (rand()%(1*CLOCK_SECOND)), cluster_join_send, lst_itm);	
+					join_later(lst_itm, rand()%(1*CLOCK_SECOND));
 				}
 			}
 		} else {
+			//Follow the parent's depth so the slots stay just before it
+			if(rimeaddr_cmp(&nm_itm->parent, from)){
+				nm_itm->depth = hdr->depth + 1;
+				nm_itm->span = hdr->span;
+			}
 			//If query has no parent update parent
-			if(hdr->is_cluster_head == 1 && rimeaddr_cmp(&nm_itm->parent, &rimeaddr_null) > 0){
-				rimeaddr_copy(&nm_itm->parent, from);
-				nm_itm->parent_last_seen = clock_seconds();
+			if(hdr->is_cluster_head == 1 && rimeaddr_cmp(&nm_itm->parent, &rimeaddr_null) > 0 && nm_itm->unsubscribed == 0){
+				set_parent(nm_itm, from);
+				update_parent_last_seen(from);
+				nm_itm->depth = hdr->depth + 1;
+				nm_itm->span = hdr->span;
+				nm_itm->epoch = clock_time() - hdr->epoch_offset;
 				if(nm_itm->is_serviced > 0){
-					ctimer_set(&nm_itm->maintainer_t, rand()%(1*CLOCK_SECOND), cluster_join_send, nm_itm);
-					printf("QUERY TIMER: %d \n", nm_itm->query.sample_rate);
-					ctimer_set(&nm_itm->query_timer, nm_itm->query.sample_rate, cb_sampler, nm_itm);
+					join_later(nm_itm, rand()%(1*CLOCK_SECOND));
+					GROOT_PRINTF("QUERY TIMER: %d \n", nm_itm->query.sample_rate);
+					groot_timer_set(&nm_itm->query_timer, slot_delay(nm_itm), GROOT_EV_SAMPLE);
 				}
 				
 			}
@@ -993,132 +1934,435 @@ rcv_publish(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
 		return 0;
 	}
 
-	lst_itm = find_query(hdr->query_id, &hdr->ereceiver);
+	lst_itm = find_query(hdr->handle, &hdr->ereceiver);
 	if(lst_itm == NULL){
 		return 0;
 	}
 
+	//Everything sent to the node comes from below it
+	if(hdr->height < 0xFF && hdr->height >= lst_itm->height_next){
+		lst_itm->height_next = hdr->height + 1;
+	}
+
 	//Does not have aggregation just send
 	if(lst_itm->query.aggregator == GROOT_NO_AGGREGATION){
-		rimeaddr_copy(&hdr->to, &lst_itm->parent);
-		broadcast_send(&glocal.channels->bc);
+		GROOT_STAT(lst_itm, forwarded);
+		batch_add(lst_itm, hdr, qry_bdy, sns_data);
 		return 1;
 	}
 
 	//Is aggretated store data locally until all data has arrived
-	sns_data = packetbuf_get_sensor_data();
-	
 	PRINT2ADDR(&rimeaddr_node_addr);
-	printf(" Sensor Data - ");
-	print_data(sns_data);
+	GROOT_PRINTF(" Sensor Data - ");
+	print_partial(qry_bdy->aggregator, sns_data);
 
-	child = get_child(lst_itm->children, from);
+	child = get_child(&lst_itm->children, from);
 	//If child set to aggregate. If not Child send bcast
-	if(child != NULL){
-		memcpy(&child->data, sns_data, sizeof(struct GROOT_SENSORS_DATA));
-		child->last_set = clock_seconds();
+	if(child >= 0){
+		set_child_data(&lst_itm->children, child, sns_data);
 	} else {
-		rimeaddr_copy(&hdr->to, &lst_itm->parent);
-		broadcast_send(&glocal.channels->bc);
+		GROOT_STAT(lst_itm, forwarded);
+		batch_add(lst_itm, hdr, qry_bdy, sns_data);
+	}
+
+	print_children(&lst_itm->children);
+	return 1;
+}
+
+/**
+ * @brief Handle a batched publish frame
+ * @details Every record is handled as a plain publish with the frame's sender and receiver,
+ *          so a node learns an overheard query from a batch as it does from a publish.
+ * 
+ * @param GROOT_HEADER Batch frame header
+ * @param from Sender
+ */
+static int
+rcv_batch(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
+	struct GROOT_BATCH_RECORD records[GROOT_BATCH_LIMIT];
+	struct GROOT_HEADER rec_hdr;
+	uint8_t *buf = (uint8_t *)packetbuf_dataptr() + GROOT_HDR_SIZE(packetbuf_dataptr()), i, length, rec_size, size;
+	uint16_t left = packetbuf_datalen() - GROOT_HDR_SIZE(packetbuf_dataptr());
+	int is_success = 0;
+
+	//Read out since handling a record can send and overwrite the packet buffer
+	memcpy(&rec_hdr, hdr, sizeof(struct GROOT_HEADER));
+	for(length = 0; length < GROOT_BATCH_LIMIT && left >= GROOT_WIRE_REC_BYTES && left >= GROOT_REC_SIZE(buf); length++){
+		rec_size = groot_wire_rec_read(buf, &records[length]);
+		size = groot_partial_unpack(&records[length].query, buf + rec_size, left - rec_size, &records[length].data);
+		if(size == 0){
+			break;
+		}
+		buf += rec_size + size;
+		left -= rec_size + size;
 	}
 
-	print_children(lst_itm->children);
+	rec_hdr.type = GROOT_PUBLISH_TYPE;
+	for(i = 0; i < length; i++){
+		rec_hdr.handle = records[i].handle;
+		rimeaddr_copy(&rec_hdr.ereceiver, &records[i].ereceiver);
+		rec_hdr.query_id = 0;
+		//Queries the node does not hold are learnt as from a plain publish, keyed by handle and sink
+		hdr_set_key(&rec_hdr);
+		rec_hdr.is_cluster_head = records[i].is_cluster_head;
+		rec_hdr.depth = records[i].depth;
+		rec_hdr.height = records[i].height;
+		rec_hdr.span = records[i].span;
+		rec_hdr.epoch_offset = records[i].epoch_offset;
+		if(rcv_publish(&rec_hdr, &records[i].query, &records[i].data, from)){
+			is_success = 1;
+		}
+	}
+	return is_success;
 }
 
 static int
 rcv_alterate(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
 	struct GROOT_QUERY_ITEM *lst_itm = NULL;
-	struct GROOT_QUERY *qry_bdy = NULL;
-	
-	//Get Query from buffer
-	qry_bdy = (struct GROOT_QUERY*) (packetbuf_dataptr() + sizeof(struct GROOT_HEADER));
+	struct GROOT_QUERY qry;
+	struct GROOT_QUERY *qry_bdy = &qry;
+	const uint8_t *buf = packetbuf_qry();
+
+	if(buf == NULL){
+		return 0;
+	}
 
 	//Already Saved
-	lst_itm = find_query(hdr->query_id, &hdr->ereceiver);
-	//already handled
-	printf("SAMPLE ID: %d \n", qry_bdy->sample_id);
-	if(lst_itm->query.sample_id >= qry_bdy->sample_id){
-		printf("Already handled \n");
-		return;
+	lst_itm = find_query(hdr->handle, &hdr->ereceiver);
+	//already handled. The version is read in place, repeats are not parsed
+	GROOT_PRINTF("VERSION: %d \n", GROOT_QRY_VERSION(buf));
+	if(lst_itm != NULL && (lst_itm->unsubscribed != 0 ||
+		!GROOT_VERSION_NEWER(GROOT_QRY_VERSION(buf), lst_itm->query.version))){
+		GROOT_PRINTF("Already handled \n");
+		return 0;
 	}
 
+	//Get Query from buffer
+	groot_wire_qry_read(buf, qry_bdy);
+
 	if(lst_itm == NULL){
 		//Add the new qry to the table
 		lst_itm = qry_to_list(hdr, qry_bdy, from);
+		if(lst_itm == NULL){
+			return 0;
+		}
 	} else {
 		//Update Query details
 		memcpy(&lst_itm->query.sensors_required, &qry_bdy->sensors_required, sizeof(struct GROOT_SENSORS));
-		lst_itm->query.sample_id = qry_bdy->sample_id;
+		lst_itm->query.version = qry_bdy->version;
 		lst_itm->query.sample_rate = qry_bdy->sample_rate;
 		lst_itm->query.aggregator = qry_bdy->aggregator;
+		lst_itm->children.aggregator = qry_bdy->aggregator;
+		groot_running_rebuild(&lst_itm->children);
+		lst_itm->query.error = qry_bdy->error;
+		lst_itm->query.epsilon = qry_bdy->epsilon;
+		memcpy(&lst_itm->query.where, &qry_bdy->where, sizeof(struct GROOT_WHERE));
+		lst_itm->query.low = qry_bdy->low;
+		lst_itm->query.high = qry_bdy->high;
 		lst_itm->is_serviced = is_capable(&lst_itm->query.sensors_required);
+		//Epoch length may have changed
+		lst_itm->epoch = clock_time() - hdr->epoch_offset;
+		//Publish the altered query at once
+		lst_itm->quiet = GROOT_HEARTBEAT;
 	}
 
 	//Changed Packet Received from
 	rimeaddr_copy(&lst_itm->rcv_alter, from);
+	lst_itm->altered = 1;
 
 	//If the query is serviced by this node create callback function to send samples
 	if(lst_itm->is_serviced > 0){
-		ctimer_set(&lst_itm->query_timer, qry_bdy->sample_rate+(rand()%(1*CLOCK_SECOND)), cb_sampler, lst_itm);
+		groot_timer_set(&lst_itm->query_timer, slot_delay(lst_itm), GROOT_EV_SAMPLE);
 	}
 
-	ctimer_set(&lst_itm->maintainer_t, rand()%(CLOCK_SECOND/4), rebroadcast_alter, lst_itm);
+	groot_trickle_reset(&lst_itm->trickle);
 	return 1;
 }
 
 static int
 rcv_cluster_join(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
 	struct GROOT_QUERY_ITEM *lst_itm = NULL;
-	struct GROOT_SRT_CHILD *child;
+	int child;
 
-	lst_itm = find_query(hdr->query_id, &hdr->ereceiver);
-	//Item not in table or cannot accept more children
-	if(lst_itm == NULL || 
-		(child_length(lst_itm->children) >= GROOT_CHILD_LIMIT)){
+	lst_itm = find_query(hdr->handle, &hdr->ereceiver);
+	//Item not in table
+	if(lst_itm == NULL){
 		return 0;
 	}
 
-	//@todo check if child is in the children list already
+	//Already a child, just refresh it
+	child = get_child(&lst_itm->children, from);
+	if(child >= 0){
+		groot_child_slots.last_set[lst_itm->children.slot[child]] = GROOT_STAMP();
+		return 1;
+	}
 
-	//Get Child memory
-	child = memb_alloc(&groot_children);
-	rimeaddr_copy(&child->address, from);
-	child->last_set = clock_seconds();
-	child->next = NULL;
-	//Add Child
-	if(lst_itm->children == NULL){
-		lst_itm->children = child;
-	} else {
-		add_child(lst_itm->children, child);
+	//Add Child. Fails if it cannot accept more children
+	if(add_child(&lst_itm->children, from, GROOT_STAMP()) < 0){
+		return 0;
+	}
+
+	return 1;
+}
+/*--------------------------------------------- Stats Reports -----------------------------------------------------------*/
+/**
+ * @brief Send a stats report to the parent of a query
+ * @details Send a stats report to the parent of a query
+ * 
+ * @param GROOT_QUERY_ITEM Query the report goes up the tree of
+ * @param GROOT_STATS_REPORT Report
+ */
+static void
+send_stats(struct GROOT_QUERY_ITEM *itm, struct GROOT_STATS_REPORT *report){
+	struct GROOT_HEADER hdr;
+	uint16_t length;
+
+	hdr.protocol.version = GROOT_VERSION;
+	hdr.protocol.magic[0] = 'G';
+	hdr.protocol.magic[1] = 'T';
+	rimeaddr_copy(&hdr.to, &itm->parent);
+	rimeaddr_copy(&hdr.ereceiver, &itm->ereceiver);
+	rimeaddr_copy(&hdr.received_from, &rimeaddr_null);
+
+	hdr.is_cluster_head = itm->is_serviced;
+	hdr.type = GROOT_STATS_TYPE;
+	hdr.query_id = itm->query_id;
+	hdr.handle = itm->handle;
+	hdr_set_epoch(&hdr, itm);
+
+	packet_loader_qry(&hdr, NULL, NULL);
+	length = packetbuf_datalen();
+	packetbuf_set_datalen(length + GROOT_WIRE_STATS_BYTES);
+	groot_wire_stats_write((uint8_t *)packetbuf_dataptr() + length, report);
+	broadcast_send(&glocal.channels->bc);
+}
+
+/**
+ * @brief Report the node's counters to the sink
+ * @details Goes up the tree of the first query with a parent. Runs every
+ *          GROOT_STATS_PERIOD seconds while the node has queries.
+ */
+static void
+cb_stats_report(void){
+	struct GROOT_QUERY_ITEM *itm;
+	struct GROOT_STATS_REPORT report;
+
+	for(itm = list_head(groot_qry_table); itm != NULL; itm = itm->next){
+		if(itm->unsubscribed == 0 && rimeaddr_cmp(&itm->parent, &rimeaddr_null) == 0){
+			rimeaddr_copy(&report.node, &rimeaddr_node_addr);
+			memcpy(&report.stats, &glocal.stats, sizeof(struct GROOT_STATS));
+			send_stats(itm, &report);
+			break;
+		}
+	}
+
+	if(list_head(groot_qry_table) != NULL){
+		groot_timer_set(&glocal.stats_timer, GROOT_STATS_PERIOD*CLOCK_SECOND, GROOT_EV_STATS);
+	}
+}
+
+/**
+ * @brief Handle a stats report
+ * @details The sink hands it to the report callback, nodes pass it on to the query's parent
+ * 
+ * @param GROOT_HEADER Header
+ * @param from Sender
+ */
+static int
+rcv_stats(struct GROOT_HEADER *hdr, const rimeaddr_t *from){
+	struct GROOT_STATS_REPORT report;
+	struct GROOT_QUERY_ITEM *lst_itm = NULL;
+
+	if(packetbuf_datalen() < GROOT_HDR_SIZE(packetbuf_dataptr()) + GROOT_WIRE_STATS_BYTES){
+		return 0;
+	}
+	//Not for me. The sender is alive though
+	if(rimeaddr_cmp(&hdr->to, &rimeaddr_node_addr) == 0){
+		update_parent_last_seen(from);
+		return 0;
 	}
+	groot_wire_stats_read((uint8_t *)packetbuf_dataptr() + GROOT_HDR_SIZE(packetbuf_dataptr()), &report);
 
+	if(rimeaddr_cmp(&hdr->ereceiver, &rimeaddr_node_addr) > 0){
+		if(glocal.report != NULL){
+			glocal.report(&report.node, &report.stats);
+		}
+		return 1;
+	}
+
+	lst_itm = find_query(hdr->handle, &hdr->ereceiver);
+	if(lst_itm == NULL || rimeaddr_cmp(&lst_itm->parent, &rimeaddr_null) > 0){
+		return 0;
+	}
+	send_stats(lst_itm, &report);
 	return 1;
 }
+/*--------------------------------------------- Timer Events ------------------------------------------------------------*/
+/**
+ * @brief Run the event of an expired GROOT timer
+ * @details Run the event of an expired GROOT timer
+ * 
+ * @param GROOT_TIMER Timer that expired
+ */
+static void
+cb_timer(struct GROOT_TIMER *t){
+	struct GROOT_QUERY_ITEM *itm;
+
+	switch(t->event){
+		case GROOT_EV_SAMPLE:
+			cb_sampler(GROOT_TIMER_OWNER(t, struct GROOT_QUERY_ITEM, query_timer));
+			break;
+		case GROOT_EV_CLUSTER_JOIN:
+			cb_cluster_join();
+			break;
+		case GROOT_EV_TRICKLE_SEND:
+		case GROOT_EV_TRICKLE_END:
+			itm = GROOT_TIMER_OWNER(t, struct GROOT_QUERY_ITEM, trickle.timer);
+			//Nothing below can answer. Drop the idle query rather than keep spreading it
+			if(itm->unsubscribed == 0 && !subtree_can_answer(&itm->query.sensors_required)){
+				cb_rm_query(itm);
+				break;
+			}
+			if(groot_trickle_fired(&itm->trickle)){
+				rebroadcast_query(itm);
+			}
+			break;
+		case GROOT_EV_RM_QUERY:
+			cb_rm_query(GROOT_TIMER_OWNER(t, struct GROOT_QUERY_ITEM, query_timer));
+			break;
+		case GROOT_EV_BATCH_FLUSH:
+			cb_batch_flush(GROOT_TIMER_OWNER(t, struct GROOT_BATCH, window));
+			break;
+		case GROOT_EV_PARENT_SWEEP:
+			cb_parent_sweep();
+			break;
+		case GROOT_EV_STATS:
+			cb_stats_report();
+			break;
+	}
+}
 /*--------------------------------------------- Main Methods ------------------------------------------------------------*/
 void
 groot_prot_init(struct GROOT_SENSORS *sensors, struct GROOT_CHANNELS *channels, uint8_t is_sink){
 	//Initialise data structures
 	list_init(groot_qry_table);
 	memb_init(&groot_qrys);
-	memb_init(&groot_children);
+	groot_child_pool_init();
+	memset(groot_qry_index, 0, sizeof(groot_qry_index));
+	memset(groot_batches, 0, sizeof(groot_batches));
+	memset(&groot_neighbors, 0, sizeof(struct GROOT_NEIGHBORS));
+	memset(&groot_samples, 0, sizeof(struct GROOT_SAMPLE_CACHE));
+	memset(&glocal.subtree, 0, sizeof(struct GROOT_SUBTREE));
+	memset(&glocal.stats, 0, sizeof(struct GROOT_STATS));
+	memset(&glocal.stats_timer, 0, sizeof(struct GROOT_TIMER));
+	memset(&glocal.join_timer, 0, sizeof(struct GROOT_TIMER));
+	groot_wheel_init(cb_timer);
+	groot_trace_init();
+	//Nodes start out of step in their slots so neighbours at one depth do not all send together
+	groot_samples.phase = rand()%((GROOT_SLOT_LENGTH - GROOT_BATCH_WINDOW)*3/4 + 1);
 
 	//Copy Current Sensors
 	memcpy(&glocal.sensors, sensors, sizeof(struct GROOT_SENSORS));
 	//Set local channels
 	glocal.channels = channels;
 	glocal.is_sink = is_sink;
+	glocal.result = NULL;
+	glocal.report = NULL;
+}
+
+void
+groot_result_callback(void (*result)(uint16_t query_id, uint16_t epoch, struct GROOT_PARTIAL *partial)){
+	glocal.result = result;
+}
+
+void
+groot_stats_callback(void (*report)(const rimeaddr_t *node, struct GROOT_STATS *stats)){
+	glocal.report = report;
+}
+
+void
+groot_node_stats(struct GROOT_STATS *stats){
+	memcpy(stats, &glocal.stats, sizeof(struct GROOT_STATS));
+}
+
+uint8_t
+groot_query_stats(uint16_t query_id, struct GROOT_STATS *stats){
+	struct GROOT_QUERY_ITEM *itm;
+	uint8_t found = 0;
+
+	memset(stats, 0, sizeof(struct GROOT_STATS));
+	for(itm = list_head(groot_qry_table); itm != NULL; itm = itm->next){
+		if(itm->query_id != query_id){
+			continue;
+		}
+		stats->readings += itm->stats.readings;
+		stats->samples_sent += itm->stats.samples_sent;
+		stats->samples_held += itm->stats.samples_held;
+		stats->forwarded += itm->stats.forwarded;
+		stats->partial_aggregates += itm->stats.partial_aggregates;
+		stats->children_evicted += itm->stats.children_evicted;
+		stats->parent_losses += itm->stats.parent_losses;
+		found = 1;
+	}
+	return found;
+}
+
+void
+groot_runicast_done(uint8_t retransmissions, uint8_t timedout){
+	glocal.stats.retransmissions += retransmissions;
+	if(timedout){
+		glocal.stats.join_timeouts += 1;
+	}
+}
+
+/**
+ * @brief Give a new query of the sink a handle
+ * @details Handles are given in turn so one is not soon used again by another query
+ *          while nodes still hold the old one. They only need to differ between the
+ *          queries of one sink, as the sink is part of the key.
+ * 
+ * @return handle or 0 if all are in use
+ */
+static uint8_t
+next_handle(void){
+	uint16_t i;
+
+	for(i = 0; i < 255; i++){
+		glocal.handle = (glocal.handle == 255) ? 1 : glocal.handle + 1;
+		if(find_query(glocal.handle, &rimeaddr_node_addr) == NULL){
+			return glocal.handle;
+		}
+	}
+	return 0;
 }
 
 int
-groot_qry_snd(uint16_t query_id, uint8_t type, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregator){
+groot_qry_snd(uint16_t query_id, uint8_t type, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregator,
+	struct GROOT_QUERY_OPTIONS *options){
 	struct GROOT_HEADER hdr;
 	struct GROOT_QUERY qry;
-	struct GROOT_QUERY_ITEM *lst_itm;
+	struct GROOT_QUERY_ITEM *lst_itm = NULL;
 
 	qry.sample_id = 0;
+	qry.version = 0;
 	qry.sample_rate = sample_rate;
 	qry.aggregator = aggregator;
 	memcpy(&qry.sensors_required, data_required, sizeof(struct GROOT_SENSORS));
+	qry.error = GROOT_QUANTILE_ERROR;
+	qry.epsilon = 0;
+	memset(&qry.where, 0, sizeof(struct GROOT_WHERE));
+	qry.low = GROOT_HISTOGRAM_LOW;
+	qry.high = GROOT_HISTOGRAM_HIGH;
+	if(options != NULL){
+		qry.error = options->error;
+		qry.epsilon = options->epsilon;
+		memcpy(&qry.where, &options->where, sizeof(struct GROOT_WHERE));
+		//An empty range keeps the default
+		if(options->low < options->high){
+			qry.low = options->low;
+			qry.high = options->high;
+		}
+	}
 
 	//Initialise query header
 	hdr.protocol.version = GROOT_VERSION;
@@ -1128,33 +2372,77 @@ groot_qry_snd(uint16_t query_id, uint8_t type, uint16_t sample_rate, struct GROO
 	//Main Variables
 	rimeaddr_copy(&hdr.ereceiver, &rimeaddr_node_addr);
 	rimeaddr_copy(&hdr.received_from, &rimeaddr_null);
+	rimeaddr_copy(&hdr.to, &rimeaddr_null);
 	hdr.is_cluster_head = 0;
 	hdr.type = type;
 	hdr.query_id = query_id;
+	hdr.handle = 0;
+	hdr.depth = 0;
+	hdr.height = 0;
+	hdr.span = 0;
+	hdr.epoch_offset = 0;
 
 	if(type == GROOT_SUBSCRIBE_TYPE){
-		qry_to_list(&hdr, &qry, &rimeaddr_node_addr);
+		hdr.handle = next_handle();
+		if(hdr.handle == 0){
+			return 0;
+		}
+		lst_itm = qry_to_list(&hdr, &qry, &rimeaddr_node_addr);
+		//Without its own item the sink would never finalize a result
+		if(lst_itm == NULL){
+			return 0;
+		}
+		epoch_align(lst_itm);
+		hdr_set_epoch(&hdr, lst_itm);
 	} else if(type == GROOT_ALTERATION_TYPE){
-		lst_itm = find_query(query_id, &rimeaddr_node_addr);
-		qry.sample_id = lst_itm->query.sample_id + 1;
+		lst_itm = find_own_query(query_id);
+		if(lst_itm == NULL || lst_itm->unsubscribed){
+			return 0;
+		}
+		hdr.handle = lst_itm->handle;
+		qry.version = lst_itm->query.version + 1;
+		lst_itm->altered = 1;
+		if(options == NULL){
+			qry.error = lst_itm->query.error;
+			qry.epsilon = lst_itm->query.epsilon;
+			memcpy(&qry.where, &lst_itm->query.where, sizeof(struct GROOT_WHERE));
+			qry.low = lst_itm->query.low;
+			qry.high = lst_itm->query.high;
+		}
+		copy_qry(&lst_itm->query, &qry);
+		//The new rate may line up with another query
+		epoch_align(lst_itm);
+		hdr_set_epoch(&hdr, lst_itm);
+		lst_itm->children.aggregator = qry.aggregator;
+		groot_running_rebuild(&lst_itm->children);
+	}
+
+	//The sink keeps the flood going to repair nodes that miss it
+	if(lst_itm != NULL){
+		groot_trickle_reset(&lst_itm->trickle);
+		//and finalizes the children's states in its own slot
+		if(aggregator != GROOT_NO_AGGREGATION){
+			groot_timer_set(&lst_itm->query_timer, slot_delay(lst_itm), GROOT_EV_SAMPLE);
+		} else {
+			groot_timer_stop(&lst_itm->query_timer);
+		}
 	}
 
 	//Create Query Packet
 	packet_loader_qry(&hdr, &qry, NULL);
 	
 	PRINT2ADDR(&rimeaddr_node_addr);
-	printf("- { SENDING QUERY ID: %d }\n", query_id);
+	GROOT_PRINTF("- { SENDING QUERY ID: %d }\n", query_id);
 
-	//Send packet
-	if(!broadcast_send(&glocal.channels->bc)){
-		return 0;
-	}
+	//Send packet. A lost broadcast is repeated by the trickle
+	broadcast_send(&glocal.channels->bc);
 	return 1;
 }
 
 int
 groot_unsubscribe_snd(uint16_t query_id){
 	struct GROOT_HEADER hdr;
+	struct GROOT_QUERY_ITEM *lst_itm;
 	
 	hdr.protocol.version = GROOT_VERSION;
 	hdr.protocol.magic[0] = 'G';
@@ -1167,9 +2455,25 @@ groot_unsubscribe_snd(uint16_t query_id){
 	hdr.is_cluster_head = 0;
 	hdr.type = GROOT_UNSUBSCRIBE_TYPE;
 	hdr.query_id = query_id;
+	hdr.handle = 0;
+	hdr.depth = 0;
+	hdr.height = 0;
+	hdr.span = 0;
+	hdr.epoch_offset = 0;
 
 	PRINT2ADDR(&rimeaddr_node_addr);
-	printf("- { SENDING UNSUBSRIBE }\n");
+	GROOT_PRINTF("- { SENDING UNSUBSRIBE }\n");
+
+	lst_itm = find_own_query(query_id);
+	if(lst_itm != NULL){
+		hdr.handle = lst_itm->handle;
+	}
+	if(lst_itm != NULL && lst_itm->unsubscribed == 0){
+		lst_itm->unsubscribed = 1;
+		lst_itm->join_pending = 0;
+		groot_timer_set(&lst_itm->query_timer, GROOT_RM_UNSUBSCRIBE, GROOT_EV_RM_QUERY);
+		groot_trickle_reset(&lst_itm->trickle);
+	}
 
 	packet_loader_qry(&hdr, NULL, NULL);
 	broadcast_send(&glocal.channels->bc);
@@ -1178,51 +2482,70 @@ groot_unsubscribe_snd(uint16_t query_id){
 
 int
 groot_rcv(const rimeaddr_t *from){
-	struct GROOT_HEADER *hdr = NULL;
+	const uint8_t *buf = packetbuf_dataptr();
+	struct GROOT_HEADER hdr;
+	struct GROOT_QUERY qry;
+	struct GROOT_PARTIAL partial;
 	uint8_t is_success = 0;
 
-	hdr = (struct GROOT_HEADER*) packetbuf_dataptr();
+	//Is not correct protocol
+	if(!groot_wire_is_groot(buf, packetbuf_datalen())){
+		return is_success;
+	}
+	groot_wire_hdr_read(buf, &hdr);
+	subtree_heard(&hdr);
 
-	//I just sent this packet ignore
-	if(rimeaddr_cmp(&hdr->received_from, &rimeaddr_node_addr) == 1){
+	//Batch records name their own queries
+	if(hdr.type != GROOT_BATCH_TYPE && !hdr_set_key(&hdr)){
 		return is_success;
 	}
 
-	//Is not correct protocol
-	if(!is_groot_protocol(hdr)){
+	//Copies of the node's own floods still count for the trickle
+	rcv_flood(&hdr);
+
+	//I just sent this packet ignore
+	if(rimeaddr_cmp(&hdr.received_from, &rimeaddr_node_addr) == 1){
 		return is_success;
 	}
 
-	printf("RECEIVE FROM - ");
+	GROOT_TRACE(GROOT_TRACE_RCV, hdr.query_id, from, NULL, hdr.type);
+	GROOT_PRINTF("RECEIVE FROM - ");
 	PRINT2ADDR(from);
-	printf("- { RECEIVED - %02x }\n", hdr->type);
+	GROOT_PRINTF("- { RECEIVED - %02x }\n", hdr.type);
 
 	if(glocal.is_sink == 0){
-		switch(hdr->type){
+		switch(hdr.type){
 			case GROOT_SUBSCRIBE_TYPE:
-				printf("SUBSCRIBING \n");
-				is_success = rcv_subscribe(hdr, from);
+				GROOT_PRINTF("SUBSCRIBING \n");
+				is_success = rcv_subscribe(&hdr, from);
 				break;
 			case GROOT_UNSUBSCRIBE_TYPE:
 				//Do I have this query?
-				printf("UNSUBSRIBING!! \n");
-				is_success = rcv_unsubscribe(hdr, from);
+				GROOT_PRINTF("UNSUBSRIBING!! \n");
+				is_success = rcv_unsubscribe(&hdr, from);
 				break;
 			case GROOT_ALTERATION_TYPE:
-				printf("ALTERATION!! \n");
-				is_success = rcv_alterate(hdr, from);
+				GROOT_PRINTF("ALTERATION!! \n");
+				is_success = rcv_alterate(&hdr, from);
 				break;
 			case GROOT_CLUSTER_JOIN_TYPE:
-				printf("JOIN CLUSER!! \n");
-				is_success = rcv_cluster_join(hdr, from);
+				GROOT_PRINTF("JOIN CLUSER!! \n");
+				is_success = rcv_cluster_join(&hdr, from);
 				break;
 		}
 	} 
 
 	//Both Sink and Sensor have this functionality
-	if(hdr->type == GROOT_PUBLISH_TYPE){
+	if(hdr.type == GROOT_PUBLISH_TYPE){
 		//Publish Sensed data
-		is_success = rcv_publish(hdr, from);
+		if(packetbuf_get_qry(&qry) && packetbuf_get_partial(&qry, &partial)){
+			is_success = rcv_publish(&hdr, &qry, &partial, from);
+		}
+	} else if(hdr.type == GROOT_BATCH_TYPE){
+		//Several publishes in one frame
+		is_success = rcv_batch(&hdr, from);
+	} else if(hdr.type == GROOT_STATS_TYPE){
+		is_success = rcv_stats(&hdr, from);
 	}
 	return is_success;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
  * @author 
  * 	Johann Mifsud <johann.mifsud.13@ucl.ac.uk>
  */
+#ifndef __GROOT_H__
+#define __GROOT_H__
 
 #include "net/rime.h"
 
@@ -12,15 +14,33 @@
  */
 
 #ifndef GROOT_VERSION
-	#define GROOT_VERSION 1
+	#define GROOT_VERSION 2 //Sent in 4 bits
 #endif
 
 #ifndef DEBUG_LEVEL
-	#define DEBUG_LEVEL 0
+	#define DEBUG_LEVEL 0 //1 keeps a binary trace of events in RAM. 2 prints them as well
+#endif
+
+#if DEBUG_LEVEL > 1
+	#define GROOT_PRINTF(...) printf(__VA_ARGS__)
+#else
+	#define GROOT_PRINTF(...)
+#endif
+
+#ifndef GROOT_TRACE_LENGTH
+ 	#define GROOT_TRACE_LENGTH 32 //Trace records kept in RAM. The oldest is overwritten
+#endif
+
+#ifndef GROOT_TRACE_WRITE
+ 	#define GROOT_TRACE_WRITE CLOCK_SECOND //How often enfield-sensor and enfield-sink write the trace ring to the serial line
+#endif
+
+#if GROOT_TRACE_LENGTH < 1 || GROOT_TRACE_LENGTH > 255
+	#error "GROOT_TRACE_LENGTH must be 1 to 255"
 #endif
 
 #ifndef GROOT_RM_UNSUBSCRIBE
- 	#define GROOT_RM_UNSUBSCRIBE 5*CLOCK_SECOND
+ 	#define GROOT_RM_UNSUBSCRIBE (2*GROOT_TRICKLE_IMAX) //Unsubscribed queries are kept to repair neighbours that missed it
 #endif
 
 #ifndef GROOT_RETRIES_AGGREGATION
@@ -35,8 +55,34 @@
  	#define GROOT_QUERY_LIMIT 10
 #endif
 
+#ifndef GROOT_QUERY_INDEX_SIZE
+ 	#define GROOT_QUERY_INDEX_SIZE 32 //Power of two, at least twice GROOT_QUERY_LIMIT
+#endif
+
+#if (GROOT_QUERY_INDEX_SIZE & (GROOT_QUERY_INDEX_SIZE - 1)) != 0 || GROOT_QUERY_INDEX_SIZE < 2*GROOT_QUERY_LIMIT
+	#error "GROOT_QUERY_INDEX_SIZE must be a power of two and at least twice GROOT_QUERY_LIMIT"
+#endif
+
 #ifndef GROOT_CHILD_LIMIT
- 	#define GROOT_CHILD_LIMIT 5
+ 	#define GROOT_CHILD_LIMIT 5 //Children one query can take from the pool
+#endif
+
+#ifndef GROOT_CHILD_POOL
+	#if 3*GROOT_QUERY_LIMIT < GROOT_CHILD_LIMIT
+		#define GROOT_CHILD_POOL GROOT_CHILD_LIMIT
+	#elif 3*GROOT_QUERY_LIMIT > 254
+		#define GROOT_CHILD_POOL 254
+	#else
+		#define GROOT_CHILD_POOL (3*GROOT_QUERY_LIMIT) //Children of all the queries of the node
+	#endif
+#endif
+
+#ifndef GROOT_EXTRA_POOL
+ 	#define GROOT_EXTRA_POOL (GROOT_CHILD_POOL/2) //Child states of GROOT_VARIANCE, GROOT_HISTOGRAM and GROOT_QUANTILE queries
+#endif
+
+#if GROOT_CHILD_POOL >= 255 || GROOT_EXTRA_POOL >= 255 || GROOT_EXTRA_POOL < 1
+	#error "GROOT_CHILD_POOL and GROOT_EXTRA_POOL must be between 1 and 254"
 #endif
 
 #ifndef GROOT_CHILD_LIMIT
@@ -47,6 +93,130 @@
  	#define MAX_RETRANSMISSION 3
 #endif
 
+#ifndef GROOT_BATCH_WINDOW
+ 	#define GROOT_BATCH_WINDOW CLOCK_SECOND/2 //Publishes to a parent within the window share a frame. 0 sends at once
+#endif
+
+#ifndef GROOT_BATCH_LIMIT
+ 	#define GROOT_BATCH_LIMIT 3 //Publishes in one frame, also bounded by PACKETBUF_SIZE
+#endif
+
+#ifndef GROOT_SAMPLE_FRESHNESS
+ 	#define GROOT_SAMPLE_FRESHNESS CLOCK_SECOND //Age a sensor reading can be reused by another query
+#endif
+
+#ifndef GROOT_SLOT_LENGTH
+ 	#define GROOT_SLOT_LENGTH (2*CLOCK_SECOND) //Epoch transmit slot per tree depth. Must be longer than GROOT_BATCH_WINDOW
+#endif
+
+#ifndef GROOT_SLOT_MIN
+ 	#define GROOT_SLOT_MIN CLOCK_SECOND //Shortest slot a branch is cut into to fit the epoch. Longer than GROOT_BATCH_WINDOW
+#endif
+
+#ifndef GROOT_SLOT_SETTLE
+ 	#define GROOT_SLOT_SETTLE 3 //Epochs the tree below a node stays as deep before its slots are cut to it, or lower before it is taken lower
+#endif
+
+#if GROOT_SLOT_SETTLE < 1 || GROOT_SLOT_SETTLE > 15
+	#error "GROOT_SLOT_SETTLE must be 1 to 15"
+#endif
+
+#ifndef GROOT_WHEEL_BITS
+ 	#define GROOT_WHEEL_BITS 4 //Timer wheel has 2^bits slots per level
+#endif
+
+#ifndef GROOT_WHEEL_LEVELS
+ 	#define GROOT_WHEEL_LEVELS 4 //Timer wheel reaches 2^(bits*levels) clock ticks
+#endif
+
+#ifndef GROOT_TRICKLE_IMIN
+ 	#define GROOT_TRICKLE_IMIN (CLOCK_SECOND/2) //Shortest query dissemination interval
+#endif
+
+#ifndef GROOT_TRICKLE_IMAX
+ 	#define GROOT_TRICKLE_IMAX (64*CLOCK_SECOND) //Longest query dissemination interval
+#endif
+
+#ifndef GROOT_TRICKLE_K
+ 	#define GROOT_TRICKLE_K 2 //Consistent copies heard in an interval that suppress sending
+#endif
+
+#ifndef GROOT_SUBTREE_SETTLE
+ 	#define GROOT_SUBTREE_SETTLE 30 //Seconds after its first query before a node trusts its subtree summary
+#endif
+
+#ifndef GROOT_SUBTREE_TIMEOUT
+ 	#define GROOT_SUBTREE_TIMEOUT 120 //Seconds a sensor reported by a child stays in the subtree summary. Longer than sample rates
+#endif
+
+#ifndef GROOT_PARENT_SWEEP
+ 	#define GROOT_PARENT_SWEEP (5*CLOCK_SECOND) //How often parents that went quiet are looked for
+#endif
+
+#ifndef GROOT_HISTOGRAM_BUCKETS
+ 	#define GROOT_HISTOGRAM_BUCKETS 4 //Buckets per sensor of GROOT_HISTOGRAM
+#endif
+
+#ifndef GROOT_HISTOGRAM_LOW
+ 	#define GROOT_HISTOGRAM_LOW 0 //Lowest reading of the first histogram bucket, and of the quantile range unless the query sets one. Lower readings count in it
+#endif
+
+#ifndef GROOT_HISTOGRAM_HIGH
+ 	#define GROOT_HISTOGRAM_HIGH 100 //Highest reading of the last histogram bucket, and of the quantile range unless the query sets one. Higher readings count in it
+#endif
+
+#ifndef GROOT_QUANTILE_BITS
+ 	#define GROOT_QUANTILE_BITS 5 //Quantile digest splits the query's range into 2^bits buckets
+#endif
+
+#ifndef GROOT_QUANTILE_NODES
+ 	#define GROOT_QUANTILE_NODES 16 //Quantile digest nodes shared by the sensors. Bounds its bytes in a publish
+#endif
+
+#ifndef GROOT_QUANTILE_ERROR
+ 	#define GROOT_QUANTILE_ERROR 10 //Rank error of quantiles in percent of the readings, unless the query sets one
+#endif
+
+#if GROOT_QUANTILE_BITS < 1 || GROOT_QUANTILE_BITS > 5 || GROOT_QUANTILE_NODES < 8
+	#error "GROOT_QUANTILE_BITS must be 1 to 5 and GROOT_QUANTILE_NODES at least 8"
+#endif
+
+#ifndef GROOT_WHERE_LIMIT
+ 	#define GROOT_WHERE_LIMIT 2 //Predicates a query can AND together
+#endif
+
+#ifndef GROOT_HEARTBEAT
+ 	#define GROOT_HEARTBEAT 10 //Most epochs a query that publishes on change stays quiet
+#endif
+
+#ifndef GROOT_SENSOR_DRIFT
+ 	#define GROOT_SENSOR_DRIFT 0 //Simulated readings move at most this far from the last one. 0 draws them afresh
+#endif
+
+#ifndef GROOT_STATS_PERIOD
+ 	#define GROOT_STATS_PERIOD 0 //Seconds between a node's stats reports to the sink. 0 never
+#endif
+
+#ifndef GROOT_SINK_QUERY_LIMIT
+ 	#define GROOT_SINK_QUERY_LIMIT GROOT_QUERY_LIMIT //Queries users can subscribe at the sink
+#endif
+
+#ifndef GROOT_SINK_STORE_LENGTH
+ 	#define GROOT_SINK_STORE_LENGTH 16 //Latest results the sink keeps per user query
+#endif
+
+#ifndef GROOT_SINK_PRINT
+ 	#define GROOT_SINK_PRINT 1 //Sink prints every result it gets on the serial line, at any DEBUG_LEVEL
+#endif
+
+#ifndef GROOT_SINK_MERGE_SENSORS
+ 	#define GROOT_SINK_MERGE_SENSORS 0 //Merge user queries for different sensors. Only nodes with all of them answer, which changes the users' answers
+#endif
+
+#ifndef GROOT_BATCH_PARENTS
+ 	#define GROOT_BATCH_PARENTS 2 //Parents that can have publishes waiting at once
+#endif
+
 /**
  * Routing Definitions
  */
@@ -97,6 +267,84 @@
  	#define GROOT_PUBLISH_TYPE 0xC8
 #endif
 
+#ifndef GROOT_BATCH_TYPE
+ 	#define GROOT_BATCH_TYPE 0xC9
+#endif
+
+#ifndef GROOT_STATS_TYPE
+ 	#define GROOT_STATS_TYPE 0xCA
+#endif
+
+/**
+ * Timer Events
+ */
+#ifndef GROOT_EV_SAMPLE
+ 	#define GROOT_EV_SAMPLE 0x01
+#endif
+
+#ifndef GROOT_EV_CLUSTER_JOIN
+ 	#define GROOT_EV_CLUSTER_JOIN 0x03
+#endif
+
+#ifndef GROOT_EV_RM_QUERY
+ 	#define GROOT_EV_RM_QUERY 0x07
+#endif
+
+#ifndef GROOT_EV_BATCH_FLUSH
+ 	#define GROOT_EV_BATCH_FLUSH 0x08
+#endif
+
+#ifndef GROOT_EV_TRICKLE_SEND
+ 	#define GROOT_EV_TRICKLE_SEND 0x09
+#endif
+
+#ifndef GROOT_EV_TRICKLE_END
+ 	#define GROOT_EV_TRICKLE_END 0x0A
+#endif
+
+#ifndef GROOT_EV_PARENT_SWEEP
+ 	#define GROOT_EV_PARENT_SWEEP 0x0B
+#endif
+
+#ifndef GROOT_EV_STATS
+ 	#define GROOT_EV_STATS 0x0C
+#endif
+
+/**
+ * Trace Events
+ */
+#ifndef GROOT_TRACE_RCV
+ 	#define GROOT_TRACE_RCV 0x01 //a sender, arg packet type
+#endif
+
+#ifndef GROOT_TRACE_SAMPLE
+ 	#define GROOT_TRACE_SAMPLE 0x02 //arg 1 sampled 0 not serviced or predicates failed
+#endif
+
+#ifndef GROOT_TRACE_SEND
+ 	#define GROOT_TRACE_SEND 0x03 //a parent, b query owner, arg readings up to 255
+#endif
+
+#ifndef GROOT_TRACE_HOLD
+ 	#define GROOT_TRACE_HOLD 0x04 //a parent, arg epochs quiet
+#endif
+
+#ifndef GROOT_TRACE_PUBLISH
+ 	#define GROOT_TRACE_PUBLISH 0x05 //a sender, b query owner, arg readings up to 255
+#endif
+
+#ifndef GROOT_TRACE_REBROADCAST
+ 	#define GROOT_TRACE_REBROADCAST 0x06 //b query owner, arg packet type
+#endif
+
+#ifndef GROOT_TRACE_RESULT
+ 	#define GROOT_TRACE_RESULT 0x07 //arg readings up to 255
+#endif
+
+#ifndef GROOT_TRACE_PARENT_LOST
+ 	#define GROOT_TRACE_PARENT_LOST 0x08 //a parent
+#endif
+
 /**
  * Sensor Definitions
  */
@@ -116,6 +364,34 @@
  	#define SENSOR_TEMP 0x04
 #endif
 
+/**
+ * @brief Bit of a sensor type in a capability summary
+ */
+#define GROOT_SENSOR_BIT(sensor) (1 << ((sensor) - 1))
+
+/**
+ * @brief Seconds since boot in 16 bits, never 0
+ * @details Stamps kept per query and per child wrap every 18 hours, so they are only
+ *          compared as ages with GROOT_AGE. 0 is left for never. An age is only
+ *          trusted up to GROOT_AGE_MAX, half the wrap, and idle limits are kept
+ *          below it so a stamp is found stale long before it could look fresh again.
+ */
+#define GROOT_STAMP() ((uint16_t)clock_seconds() == 0 ? 1 : (uint16_t)clock_seconds())
+#define GROOT_AGE(stamp) ((uint16_t)((uint16_t)clock_seconds() - (uint16_t)(stamp)))
+#define GROOT_AGE_MAX 0x7FFF
+
+/**
+ * @brief Is query version a newer than b
+ * @details Versions wrap after 255 alterations, so they are compared as serial
+ *          numbers. A version is newer when it is less than 128 alterations ahead.
+ */
+#define GROOT_VERSION_NEWER(a, b) ((int8_t)((uint8_t)(a) - (uint8_t)(b)) > 0)
+
+/**
+ * @brief Pool slot that holds nothing
+ */
+#define GROOT_NO_SLOT 0xFF
+
 /**
  * AGGREGATORS
  */
@@ -135,6 +411,52 @@
 	#define GROOT_MIN 0x03
 #endif
 
+#ifndef GROOT_SUM
+	#define GROOT_SUM 0x04
+#endif
+
+#ifndef GROOT_COUNT
+	#define GROOT_COUNT 0x05
+#endif
+
+#ifndef GROOT_VARIANCE
+	#define GROOT_VARIANCE 0x06
+#endif
+
+#ifndef GROOT_HISTOGRAM
+	#define GROOT_HISTOGRAM 0x07
+#endif
+
+#ifndef GROOT_QUANTILE
+	#define GROOT_QUANTILE 0x08
+#endif
+
+/**
+ * WHERE OPERATORS
+ */
+#ifndef GROOT_WHERE_LT
+	#define GROOT_WHERE_LT 0x01
+#endif
+
+#ifndef GROOT_WHERE_GT
+	#define GROOT_WHERE_GT 0x02
+#endif
+
+#ifndef GROOT_WHERE_LE
+	#define GROOT_WHERE_LE 0x03
+#endif
+
+#ifndef GROOT_WHERE_GE
+	#define GROOT_WHERE_GE 0x04
+#endif
+
+/**
+ * @brief Predicate term comparing the reading of a sensor type. 0 is an unused term
+ */
+#define GROOT_WHERE_TERM(sensor, op) (((sensor) << 4) | (op))
+#define GROOT_WHERE_SENSOR(term) ((term) >> 4)
+#define GROOT_WHERE_OP(term) ((term) & 0x0F)
+
 /**
  * GROOT CHANNELS
  */
@@ -172,6 +494,62 @@
 	};
 #endif
 
+/**
+ * @brief Quantile digest (q-digest) of the readings of the required sensors
+ * @details Nodes of a binary tree over the 2^GROOT_QUANTILE_BITS buckets of the query's range,
+ *          numbered from the root at 1, each with the readings counted at it. Only
+ *          nodes with readings are kept. Sparse buckets are folded into their parents
+ *          so the digest stays within GROOT_QUANTILE_NODES.
+ */
+#ifndef GROOT_DIGEST
+	struct GROOT_DIGEST{
+		uint8_t length; //Nodes in use
+		uint8_t error; //Rank error the query asked for in percent
+		int16_t low; //Range of the buckets the query asked for
+		int16_t high;
+		uint8_t key[GROOT_QUANTILE_NODES]; //Sensor << 6 | node
+		uint16_t count[GROOT_QUANTILE_NODES];
+	};
+#endif
+
+/**
+ * @brief Part of a partial state only some aggregators use
+ * @details Sensors are in the order of the fields of GROOT_SENSORS_DATA
+ */
+#ifndef GROOT_PARTIAL_EXTRA
+	union GROOT_PARTIAL_EXTRA{
+		struct GROOT_SENSORS_DATA m2; //GROOT_VARIANCE: sum of squared differences from the mean
+		uint16_t histogram[4][GROOT_HISTOGRAM_BUCKETS]; //GROOT_HISTOGRAM: readings in every bucket
+		struct GROOT_DIGEST digest; //GROOT_QUANTILE
+	};
+#endif
+
+/**
+ * @brief Partial state of an aggregate
+ * @details Built from one reading, merged up the tree and only finalized at the sink,
+ *          so every aggregator is exact over the readings of the subtree.
+ */
+#ifndef GROOT_PARTIAL
+	struct GROOT_PARTIAL{
+		uint16_t count; //Readings merged into the state
+		struct GROOT_SENSORS_DATA value; //GROOT_MAX, GROOT_MIN: extreme. GROOT_SUM, GROOT_AVG: sum. GROOT_VARIANCE: mean
+		union GROOT_PARTIAL_EXTRA extra;
+	};
+#endif
+
+/**
+ * @brief Predicates a node's readings must pass for it to report in an epoch
+ * @details Terms are ANDed. Each compares the reading of a sensor type with a value in
+ *          whole units, e.g. GROOT_WHERE_TERM(SENSOR_TEMP, GROOT_WHERE_GT) and 30.
+ *          A node without the sensor of a term never passes.
+ */
+#ifndef GROOT_WHERE
+	struct GROOT_WHERE{
+		uint8_t term[GROOT_WHERE_LIMIT]; //GROOT_WHERE_TERM
+		int16_t value[GROOT_WHERE_LIMIT];
+	};
+#endif
+
 #ifndef GROOT_HEADER_PROTOCOL
 	struct GROOT_HEADER_PROTOCOL{
 		uint8_t version;
@@ -181,6 +559,9 @@
 
 /**
  * @brief the header structure
+ * @details Sent field by field at the offsets of groot-wire.h. Only query floods
+ *          carry query_id and received_from. Other frames name their query by
+ *          its handle and ereceiver and the receiver looks the id up.
  */
 #ifndef GROOT_HEADER
 	struct GROOT_HEADER{
@@ -188,9 +569,15 @@
 		rimeaddr_t to;
 		uint8_t is_cluster_head;
 		uint8_t type;
+		uint8_t handle; //Given to the query by its sink. 0 no query
 		rimeaddr_t ereceiver;
 		uint16_t query_id;
 		rimeaddr_t received_from;
+		uint8_t depth; //Hops of the sender from the sink
+		uint8_t height; //Tree levels below the sender in the query
+		uint8_t span; //Depth of the deepest node of the sender's branch. 0 not known
+		uint16_t epoch_offset; //Ticks the sender is into the query's epoch
+		uint8_t capability; //Sensors in the sender's subtree. GROOT_SENSOR_BIT per type
 	};
 #endif
 
@@ -202,19 +589,234 @@
 		uint16_t sample_id;
 		uint16_t sample_rate;
 		uint8_t aggregator;
+		uint8_t version; //Raised by the sink on every alteration. Wraps, compare with GROOT_VERSION_NEWER
+		uint8_t error; //GROOT_QUANTILE: rank error in percent of the readings
 		struct GROOT_SENSORS sensors_required;
+		uint8_t epsilon; //Change of a published value that is sent at once. 0 publishes every epoch
+		struct GROOT_WHERE where;
+		int16_t low; //GROOT_QUANTILE: lowest reading of the digest's range
+		int16_t high; //GROOT_QUANTILE: highest reading of the digest's range
+	};
+#endif
+
+/**
+ * @brief Settings of a query the sink sends besides its sensors, rate and aggregator
+ */
+#ifndef GROOT_QUERY_OPTIONS
+	struct GROOT_QUERY_OPTIONS{
+		uint8_t error; //GROOT_QUANTILE: rank error in percent of the readings
+		uint8_t epsilon; //Publish on change. Ignored by queries with predicates
+		struct GROOT_WHERE where;
+		int16_t low; //GROOT_QUANTILE: range the digest resolves. low >= high takes GROOT_HISTOGRAM_LOW..HIGH
+		int16_t high;
+	};
+#endif
+
+/**
+ * @brief Performance counters of a query or of the node
+ * @details Counters wrap. The last four are only kept for the node, the runicast and
+ *          the query memory are not tied to one query.
+ */
+#ifndef GROOT_STATS
+	struct GROOT_STATS{
+		uint16_t readings; //Readings the node took
+		uint16_t samples_sent; //Own or aggregated samples sent to the parent
+		uint16_t samples_held; //Samples held back because they were within epsilon
+		uint16_t forwarded; //Publishes of other nodes sent on to the parent
+		uint16_t partial_aggregates; //Aggregates sent without every child's state
+		uint16_t children_evicted; //Children dropped after GROOT_RETRIES_AGGREGATION silent epochs
+		uint16_t parent_losses; //Parents dropped after GROOT_RETRIES_PARENT silent epochs
+		uint16_t retransmissions; //Runicast retransmissions of cluster joins
+		uint16_t join_timeouts; //Cluster joins never acknowledged
+		uint16_t memb_failures; //Queries or child states not taken because their pool was full
+		uint16_t memb_peak; //Most of the GROOT_QUERY_LIMIT query items in use at once
+	};
+#endif
+
+/**
+ * @brief Counters GROOT_STATS also keeps per query
+ */
+#ifndef GROOT_QUERY_STATS
+	struct GROOT_QUERY_STATS{
+		uint16_t readings;
+		uint16_t samples_sent;
+		uint16_t samples_held;
+		uint16_t forwarded;
+		uint16_t partial_aggregates;
+		uint16_t children_evicted;
+		uint16_t parent_losses;
+	};
+#endif
+
+/**
+ * @brief Stats a node reports to the sink of one of its queries
+ * @details Follows the query's parents up the tree as a GROOT_STATS_TYPE packet
+ */
+#ifndef GROOT_STATS_REPORT
+	struct GROOT_STATS_REPORT{
+		rimeaddr_t node;
+		struct GROOT_STATS stats;
+	};
+#endif
+
+/**
+ * @brief A traced event
+ * @details Fixed size so tracing costs a copy into RAM. Drained records are sent or
+ *          stored as the struct's bytes and decoded on the host.
+ */
+#ifndef GROOT_TRACE_RECORD
+	struct GROOT_TRACE_RECORD{
+		uint32_t timestamp; //clock_time() of the event
+		uint16_t query_id;
+		rimeaddr_t a;
+		rimeaddr_t b;
+		uint8_t event;
+		uint8_t arg;
+	};
+#endif
+
+/**
+ * @brief Ring of the latest trace records
+ */
+#ifndef GROOT_TRACE_RING
+	struct GROOT_TRACE_RING{
+		uint8_t head; //Where the next record goes
+		uint8_t length;
+		uint16_t overwritten; //Records lost before they were drained
+		struct GROOT_TRACE_RECORD records[GROOT_TRACE_LENGTH];
+	};
+#endif
+
+/**
+ * @brief A timer on the GROOT timer wheel
+ * @details Holds the event to run rather than a callback. The owner of the timer
+ *          is found from the event and the timer's place in the owner.
+ */
+#ifndef GROOT_TIMER
+	struct GROOT_TIMER{
+		struct GROOT_TIMER *next;
+		struct GROOT_TIMER **pprev; //NULL when not pending
+		clock_time_t expires;
+		uint8_t event;
+	};
+#endif
+
+/**
+ * @brief Trickle timer of a query's dissemination
+ */
+#ifndef GROOT_TRICKLE
+	struct GROOT_TRICKLE{
+		struct GROOT_TIMER timer;
+		clock_time_t interval; //Current interval length
+		clock_time_t rest; //Ticks left in the interval after the transmit point
+		uint8_t counter; //Consistent copies heard this interval
 	};
 #endif
 
 /**
- * @brief The list that will hold the children associated with a query
+ * @brief Last reading of every sensor type on the node
+ * @details Indexed by sensor type - 1. Shared by all the queries sampled on the node.
  */
-#ifndef GROOT_SRT_CHILD
-	struct GROOT_SRT_CHILD{
-		rimeaddr_t address;
-		unsigned long last_set;
-		struct GROOT_SENSORS_DATA data;
-		struct GROOT_SRT_CHILD *next;
+#ifndef GROOT_SAMPLE_CACHE
+	struct GROOT_SAMPLE_CACHE{
+		uint8_t valid; //Bit per sensor type that has a reading
+		clock_time_t phase; //Node offset into its transmit slots
+		clock_time_t taken[4];
+		float value[4];
+	};
+#endif
+
+/**
+ * @brief One publish carried in a batched publish frame
+ * @details A batch frame is a GROOT_HEADER of GROOT_BATCH_TYPE followed by records.
+ *          Each record holds the header fields that differ between publishes.
+ */
+#ifndef GROOT_BATCH_RECORD
+	struct GROOT_BATCH_RECORD{
+		uint8_t handle;
+		rimeaddr_t ereceiver;
+		uint8_t is_cluster_head;
+		uint8_t depth;
+		uint8_t height;
+		uint8_t span;
+		uint16_t epoch_offset;
+		struct GROOT_QUERY query;
+		struct GROOT_PARTIAL data; //Packed for the query on the wire
+	};
+#endif
+
+/**
+ * @brief Publishes waiting to be sent to the same parent
+ */
+#ifndef GROOT_BATCH
+	struct GROOT_BATCH{
+		rimeaddr_t parent;
+		uint8_t length;
+		uint8_t size; //Bytes of the records on the wire
+		struct GROOT_TIMER window;
+		struct GROOT_BATCH_RECORD records[GROOT_BATCH_LIMIT];
+	};
+#endif
+
+/**
+ * @brief Children of every query of the node
+ * @details Kept as separate arrays so lookups scan only addresses and aggregation
+ *          reads each sensor's values apart. Queries take slots as children join,
+ *          up to GROOT_CHILD_LIMIT each, and give them back as they leave, so memory
+ *          only goes to the queries that have children. The value columns hold the
+ *          value of each child's partial state. Only the children of GROOT_VARIANCE,
+ *          GROOT_HISTOGRAM and GROOT_QUANTILE queries take an extra.
+ */
+#ifndef GROOT_CHILD_SLOTS
+	struct GROOT_CHILD_SLOTS{
+		rimeaddr_t address[GROOT_CHILD_POOL];
+		uint16_t last_set[GROOT_CHILD_POOL]; //GROOT_STAMP of the last report
+		uint16_t count[GROOT_CHILD_POOL];
+		float co2[GROOT_CHILD_POOL];
+		float no[GROOT_CHILD_POOL];
+		float temp[GROOT_CHILD_POOL];
+		float humidity[GROOT_CHILD_POOL];
+		uint8_t extra[GROOT_CHILD_POOL]; //Slot in extras or GROOT_NO_SLOT
+		uint8_t next[GROOT_CHILD_POOL]; //Next free slot
+		uint8_t free; //First free slot or GROOT_NO_SLOT
+		union GROOT_PARTIAL_EXTRA extras[GROOT_EXTRA_POOL];
+		uint8_t extra_next[GROOT_EXTRA_POOL];
+		uint8_t extra_free;
+	};
+#endif
+
+/**
+ * @brief The children associated with a query
+ * @details Slots of the children in the node's GROOT_CHILD_SLOTS. Entries
+ *          0..length-1 are in use and the children that reported come first,
+ *          0..present-1. The running value is kept up to date as values land so
+ *          an epoch does not rescan the children.
+ */
+#ifndef GROOT_SRT_CHILDREN
+	struct GROOT_SRT_CHILDREN{
+		uint8_t length;
+		uint8_t present; //Children with a partial state
+		uint8_t slot[GROOT_CHILD_LIMIT];
+		uint8_t aggregator; //What running holds. GROOT_MAX: max, GROOT_MIN: min, GROOT_SUM, GROOT_AVG: sum
+		uint8_t stale; //Sensors whose min or max must be rescanned
+		uint8_t updates; //Updates since the running value was rebuilt
+		uint16_t total; //Running count over the children
+		struct GROOT_SENSORS_DATA running;
+	};
+#endif
+
+/**
+ * @brief The neighbours that are the parent of a query
+ * @details Every query has at most one parent, so GROOT_QUERY_LIMIT entries always
+ *          fit. A publish heard from a neighbour stamps its entry once for all the
+ *          queries it parents. An entry with no queries is free.
+ */
+#ifndef GROOT_NEIGHBORS
+	struct GROOT_NEIGHBORS{
+		rimeaddr_t address[GROOT_QUERY_LIMIT];
+		uint16_t last_seen[GROOT_QUERY_LIMIT]; //GROOT_STAMP of the neighbour's last publish. 0 never
+		uint8_t queries[GROOT_QUERY_LIMIT]; //Queries the neighbour is the parent of
+		struct GROOT_TIMER sweep;
 	};
 #endif
 
@@ -228,18 +830,44 @@
 		struct GROOT_QUERY_ITEM *next;
 		uint16_t query_id;
 		rimeaddr_t ereceiver;
+		uint8_t handle; //With ereceiver names the query in frames other than its floods
 		rimeaddr_t parent;
 		rimeaddr_t rcv_alter;
-		uint8_t parent_is_cluster;
-		uint8_t agg_passes;
-		uint8_t is_serviced;
-		unsigned long parent_last_seen; //When was parent last publish
-		unsigned long unsubscribed; //What time unsubscribe received
-		unsigned long last_published; //Last time the query was published
-		struct ctimer query_timer;
-		struct ctimer maintainer_t;
+		uint8_t parent_is_cluster : 1;
+		uint8_t is_serviced : 1;
+		uint8_t unsubscribed : 1; //Unsubscribe received. Removed when query_timer fires
+		uint8_t join_pending : 1; //Waiting for the node's join timer to join the parent's cluster
+		uint8_t altered : 1; //Spread as an alteration. The version can wrap back to 0
+		uint8_t depth; //Hops from the sink
+		uint8_t height; //Tree levels below the node, from its children's reports of the last epoch
+		uint8_t height_next; //Tree levels below the node reported so far this epoch
+		uint8_t span; //Depth of the deepest node of the branch, from the parent's publishes. 0 not known
+		uint8_t steady : 4; //Epochs the tree below the node has not grown, up to GROOT_SLOT_SETTLE
+		uint8_t lower : 4; //Epochs in a row the children reported a lower tree
+		uint8_t quiet; //Epochs the query did not publish since
+		clock_time_t epoch; //Local time the current epoch started
+		uint16_t epochs; //Epochs sampled since the query was taken. Numbers the sink's results
+		uint16_t slot; //Offset in the epoch of the sample the query timer waits for
+		uint16_t last_published; //GROOT_STAMP of the last publish. 0 never
+		struct GROOT_SENSORS_DATA last_sent; //Values of the last publish
+		struct GROOT_QUERY_STATS stats;
+		struct GROOT_TIMER query_timer; //Next sample, or the removal of an unsubscribed query
+		struct GROOT_TRICKLE trickle; //Keeps the query's subscribe, alteration or unsubscribe spreading
 		struct GROOT_QUERY query;
-		struct GROOT_SRT_CHILD *children;
+		struct GROOT_SRT_CHILDREN children;
+	};
+#endif
+
+/**
+ * @brief Summary of the sensors in the node's subtree
+ * @details Built from the capability children put in the header of everything they
+ *          send their parent, for any query. Each sensor type lasts GROOT_SUBTREE_TIMEOUT
+ *          from the last child that reported it.
+ */
+#ifndef GROOT_SUBTREE
+	struct GROOT_SUBTREE{
+		unsigned long seen[4]; //When a child last reported each sensor type, indexed by type - 1
+		unsigned long since; //When the node took its first query
 	};
 #endif
 
@@ -250,15 +878,85 @@
  * @param GROOT_SENSORS Sensors supported by the mote
  * @param GROOT_CHANNELS Channels needed for mote
  * @param is_sink is this a sink or a sensor?
+ * @param GROOT_SUBTREE Sensors below the node
+ * @param result Where the sink hands its results
+ * @param GROOT_STATS Counters of the node
+ * @param stats_timer Next stats report
+ * @param join_timer Next cluster join of the queries with join_pending
+ * @param handle Last handle the sink gave a query
+ * @param report Where the sink hands stats reports
  */
 #ifndef GROOT_LOCAL
  	struct GROOT_LOCAL{
  		struct GROOT_SENSORS sensors;
  		struct GROOT_CHANNELS *channels;
  		uint8_t is_sink;
+ 		struct GROOT_SUBTREE subtree;
+ 		void (*result)(uint16_t query_id, uint16_t epoch, struct GROOT_PARTIAL *partial);
+ 		struct GROOT_STATS stats;
+ 		struct GROOT_TIMER stats_timer;
+ 		struct GROOT_TIMER join_timer;
+ 		uint8_t handle;
+ 		void (*report)(const rimeaddr_t *node, struct GROOT_STATS *stats);
  	};
 #endif
 
+/**
+ * @brief A query a user subscribed at the sink
+ * @details Answered by the network query it was merged into, taking every result whose
+ *          epoch is a multiple of sample_rate over the network query's rate
+ */
+#ifndef GROOT_SINK_QUERY
+	struct GROOT_SINK_QUERY{
+		uint16_t query_id; //Given by the user. 0 free
+		uint16_t network_id; //Network query answering it
+		uint16_t sample_rate;
+		uint8_t aggregator;
+		struct GROOT_SENSORS sensors_required;
+		struct GROOT_QUERY_OPTIONS options;
+	};
+#endif
+
+/**
+ * @brief A result the sink stored for a user query
+ */
+#ifndef GROOT_SINK_RESULT
+	struct GROOT_SINK_RESULT{
+		uint16_t query_id;
+		uint16_t sample_id; //Epoch at the user query's rate. The node's sample without aggregation
+		unsigned long timestamp; //clock_seconds() of the sink when the result came in
+		uint16_t count; //Readings in the result
+		struct GROOT_SENSORS_DATA values; //Finalized. 0 for sensors the query does not need
+	};
+#endif
+
+/**
+ * @brief Latest results of a user query
+ * @details Ring buffer. The oldest result is overwritten when it is full
+ */
+#ifndef GROOT_SINK_STORE
+	struct GROOT_SINK_STORE{
+		uint8_t head; //Where the next result goes
+		uint8_t length;
+		struct GROOT_SINK_RESULT results[GROOT_SINK_STORE_LENGTH];
+	};
+#endif
+
+/**
+ * @brief A query the sink runs in the network for one or more user queries
+ * @details Users' queries share it when they have the same aggregator and options. It
+ *          needs the union of their sensors at the greatest common divisor of their rates.
+ */
+#ifndef GROOT_SINK_NETWORK
+	struct GROOT_SINK_NETWORK{
+		uint16_t query_id; //0 free
+		uint16_t sample_rate;
+		uint8_t aggregator;
+		struct GROOT_SENSORS sensors_required;
+		struct GROOT_QUERY_OPTIONS options;
+	};
+#endif
+
 /**
  * @brief Initialise protocol
  * @details Initialise Groot portocol
@@ -279,9 +977,69 @@ groot_prot_init(struct GROOT_SENSORS *sensors, struct GROOT_CHANNELS *channels,
  * @param sample_rate How often to sample the query
  * @param GROOT_SENSORS What sensor data will be collected.
  * @param aggregator What aggregation to use.
+ * @param GROOT_QUERY_OPTIONS Quantile error and range, epsilon and predicates. NULL subscribes
+ *        with GROOT_QUANTILE_ERROR, GROOT_HISTOGRAM_LOW..HIGH and neither, and keeps the
+ *        query's for an alteration
+ * @return 1 the sink holds the query and its trickle spreads it, even if this first
+ *         broadcast is lost. 0 nothing was sent: no handle or item was free, or there
+ *         is no query to alter
  */
 int
-groot_qry_snd(uint16_t query_id, uint8_t type, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregator);
+groot_qry_snd(uint16_t query_id, uint8_t type, uint16_t sample_rate, struct GROOT_SENSORS *data_required, uint8_t aggregator,
+	struct GROOT_QUERY_OPTIONS *options);
+
+/**
+ * @brief Hand the sink's results to a callback instead of printing them
+ * @details An aggregating query gives one result per epoch, the state merged from the
+ *          sink's children. Without aggregation every sample that reaches the sink is
+ *          a result. Results of one query, or of one node without aggregation, come with
+ *          consecutive epoch numbers. An aggregating query counts its epochs from its
+ *          subscription, so alterations and clock wraps do not break the count.
+ * 
+ * @param result Callback or NULL to print the results
+ */
+void
+groot_result_callback(void (*result)(uint16_t query_id, uint16_t epoch, struct GROOT_PARTIAL *partial));
+
+/**
+ * @brief Hand the stats reports that reach the sink to a callback
+ * @details Nodes report every GROOT_STATS_PERIOD seconds while they have a query
+ *          with a parent. Reports are dropped when no callback is set.
+ * 
+ * @param report Callback or NULL
+ */
+void
+groot_stats_callback(void (*report)(const rimeaddr_t *node, struct GROOT_STATS *stats));
+
+/**
+ * @brief Read the counters of the node
+ * @details Read the counters of the node
+ * 
+ * @param GROOT_STATS Where the counters are copied
+ */
+void
+groot_node_stats(struct GROOT_STATS *stats);
+
+/**
+ * @brief Read the counters of a query
+ * @details Adds up the query's counters for every sink that sent it
+ * 
+ * @param query_id Query
+ * @param GROOT_STATS Where the counters are copied
+ * @return 1 the node has the query 0 otherwise
+ */
+uint8_t
+groot_query_stats(uint16_t query_id, struct GROOT_STATS *stats);
+
+/**
+ * @brief Count the outcome of a runicast
+ * @details Called from the runicast sent and timed out callbacks
+ * 
+ * @param retransmissions Retransmissions it took
+ * @param timedout 1 never acknowledged
+ */
+void
+groot_runicast_done(uint8_t retransmissions, uint8_t timedout);
 
 /**
  * @brief Handle the receive values.
@@ -299,4 +1057,6 @@ groot_rcv(const rimeaddr_t *from);
  * @param query_id The query id needed for deletion
  */
 int
-groot_unsubscribe_snd(uint16_t query_id);
\ No newline at end of file
+groot_unsubscribe_snd(uint16_t query_id);
+
+#endif /* __GROOT_H__ */
@@ -0,0 +1,203 @@
+/**
+ * @file
+ * 	Microbenchmark of the GROOT aggregation kernel against per sensor aggregation.
+ * @details
+ * 	aggregate_per_sensor() is the aggregation cb_publish_aggregate used before the
+ * 	fused kernel: one pass over the children for every required sensor. running_ns is
+ * 	the cost of reading and finalizing the running aggregates at publish time. Build with
+ * 	DEFINES=-DGROOT_CHILD_LIMIT=n to change the size of the children table.
+ */
+
+#include "contiki.h"
+#include "groot-aggregate.h"
+#include <math.h>
+#include <time.h>
+
+#undef printf
+
+#ifndef BENCH_ITERATIONS
+	#define BENCH_ITERATIONS 2000000
+#endif
+
+static volatile float sink;
+/*------------------------------------------------- Per Sensor Aggregation ----------------------------------------------*/
+static float
+*get_sensor_data(uint8_t sensor){
+	switch(sensor){
+		case SENSOR_CO2:
+			return groot_child_slots.co2;
+		case SENSOR_NO:
+			return groot_child_slots.no;
+		case SENSOR_HUMIDITY:
+			return groot_child_slots.humidity;
+		case SENSOR_TEMP:
+			return groot_child_slots.temp;
+	}
+
+	return NULL;
+}
+
+static float
+aggregate_calc(struct GROOT_SRT_CHILDREN *children, uint8_t sensor, uint8_t aggregator){
+	float *values = get_sensor_data(sensor);
+	float result = 0, tmp_result = 0, count = 0;
+	uint8_t i;
+
+	if(values == NULL){
+		return 0;
+	}
+
+	switch(aggregator){
+		case GROOT_MAX:
+			for(i = 0; i < children->length; i++){
+				if(tmp_result < values[children->slot[i]]){
+					tmp_result = values[children->slot[i]];
+				}
+			}
+			result = tmp_result;
+			break;
+		case GROOT_AVG:
+			for(i = 0; i < children->length; i++){
+				tmp_result += values[children->slot[i]];
+				count += 1;
+			}
+			result = tmp_result / count;
+			break;
+		case GROOT_MIN:
+			for(i = 0; i < children->length; i++){
+				if(tmp_result > values[children->slot[i]]){
+					tmp_result = values[children->slot[i]];
+				}
+				result = tmp_result;
+			}
+			break;
+	}
+	return result;
+}
+
+static void
+aggregate_per_sensor(struct GROOT_SRT_CHILDREN *children, struct GROOT_SENSORS *req, uint8_t aggregator,
+	struct GROOT_SENSORS_DATA *data){
+	if(req->co2 == 1){
+		data->co2 = aggregate_calc(children, SENSOR_CO2, aggregator);
+	}
+	if(req->no == 1){
+		data->no = aggregate_calc(children, SENSOR_NO, aggregator);
+	}
+	if(req->temp == 1){
+		data->temp = aggregate_calc(children, SENSOR_TEMP, aggregator);
+	}
+	if(req->humidity == 1){
+		data->humidity = aggregate_calc(children, SENSOR_HUMIDITY, aggregator);
+	}
+}
+/*------------------------------------------------- Benchmark -----------------------------------------------------------*/
+static double
+elapsed_ns(struct timespec *start, struct timespec *end){
+	return (end->tv_sec - start->tv_sec)*1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief Check the kernel against a double precision reference
+ */
+static int
+check(struct GROOT_SRT_CHILDREN *children, uint8_t aggregator, struct GROOT_SENSORS_DATA *data){
+	float *values[4] = {groot_child_slots.co2, groot_child_slots.no, groot_child_slots.temp, groot_child_slots.humidity};
+	float got[4] = {data->co2, data->no, data->temp, data->humidity};
+	double expected;
+	uint8_t s, i;
+
+	for(s = 0; s < 4; s++){
+		expected = values[s][children->slot[0]];
+		for(i = 0; i < children->length; i++){
+			if(aggregator == GROOT_MAX){
+				expected = fmax(expected, values[s][children->slot[i]]);
+			} else if(aggregator == GROOT_MIN){
+				expected = fmin(expected, values[s][children->slot[i]]);
+			} else if(i == 0){
+				expected = values[s][children->slot[i]];
+			} else {
+				expected += values[s][children->slot[i]];
+			}
+		}
+		if(aggregator == GROOT_AVG){
+			expected /= children->length;
+		}
+		if(fabs(expected - got[s]) > 1e-4*fabs(expected)){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int
+main(void){
+	static const char *names[] = {"max", "avg", "min"};
+	static const uint8_t aggregators[] = {GROOT_MAX, GROOT_AVG, GROOT_MIN};
+	struct GROOT_SENSORS req = {1, 1, 1, 1};
+	struct GROOT_QUERY qry;
+	struct GROOT_SRT_CHILDREN children;
+	struct GROOT_SENSORS_DATA data;
+	struct GROOT_PARTIAL partial;
+	struct timespec start, end;
+	double per_sensor, fused, running;
+	uint32_t it;
+	uint8_t a, i, c;
+
+	srand(1);
+	groot_child_pool_init();
+	memset(&children, 0, sizeof(struct GROOT_SRT_CHILDREN));
+	children.length = GROOT_CHILD_LIMIT;
+	children.present = GROOT_CHILD_LIMIT;
+	for(i = 0; i < GROOT_CHILD_LIMIT; i++){
+		children.slot[i] = c = groot_child_alloc();
+		groot_child_slots.count[c] = 1;
+		groot_child_slots.co2[c] = 400 + (rand()%100000)/100.0f;
+		groot_child_slots.no[c] = (rand()%10000)/100.0f;
+		groot_child_slots.temp[c] = 10 + (rand()%3000)/100.0f;
+		groot_child_slots.humidity[c] = 20 + (rand()%6000)/100.0f;
+	}
+
+	printf("children=%d iterations=%d\n", GROOT_CHILD_LIMIT, BENCH_ITERATIONS);
+	for(a = 0; a < 3; a++){
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(it = 0; it < BENCH_ITERATIONS; it++){
+			//Stop the compiler from hoisting the call out of the loop
+			__asm__ __volatile__("" : : "g"(&children) : "memory");
+			aggregate_per_sensor(&children, &req, aggregators[a], &data);
+			sink = data.co2 + data.no + data.temp + data.humidity;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		per_sensor = elapsed_ns(&start, &end)/BENCH_ITERATIONS;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(it = 0; it < BENCH_ITERATIONS; it++){
+			//Stop the compiler from hoisting the call out of the loop
+			__asm__ __volatile__("" : : "g"(&children) : "memory");
+			groot_aggregate(&children, &req, aggregators[a], &data);
+			sink = data.co2 + data.no + data.temp + data.humidity;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		fused = elapsed_ns(&start, &end)/BENCH_ITERATIONS;
+
+		//Running value is kept up to date as children report
+		children.aggregator = aggregators[a];
+		groot_running_rebuild(&children);
+		qry.aggregator = aggregators[a];
+		memcpy(&qry.sensors_required, &req, sizeof(struct GROOT_SENSORS));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(it = 0; it < BENCH_ITERATIONS; it++){
+			__asm__ __volatile__("" : : "g"(&children) : "memory");
+			groot_running_result(&children, &qry, &partial);
+			groot_partial_finalize(aggregators[a], &partial, &data);
+			sink = data.co2 + data.no + data.temp + data.humidity;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		running = elapsed_ns(&start, &end)/BENCH_ITERATIONS;
+
+		printf("aggregator=%s per_sensor_ns=%.2f fused_ns=%.2f running_ns=%.2f speedup=%.2f correct=%d\n", names[a],
+			per_sensor, fused, running, per_sensor/fused, check(&children, aggregators[a], &data));
+	}
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+#!/bin/sh
+# GROOT scaling benchmark. Runs groot-sim over every combination of the settings
+# below and writes one CSV row per run. GROOT_CHILD_LIMIT is a build setting, so
+# the simulator is rebuilt for every child limit.
+#
+# Every setting can be overridden from the environment, e.g.
+#   MOTES="100 900" AGGREGATORS=avg ./bench-scaling.sh > scaling.csv
+#
+# With BASELINE set to an earlier output the rows are compared to it and the script
+# fails if frames, bytes or latency grew, or delivery fell, by more than TOLERANCE
+# percent.
+
+MOTES=${MOTES:-"100 400"}
+TOPOLOGIES=${TOPOLOGIES:-"grid random line"}
+DENSITIES=${DENSITIES:-"6 12"} # Random topology only
+QUERIES=${QUERIES:-"1 4"}
+AGGREGATORS=${AGGREGATORS:-"max avg quantile none"}
+CHILD_LIMITS=${CHILD_LIMITS:-"3 5 8"}
+DURATION=${DURATION:-600}
+SEED=${SEED:-1}
+TOLERANCE=${TOLERANCE:-5}
+BASELINE=${BASELINE:-}
+
+SIM_DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+OUT=$WORK/results.csv
+trap 'rm -rf "$WORK"' EXIT
+
+for limit in $CHILD_LIMITS; do
+	make -s -C "$SIM_DIR" clean >/dev/null
+	make -s -C "$SIM_DIR" groot-sim DEFINES=-DGROOT_CHILD_LIMIT=$limit >/dev/null || exit 1
+	cp "$SIM_DIR/groot-sim" "$WORK/groot-sim-$limit"
+done
+make -s -C "$SIM_DIR" clean >/dev/null
+make -s -C "$SIM_DIR" >/dev/null
+
+for limit in $CHILD_LIMITS; do
+	for topology in $TOPOLOGIES; do
+		densities=8
+		if [ "$topology" = random ]; then
+			densities=$DENSITIES
+		fi
+		for motes in $MOTES; do
+			for density in $densities; do
+				for queries in $QUERIES; do
+					for aggregator in $AGGREGATORS; do
+						"$WORK/groot-sim-$limit" -o -n "$motes" -T "$topology" -d "$density" -q "$queries" \
+							-a "$aggregator" -t "$DURATION" -S "$SEED" || exit 1
+					done
+				done
+			done
+		done
+	done
+done | awk 'NR == 1 || !/^topology,/' > "$OUT"
+
+cat "$OUT"
+
+if [ -z "$BASELINE" ]; then
+	exit 0
+fi
+
+# Rows are matched on the settings, the first nine columns
+awk -F, -v tolerance="$TOLERANCE" '
+	FNR == 1 {
+		for(i = 1; i <= NF; i++){
+			column[$i] = i
+		}
+		next
+	}
+	{
+		key = $1
+		for(i = 2; i <= 9; i++){
+			key = key "," $i
+		}
+	}
+	NR == FNR {
+		frames[key] = $column["frames_tx"]
+		bytes[key] = $column["bytes_tx"]
+		latency[key] = $column["latency_mean_ms"]
+		delivery[key] = $column["delivery_ratio"]
+		next
+	}
+	!(key in frames) {
+		next
+	}
+	{
+		limit = 1 + tolerance/100
+		if($column["frames_tx"] > frames[key]*limit || $column["bytes_tx"] > bytes[key]*limit ||
+			$column["latency_mean_ms"] > latency[key]*limit || $column["delivery_ratio"]*limit < delivery[key]){
+			printf("REGRESSION %s frames %d->%d bytes %d->%d latency %d->%d delivery %.3f->%.3f\n", key, frames[key],
+				$column["frames_tx"], bytes[key], $column["bytes_tx"], latency[key], $column["latency_mean_ms"],
+				delivery[key], $column["delivery_ratio"]) > "/dev/stderr"
+			failed = 1
+		}
+	}
+	END {
+		exit failed
+	}
+' "$BASELINE" "$OUT"
@@ -0,0 +1,153 @@
+/**
+ * @file
+ * 	Checks of the GROOT quantile digest.
+ * @details
+ * 	Readings are turned into GROOT_QUANTILE partial states and merged in a random
+ * 	order. The merged digest must keep every reading within GROOT_QUANTILE_NODES, and
+ * 	its quantiles must lie in the query's range in order of percent. When the readings
+ * 	fall in a few buckets the digest has room for, every quantile must also be within
+ * 	the query's rank error, counted in the buckets of the query's range. Readings
+ * 	spread over every bucket fold further than the rank error to fit the nodes.
+ * 	Digests read back from a packet with a bad key or too many nodes are refused.
+ */
+
+#include "contiki.h"
+#include "groot-aggregate.h"
+#include "groot-digest.h"
+#include "check.h"
+#include <string.h>
+
+#define CHECK_ROUNDS 300
+#define CHECK_READINGS 200
+#define CHECK_LEAVES (1 << GROOT_QUANTILE_BITS)
+#define CHECK_ROOMY 8 //Buckets in use the digest holds within its rank error
+
+static struct GROOT_PARTIAL states[CHECK_READINGS];
+static uint8_t buckets[CHECK_READINGS];
+
+/**
+ * @brief Bucket of a reading in the query's range, as the digest counts it
+ */
+static uint8_t
+bucket(const struct GROOT_QUERY *qry, float reading){
+	int leaf = (reading - qry->low) * CHECK_LEAVES / (qry->high - qry->low);
+
+	if(leaf < 0){
+		return 0;
+	}
+	return (leaf >= CHECK_LEAVES) ? CHECK_LEAVES - 1 : leaf;
+}
+
+/**
+ * @brief Readings the quantile is off by in rank
+ * @details 0 when the rank of the quantile falls among the readings of its bucket
+ */
+static uint32_t
+rank_error(const struct GROOT_QUERY *qry, uint8_t length, uint8_t percent, float quantile){
+	uint32_t rank = (uint32_t)length * percent / 100, below = 0, upto = 0;
+	uint8_t at = bucket(qry, quantile), i;
+
+	for(i = 0; i < length; i++){
+		below += (buckets[i] < at);
+		upto += (buckets[i] <= at);
+	}
+	if(rank < below){
+		return below - rank;
+	}
+	return (rank >= upto) ? rank - upto + 1 : 0;
+}
+
+/**
+ * @brief Pack a digest and read it back whole, then with a node id 0 and too many nodes
+ */
+static void
+check_unpack(const struct GROOT_QUERY *qry, const struct GROOT_PARTIAL *partial){
+	uint8_t buf[PACKETBUF_SIZE], size = groot_partial_pack(qry, partial, buf);
+	uint8_t *length = buf + sizeof(uint16_t), *key = length + 1;
+	struct GROOT_PARTIAL read;
+
+	CHECK(groot_partial_unpack(qry, buf, size, &read) == size);
+	if(*length == 0){
+		return;
+	}
+	*key &= ~0x3F;
+	CHECK(groot_partial_unpack(qry, buf, size, &read) == 0);
+	*length = GROOT_QUANTILE_NODES + 1;
+	CHECK(groot_partial_unpack(qry, buf, PACKETBUF_SIZE, &read) == 0);
+}
+
+/**
+ * @brief Merge random readings of the temperature and check the digest
+ *
+ * @param spread Buckets the readings fall in, spaced over the range. CHECK_LEAVES
+ *               draws them from anywhere, including outside the range
+ */
+static void
+check_digest(int16_t low, int16_t high, uint8_t error, uint8_t spread){
+	static const uint8_t percents[] = {5, 25, 50, 75, 95};
+	struct GROOT_QUERY qry;
+	struct GROOT_SENSORS_DATA reading;
+	struct GROOT_DIGEST *digest;
+	uint8_t length, left, i, j, p;
+	uint32_t round, total;
+	float quantile, last;
+
+	memset(&qry, 0, sizeof(struct GROOT_QUERY));
+	qry.aggregator = GROOT_QUANTILE;
+	qry.sensors_required.temp = 1;
+	qry.error = error;
+	qry.low = low;
+	qry.high = high;
+	memset(&reading, 0, sizeof(struct GROOT_SENSORS_DATA));
+
+	for(round = 0; round < CHECK_ROUNDS; round++){
+		length = 1 + check_random() % CHECK_READINGS;
+		for(i = 0; i < length; i++){
+			if(spread < CHECK_LEAVES){
+				reading.temp = low + (check_random() % spread * (CHECK_LEAVES / spread) + 0.5f) * (high - low) / CHECK_LEAVES;
+			} else {
+				reading.temp = low - 10 + (float)(check_random() % 1000) * (high - low + 20) / 1000;
+			}
+			buckets[i] = bucket(&qry, reading.temp);
+			groot_partial_init(&qry, &reading, &states[i]);
+		}
+		for(left = length; left > 1; left--){
+			i = check_random() % left;
+			j = (i + 1 + check_random() % (left - 1)) % left;
+			groot_partial_merge(GROOT_QUANTILE, &states[i], &states[j]);
+			memcpy(&states[j], &states[left - 1], sizeof(struct GROOT_PARTIAL));
+		}
+
+		digest = &states[0].extra.digest;
+		for(total = 0, i = 0; i < digest->length; i++){
+			total += digest->count[i];
+		}
+		CHECK(states[0].count == length);
+		CHECK(total == length);
+		CHECK(digest->length <= GROOT_QUANTILE_NODES);
+		check_unpack(&qry, &states[0]);
+
+		last = low;
+		for(p = 0; p < sizeof(percents); p++){
+			quantile = groot_digest_quantile(digest, 2, percents[p]);
+			CHECK(quantile >= last && quantile <= high);
+			if(spread <= CHECK_ROOMY){
+				CHECK(rank_error(&qry, length, percents[p], quantile)*100 <= (uint32_t)error*length + 100);
+			}
+			last = quantile;
+		}
+	}
+}
+
+int
+main(void){
+	uint8_t spread;
+
+	for(spread = 1; spread <= CHECK_LEAVES; spread *= 2){
+		check_digest(GROOT_HISTOGRAM_LOW, GROOT_HISTOGRAM_HIGH, GROOT_QUANTILE_ERROR, spread);
+		check_digest(-40, 60, 5, spread);
+		check_digest(0, 1000, 20, spread);
+	}
+
+	return CHECK_DONE("check-digest");
+}
@@ -0,0 +1,84 @@
+/**
+ * @file
+ * 	Checks of the query index of groot.c.
+ * @details
+ * 	Queries are added and removed at random with handles and sinks picked from a few
+ * 	values, so probes collide and wrap. After every change each query must be found,
+ * 	removed keys must not, and no probe may cross an empty slot before reaching its
+ * 	query, which is what the backward-shift delete keeps. Includes groot.c for its
+ * 	static index functions.
+ */
+
+#include "groot.c"
+#include "check.h"
+
+#define CHECK_ROUNDS 20000
+
+static struct GROOT_QUERY_ITEM items[GROOT_QUERY_LIMIT];
+static uint8_t indexed[GROOT_QUERY_LIMIT];
+
+/**
+ * @brief Check every slot between the home slot of each entry and the entry is in use
+ */
+static uint8_t
+index_chains_whole(void){
+	uint16_t i, j;
+
+	for(i = 0; i < GROOT_QUERY_INDEX_SIZE; i++){
+		if(groot_qry_index[i] == NULL){
+			continue;
+		}
+		for(j = qry_hash(groot_qry_index[i]->handle, &groot_qry_index[i]->ereceiver); j != i;
+			j = (j + 1) & (GROOT_QUERY_INDEX_SIZE - 1)){
+			if(groot_qry_index[j] == NULL){
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+int
+main(void){
+	uint16_t slot, used;
+	uint32_t round;
+	uint8_t i, length;
+
+	memset(groot_qry_index, 0, sizeof(groot_qry_index));
+	for(round = 0; round < CHECK_ROUNDS; round++){
+		i = check_random() % GROOT_QUERY_LIMIT;
+		if(indexed[i]){
+			qry_index_rm(&items[i]);
+			indexed[i] = 0;
+		} else {
+			//Few keys so they collide. A key is in the index once at most
+			items[i].handle = 1 + check_random() % 4;
+			items[i].ereceiver.u8[0] = check_random() % 4;
+			items[i].ereceiver.u8[1] = 0;
+			slot = qry_index_slot(items[i].handle, &items[i].ereceiver);
+			if(groot_qry_index[slot] != NULL){
+				continue;
+			}
+			qry_index_add(&items[i]);
+			indexed[i] = 1;
+		}
+
+		length = 0;
+		for(i = 0; i < GROOT_QUERY_LIMIT; i++){
+			slot = qry_index_slot(items[i].handle, &items[i].ereceiver);
+			if(indexed[i]){
+				CHECK(groot_qry_index[slot] == &items[i]);
+				length += 1;
+			} else if(groot_qry_index[slot] != NULL){
+				CHECK(groot_qry_index[slot] != &items[i]);
+			}
+		}
+		for(used = 0, slot = 0; slot < GROOT_QUERY_INDEX_SIZE; slot++){
+			used += (groot_qry_index[slot] != NULL);
+		}
+		CHECK(used == length);
+		CHECK(index_chains_whole());
+	}
+
+	return CHECK_DONE("check-index");
+}
@@ -0,0 +1,170 @@
+/**
+ * @file
+ * 	Checks of the GROOT partial states.
+ * @details
+ * 	Readings are turned into partial states and merged in a random order, as a tree
+ * 	of any shape would, with states packed and unpacked on the way. The finalized
+ * 	result must match the one worked out from the readings directly.
+ */
+
+#include "contiki.h"
+#include "groot-aggregate.h"
+#include "check.h"
+#include <math.h>
+#include <string.h>
+
+#define CHECK_ROUNDS 500
+#define CHECK_READINGS 40
+
+static struct GROOT_PARTIAL states[CHECK_READINGS];
+static float readings[CHECK_READINGS][4];
+
+static float
+*sensor_data(struct GROOT_SENSORS_DATA *data, uint8_t s){
+	switch(s){
+		case 0:
+			return &data->co2;
+		case 1:
+			return &data->no;
+		case 2:
+			return &data->temp;
+	}
+	return &data->humidity;
+}
+
+static uint8_t
+*sensor_required(struct GROOT_SENSORS *required, uint8_t s){
+	switch(s){
+		case 0:
+			return &required->co2;
+		case 1:
+			return &required->no;
+		case 2:
+			return &required->temp;
+	}
+	return &required->humidity;
+}
+
+/**
+ * @brief Result of the aggregator worked out from the readings
+ */
+static double
+expected(uint8_t aggregator, uint8_t s, uint8_t length){
+	double width = (double)(GROOT_HISTOGRAM_HIGH - GROOT_HISTOGRAM_LOW) / GROOT_HISTOGRAM_BUCKETS;
+	double value = readings[0][s], sum = 0, mean, squares = 0;
+	int b;
+	uint8_t i;
+
+	for(i = 0; i < length; i++){
+		sum += readings[i][s];
+	}
+	mean = sum / length;
+	for(i = 0; i < length; i++){
+		squares += (readings[i][s] - mean) * (readings[i][s] - mean);
+		value = (aggregator == GROOT_MAX) ? fmax(value, readings[i][s]) : fmin(value, readings[i][s]);
+	}
+
+	switch(aggregator){
+		case GROOT_MAX:
+		case GROOT_MIN:
+			return value;
+		case GROOT_AVG:
+			return mean;
+		case GROOT_SUM:
+			return sum;
+		case GROOT_COUNT:
+			return length;
+		case GROOT_VARIANCE:
+			return squares / length;
+	}
+
+	//GROOT_HISTOGRAM, readings at the middle of their buckets
+	for(sum = 0, i = 0; i < length; i++){
+		b = (readings[i][s] - GROOT_HISTOGRAM_LOW) / width;
+		b = (b < 0) ? 0 : ((b >= GROOT_HISTOGRAM_BUCKETS) ? GROOT_HISTOGRAM_BUCKETS - 1 : b);
+		sum += GROOT_HISTOGRAM_LOW + (b + 0.5) * width;
+	}
+	return sum / length;
+}
+
+/**
+ * @brief Pack a state and read it back
+ */
+static void
+round_trip(const struct GROOT_QUERY *qry, struct GROOT_PARTIAL *partial){
+	uint8_t buf[PACKETBUF_SIZE], size = groot_partial_size(qry, partial);
+	struct GROOT_PARTIAL copy;
+
+	CHECK(groot_partial_pack(qry, partial, buf) == size);
+	CHECK(groot_partial_unpack(qry, buf, size, &copy) == size);
+	CHECK(groot_partial_unpack(qry, buf, size - 1, &copy) == 0);
+	CHECK(groot_partial_unpack(qry, buf, size, partial) == size);
+}
+
+static void
+check_aggregator(uint8_t aggregator){
+	struct GROOT_QUERY qry;
+	struct GROOT_SENSORS_DATA reading, result;
+	struct GROOT_PARTIAL empty;
+	uint8_t length, left, i, j, s;
+	uint32_t round;
+	double want;
+
+	for(round = 0; round < CHECK_ROUNDS; round++){
+		memset(&qry, 0, sizeof(struct GROOT_QUERY));
+		qry.aggregator = aggregator;
+		for(s = 0; s < 4; s++){
+			*sensor_required(&qry.sensors_required, s) = check_random() % 2;
+		}
+
+		length = 1 + check_random() % CHECK_READINGS;
+		for(i = 0; i < length; i++){
+			for(s = 0; s < 4; s++){
+				//Some readings fall outside the histogram
+				readings[i][s] = (float)(check_random() % 1200) / 10 - 10;
+				*sensor_data(&reading, s) = readings[i][s];
+			}
+			groot_partial_init(&qry, &reading, &states[i]);
+		}
+
+		//Merge two states at random until one is left
+		for(left = length; left > 1; left--){
+			i = check_random() % left;
+			j = (i + 1 + check_random() % (left - 1)) % left;
+			if(check_random() % 4 == 0){
+				round_trip(&qry, &states[j]);
+			}
+			groot_partial_merge(aggregator, &states[i], &states[j]);
+			memcpy(&states[j], &states[left - 1], sizeof(struct GROOT_PARTIAL));
+		}
+		//Merging an empty state changes nothing, either way round
+		memset(&empty, 0, sizeof(struct GROOT_PARTIAL));
+		groot_partial_merge(aggregator, &states[0], &empty);
+		groot_partial_merge(aggregator, &empty, &states[0]);
+		round_trip(&qry, &empty);
+
+		CHECK(empty.count == length);
+		groot_partial_finalize(aggregator, &empty, &result);
+		for(s = 0; s < 4; s++){
+			if(*sensor_required(&qry.sensors_required, s) != 1 && aggregator != GROOT_COUNT){
+				CHECK(*sensor_data(&result, s) == 0);
+				continue;
+			}
+			want = expected(aggregator, s, length);
+			CHECK(fabs(*sensor_data(&result, s) - want) <= 1e-3 * fmax(1, fabs(want)));
+		}
+	}
+}
+
+int
+main(void){
+	check_aggregator(GROOT_MAX);
+	check_aggregator(GROOT_AVG);
+	check_aggregator(GROOT_MIN);
+	check_aggregator(GROOT_SUM);
+	check_aggregator(GROOT_COUNT);
+	check_aggregator(GROOT_VARIANCE);
+	check_aggregator(GROOT_HISTOGRAM);
+
+	return CHECK_DONE("check-partial");
+}
@@ -0,0 +1,150 @@
+/**
+ * @file
+ * 	Checks of the GROOT timer wheel.
+ * @details
+ * 	Runs groot-wheel.c against a stand-in clock and ctimer. Timers are set with delays
+ * 	up to past the reach of the wheel, and the events set and stop timers again.
+ * 	Every timer must fire once, in order of expiry, on its tick when the ctimer is on
+ * 	time, and no later than the ctimer when it runs late. Times are compared across
+ * 	the wrap of clock_time_t, so the check also runs with a 16-bit clock.
+ */
+
+#include "contiki.h"
+#include "groot-wheel.h"
+#include "check.h"
+
+#define CHECK_TIMERS 64
+#define CHECK_FIRES 20000
+#define CHECK_HALF ((clock_time_t)~(clock_time_t)0 >> 1) //Longest time a wrapping clock can order
+#define CHECK_REACH (sizeof(clock_time_t) > 2 ? (1UL << (GROOT_WHEEL_BITS*GROOT_WHEEL_LEVELS + 2)) : CHECK_HALF)
+#define CHECK_NOT_BEFORE(a, b) ((clock_time_t)((a) - (b)) <= CHECK_HALF)
+
+static clock_time_t check_now;
+static clock_time_t check_late; //Most ticks the ctimer runs late
+static struct ctimer *check_ct;
+static clock_time_t check_deadline;
+
+static struct GROOT_TIMER timers[CHECK_TIMERS];
+static clock_time_t expected[CHECK_TIMERS]; //Expiry of the pending timers
+static uint8_t pending[CHECK_TIMERS];
+static clock_time_t last_fired;
+static uint32_t fires;
+/*------------------------------------------------- Stand-ins -----------------------------------------------------------*/
+clock_time_t
+clock_time(void){
+	return check_now;
+}
+
+void
+ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr){
+	c->f = f;
+	c->ptr = ptr;
+	check_ct = c;
+	check_deadline = check_now + t;
+}
+
+void
+ctimer_stop(struct ctimer *c){
+	check_ct = NULL;
+}
+
+int
+ctimer_expired(struct ctimer *c){
+	return check_ct == NULL;
+}
+/*------------------------------------------------- Timers --------------------------------------------------------------*/
+static clock_time_t
+random_delay(void){
+	switch(check_random() % 4){
+		case 0:
+			return check_random() % 4;
+		case 1:
+			return check_random() % (1 << GROOT_WHEEL_BITS);
+		case 2:
+			return check_random() % (1 << (2*GROOT_WHEEL_BITS));
+	}
+	return check_random() % CHECK_REACH;
+}
+
+static void
+set_timer(uint8_t i){
+	clock_time_t delay = random_delay();
+
+	groot_timer_set(&timers[i], delay, i);
+	expected[i] = clock_time() + delay;
+	pending[i] = 1;
+}
+
+static void
+fire(struct GROOT_TIMER *t){
+	uint8_t i = t->event, j;
+
+	CHECK(t == &timers[i] && pending[i]);
+	CHECK(t->expires == expected[i]);
+	CHECK((clock_time_t)(clock_time() - t->expires) <= check_late);
+	CHECK(CHECK_NOT_BEFORE(t->expires, last_fired));
+	CHECK(groot_timer_expired(t));
+	pending[i] = 0;
+	last_fired = t->expires;
+	fires += 1;
+
+	//Events set, move and stop timers
+	if(fires < CHECK_FIRES){
+		set_timer(i);
+		j = check_random() % CHECK_TIMERS;
+		if(!pending[j]){
+			set_timer(j);
+		} else if(check_random() % 4 == 0){
+			groot_timer_stop(&timers[j]);
+			pending[j] = 0;
+			if(check_random() % 2 == 0){
+				set_timer(j);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Run the wheel until no timer is left
+ *
+ * @param late Most ticks the ctimer runs late
+ */
+static void
+run(clock_time_t late){
+	uint32_t wakes = 0;
+	uint8_t i, left;
+
+	check_late = late;
+	check_now = 1000;
+	last_fired = 0;
+	fires = 0;
+	check_ct = NULL;
+	memset(timers, 0, sizeof(timers));
+	memset(pending, 0, sizeof(pending));
+	groot_wheel_init(fire);
+	for(i = 0; i < CHECK_TIMERS; i++){
+		set_timer(i);
+	}
+
+	//A wheel that loses timers can keep waking without firing
+	while(check_ct != NULL && wakes++ < 10*CHECK_FIRES){
+		CHECK(CHECK_NOT_BEFORE(check_deadline, check_now));
+		check_now = check_deadline + ((late > 0) ? check_random() % (late + 1) : 0);
+		check_ct->f(check_ct->ptr);
+	}
+
+	for(left = 0, i = 0; i < CHECK_TIMERS; i++){
+		left += pending[i];
+	}
+	CHECK(left == 0);
+	CHECK(fires >= CHECK_FIRES);
+}
+
+int
+main(void){
+	run(0);
+	run(3);
+	run(1 << (2*GROOT_WHEEL_BITS));
+
+	return CHECK_DONE("check-wheel");
+}
@@ -0,0 +1,195 @@
+/**
+ * @file
+ * 	Checks of the GROOT wire codec.
+ * @details
+ * 	Headers of every packet type, queries of every aggregator, batch records and
+ * 	stats reports with random fields are written and read back. Every field that
+ * 	goes on the wire must come back, the sizes must agree with the size macros, and
+ * 	16-bit fields and floats must be little endian at their offsets.
+ */
+
+#include "contiki.h"
+#include "groot-wire.h"
+#include "check.h"
+#include <string.h>
+
+#define CHECK_ROUNDS 20000
+
+static const uint8_t types[] = {GROOT_SUBSCRIBE_TYPE, GROOT_UNSUBSCRIBE_TYPE, GROOT_NEW_MOTE_TYPE,
+	GROOT_ALTERATION_TYPE, GROOT_CLUSTER_JOIN_TYPE, GROOT_CLUSTER_ACCEPTED_TYPE, GROOT_CLUSTER_REJECTED_TYPE,
+	GROOT_PUBLISH_TYPE, GROOT_BATCH_TYPE, GROOT_STATS_TYPE};
+
+static uint8_t
+same_addr(const rimeaddr_t *a, const rimeaddr_t *b){
+	return a->u8[0] == b->u8[0] && a->u8[1] == b->u8[1];
+}
+
+static void
+random_addr(rimeaddr_t *addr){
+	addr->u8[0] = check_random();
+	addr->u8[1] = (check_random() % 4 == 0) ? 0 : check_random();
+}
+
+static void
+random_query(struct GROOT_QUERY *qry){
+	uint8_t i;
+
+	memset(qry, 0, sizeof(struct GROOT_QUERY));
+	qry->sample_id = check_random();
+	qry->sample_rate = check_random();
+	qry->aggregator = check_random() % (GROOT_QUANTILE + 1);
+	qry->version = check_random();
+	qry->error = check_random() % 100;
+	qry->sensors_required.co2 = check_random() % 2;
+	qry->sensors_required.no = check_random() % 2;
+	qry->sensors_required.temp = check_random() % 2;
+	qry->sensors_required.humidity = check_random() % 2;
+	qry->epsilon = check_random();
+	for(i = 0; i < GROOT_WHERE_LIMIT; i++){
+		qry->where.term[i] = check_random();
+		qry->where.value[i] = check_random();
+	}
+	qry->low = GROOT_HISTOGRAM_LOW;
+	qry->high = GROOT_HISTOGRAM_HIGH;
+	if(qry->aggregator == GROOT_QUANTILE){
+		qry->low = check_random();
+		qry->high = check_random();
+	}
+}
+
+static uint8_t
+same_query(const struct GROOT_QUERY *a, const struct GROOT_QUERY *b){
+	return a->sample_id == b->sample_id && a->sample_rate == b->sample_rate && a->aggregator == b->aggregator &&
+		a->version == b->version && a->error == b->error &&
+		memcmp(&a->sensors_required, &b->sensors_required, sizeof(struct GROOT_SENSORS)) == 0 &&
+		a->epsilon == b->epsilon && memcmp(a->where.term, b->where.term, sizeof(a->where.term)) == 0 &&
+		memcmp(a->where.value, b->where.value, sizeof(a->where.value)) == 0 && a->low == b->low && a->high == b->high;
+}
+
+static void
+check_header(void){
+	struct GROOT_HEADER hdr, read;
+	uint8_t buf[GROOT_WIRE_HDR_MAX + 1], size;
+
+	memset(&hdr, 0, sizeof(struct GROOT_HEADER));
+	hdr.protocol.version = GROOT_VERSION;
+	hdr.type = types[check_random() % sizeof(types)];
+	hdr.is_cluster_head = check_random() % 2;
+	hdr.handle = (check_random() % 4 == 0) ? 0 : check_random();
+	hdr.depth = check_random();
+	hdr.height = check_random();
+	hdr.span = check_random();
+	hdr.epoch_offset = check_random();
+	hdr.capability = check_random() & GROOT_WIRE_CAPABILITY;
+	if(hdr.type != GROOT_CLUSTER_JOIN_TYPE && check_random() % 2 == 0){
+		random_addr(&hdr.to);
+	}
+	if(hdr.handle != 0){
+		random_addr(&hdr.ereceiver);
+	}
+	if(hdr.type == GROOT_SUBSCRIBE_TYPE || hdr.type == GROOT_ALTERATION_TYPE || hdr.type == GROOT_UNSUBSCRIBE_TYPE){
+		hdr.query_id = check_random();
+		random_addr(&hdr.received_from);
+	}
+
+	size = groot_wire_hdr_write(buf, &hdr);
+	CHECK(size == GROOT_HDR_SIZE(buf) && size <= GROOT_WIRE_HDR_MAX);
+	CHECK(groot_wire_is_groot(buf, size));
+	CHECK(!groot_wire_is_groot(buf, size - 1));
+	CHECK(groot_wire_hdr_read(buf, &read) == size);
+	CHECK(read.protocol.version == hdr.protocol.version && read.type == hdr.type);
+	CHECK(read.is_cluster_head == hdr.is_cluster_head && read.handle == hdr.handle);
+	CHECK(read.depth == hdr.depth && read.height == hdr.height && read.span == hdr.span);
+	CHECK(read.epoch_offset == hdr.epoch_offset && read.capability == hdr.capability);
+	CHECK(same_addr(&read.to, &hdr.to) && same_addr(&read.ereceiver, &hdr.ereceiver));
+	CHECK(read.query_id == hdr.query_id && same_addr(&read.received_from, &hdr.received_from));
+	//Little endian at its offset
+	CHECK(buf[GROOT_WIRE_HDR_EPOCH_OFFSET] == (hdr.epoch_offset & 0xFF) &&
+		buf[GROOT_WIRE_HDR_EPOCH_OFFSET + 1] == (hdr.epoch_offset >> 8));
+}
+
+static void
+check_query(void){
+	struct GROOT_QUERY qry, read;
+	uint8_t buf[GROOT_WIRE_QRY_MAX], size;
+
+	random_query(&qry);
+	size = groot_wire_qry_write(buf, &qry);
+	CHECK(size == groot_wire_qry_size(&qry) && size == GROOT_QRY_SIZE(buf) && size <= GROOT_WIRE_QRY_MAX);
+	CHECK(groot_wire_qry_read(buf, &read) == size);
+	CHECK(same_query(&read, &qry));
+	CHECK(GROOT_QRY_AGGREGATOR(buf) == qry.aggregator && GROOT_QRY_VERSION(buf) == qry.version);
+	CHECK(GROOT_WIRE_U16(buf, GROOT_WIRE_QRY_SAMPLE_RATE) == qry.sample_rate);
+}
+
+static void
+check_record(void){
+	struct GROOT_BATCH_RECORD rec, read;
+	uint8_t buf[GROOT_WIRE_REC_MAX], size;
+
+	memset(&rec, 0, sizeof(struct GROOT_BATCH_RECORD));
+	rec.handle = check_random();
+	random_addr(&rec.ereceiver);
+	rec.is_cluster_head = check_random() % 2;
+	rec.depth = check_random();
+	rec.height = check_random();
+	rec.span = check_random();
+	rec.epoch_offset = check_random();
+	random_query(&rec.query);
+
+	size = groot_wire_rec_write(buf, &rec);
+	CHECK(size == GROOT_REC_SIZE(buf) && size <= GROOT_WIRE_REC_MAX);
+	CHECK(groot_wire_rec_read(buf, &read) == size);
+	CHECK(read.handle == rec.handle && same_addr(&read.ereceiver, &rec.ereceiver));
+	CHECK(read.is_cluster_head == rec.is_cluster_head && read.depth == rec.depth);
+	CHECK(read.height == rec.height && read.span == rec.span && read.epoch_offset == rec.epoch_offset);
+	CHECK(same_query(&read.query, &rec.query));
+}
+
+static void
+check_stats(void){
+	struct GROOT_STATS_REPORT report, read;
+	uint8_t buf[GROOT_WIRE_STATS_BYTES], i;
+
+	random_addr(&report.node);
+	for(i = 0; i < sizeof(struct GROOT_STATS); i++){
+		((uint8_t *)&report.stats)[i] = check_random();
+	}
+	groot_wire_stats_write(buf, &report);
+	groot_wire_stats_read(buf, &read);
+	CHECK(same_addr(&read.node, &report.node));
+	CHECK(memcmp(&read.stats, &report.stats, sizeof(struct GROOT_STATS)) == 0);
+}
+
+static void
+check_float(void){
+	uint8_t buf[4];
+	uint32_t bits = check_random(), back;
+	float value;
+
+	//Not a NaN, those need not keep their bits
+	if(((bits >> 23) & 0xFF) == 0xFF){
+		bits &= ~((uint32_t)1 << 30);
+	}
+	memcpy(&value, &bits, sizeof(value));
+	groot_wire_put_float(buf, value);
+	value = groot_wire_float(buf);
+	memcpy(&back, &value, sizeof(back));
+	CHECK(back == bits);
+	CHECK(buf[0] == (bits & 0xFF) && buf[3] == (bits >> 24));
+}
+
+int
+main(void){
+	uint32_t round;
+
+	for(round = 0; round < CHECK_ROUNDS; round++){
+		check_header();
+		check_query();
+		check_record();
+		check_stats();
+		check_float();
+	}
+
+	return CHECK_DONE("check-wire");
+}
@@ -0,0 +1,47 @@
+/**
+ * @file
+ * 	Checks of the GROOT sources run on the host by make check.
+ * @details
+ * 	Every check program counts its CHECKs, prints the failed ones and exits non-zero
+ * 	when any failed.
+ */
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#undef printf
+
+static unsigned int check_run = 0;
+static unsigned int check_failed = 0;
+static uint32_t check_seed = 1;
+
+/**
+ * @brief Count a check and print it when it does not hold
+ */
+#define CHECK(condition) do{ \
+		check_run += 1; \
+		if(!(condition)){ \
+			check_failed += 1; \
+			fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+		} \
+	}while(0)
+
+/**
+ * @brief Print the count of checks and return the exit status of the program
+ */
+#define CHECK_DONE(name) (printf("%s: %u checks, %u failed\n", name, check_run, check_failed), check_failed != 0)
+
+/**
+ * @brief Random number, the same sequence every run
+ */
+static inline uint32_t
+check_random(void){
+	check_seed ^= check_seed << 13;
+	check_seed ^= check_seed >> 17;
+	check_seed ^= check_seed << 5;
+	return check_seed;
+}
+
+#endif /* __CHECK_H__ */
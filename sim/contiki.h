@@ -0,0 +1,38 @@
+/**
+ * @file
+ * 	Host stand-in for contiki.h. Lets the unchanged GROOT sources build against the simulator.
+ */
+#ifndef __CONTIKI_H__
+#define __CONTIKI_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sys/clock.h"
+#include "sys/ctimer.h"
+
+/**
+ * @brief printf from the motes goes through the simulator so it can be silenced
+ */
+int
+sim_printf(const char *fmt, ...);
+
+#define printf sim_printf
+
+/**
+ * @brief Simulated sensor drift, set by the simulator for every mote
+ */
+extern unsigned int sim_sensor_drift;
+
+#define GROOT_SENSOR_DRIFT sim_sensor_drift
+
+/**
+ * @brief Seconds between stats reports, set by the simulator for every mote
+ */
+extern unsigned int sim_stats_period;
+
+#define GROOT_STATS_PERIOD sim_stats_period
+
+#endif /* __CONTIKI_H__ */
@@ -0,0 +1,908 @@
+/**
+ * @file
+ * 	GROOT simulator. Runs a sink and many sensor motes with the real GROOT code.
+ * @details
+ * 	Mote 0 is the sink. It subscribes the queries once the motes have booted and
+ * 	the run reports radio counters and the samples that reached the sink.
+ */
+
+#include "sim.h"
+#include "groot-sensor.h"
+#include "groot-sink.h"
+#include "groot-aggregate.h"
+#include "groot-wire.h"
+#include "groot-trace.h"
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#undef printf
+
+/**
+ * Topologies
+ */
+#define SIM_TOPOLOGY_GRID 0x00
+#define SIM_TOPOLOGY_RANDOM 0x01
+#define SIM_TOPOLOGY_LINE 0x02
+
+/**
+ * @brief Simulation settings
+ */
+struct SIM_CONFIG{
+	uint32_t numb_motes;
+	uint64_t seed;
+	uint8_t topology;
+	double density;
+	double capable;
+	uint16_t numb_queries;
+	uint16_t sample_rate;
+	uint8_t aggregator;
+	const char *aggregator_name;
+	struct GROOT_QUERY_OPTIONS options;
+	uint8_t merge;
+	uint8_t spread; //Query i samples at i times the sample rate
+	uint8_t csv; //Print the results as a CSV header and row
+	uint8_t duty; //Percent of the idle time the radio listens
+	uint8_t levels; //Print energy per tree level
+	unsigned long alter_at;
+	unsigned long unsubscribe_at;
+	unsigned long duration;
+	struct SIM_RADIO radio;
+};
+
+static struct GROOT_SENSORS sink_support = {0, 0, 0, 0};
+static struct GROOT_SENSORS sensor_support = {1, 1, 1, 1};
+static struct GROOT_SENSORS other_support = {0, 1, 0, 1}; //Cannot answer data_required
+static struct GROOT_SENSORS data_required = {1, 0, 1, 0};
+static struct SIM_CONFIG config;
+static uint64_t samples_at_sink = 0;
+static uint64_t readings_at_sink = 0; //Readings merged into the states sent to the sink
+static uint32_t results_stored = 0; //Results in the sink's store at the end
+static uint32_t results_last_minute = 0;
+/**
+ * @brief Counters of every mote added up at the end
+ */
+struct SIM_TOTALS{
+	uint64_t readings; //Taken by the sensors
+	uint64_t samples_sent;
+	uint64_t samples_held;
+	uint64_t forwarded;
+	uint64_t partial_aggregates;
+	uint64_t children_evicted;
+	uint64_t parent_losses;
+	uint64_t retransmissions;
+	uint64_t join_timeouts;
+	uint64_t memb_failures;
+};
+
+static struct SIM_TOTALS node_totals;
+static struct GROOT_STATS *reported = NULL; //Latest stats report of every mote
+static uint32_t stats_reports = 0;
+
+/**
+ * Sample Latency
+ */
+#define SIM_LATENCY_QUERIES GROOT_QUERY_LIMIT //Query slots per mote
+#define SIM_SAMPLE_CACHE 65536 //Samples without aggregation whose origin time is kept
+
+struct SIM_SAMPLE_ORIGIN{
+	uint32_t key;
+	uint64_t at;
+};
+
+static uint64_t *sent_origin = NULL; //Oldest reading of a mote's last aggregate
+static uint64_t *pending_origin = NULL; //Oldest reading the mote's children sent since. 0 none
+static struct SIM_SAMPLE_ORIGIN *sample_origin = NULL;
+static uint32_t *latencies = NULL; //Milliseconds from reading to sink of every publish to the sink
+static uint32_t latency_length = 0;
+static uint32_t latency_size = 0;
+/**
+ * Energy
+ */
+#define SIM_ENERGY_LEVELS 32 //Deeper motes count in the last level
+
+/**
+ * @brief Radio time and energy of a mote over the run
+ */
+struct SIM_ENERGY{
+	int depth; //Tree depth of the mote's last publish. -1 never published
+	uint64_t overheard_us; //Receiving frames sent to another mote
+	double energy; //mJ
+	double radio_on; //Fraction of the run the radio was on
+};
+
+static struct SIM_ENERGY *energy = NULL;
+static FILE *energy_file = NULL; //Per mote energy as CSV
+static double energy_mean = 0;
+static uint32_t energy_max = 0; //Mote that used the most
+static double active_mean = 0; //ms sending or receiving
+static uint32_t active_max = 0; //Mote that was sending or receiving the longest
+
+static uint16_t memb_peak_max = 0; //Most query items any mote held at once
+static uint64_t memb_peak_sum = 0;
+static FILE *trace_file = NULL; //Trace frames of every mote for trace-decode
+static uint64_t trace_records = 0;
+static uint64_t trace_overwritten = 0;
+
+/**
+ * Query Floods
+ */
+#define SIM_FLOOD_SUBSCRIBE 0x00
+#define SIM_FLOOD_ALTERATION 0x01
+#define SIM_FLOOD_UNSUBSCRIBE 0x02
+#define SIM_FLOODS 3
+
+static uint64_t flood_tx[SIM_FLOODS];
+static uint8_t *flood_heard = NULL; //Bit per flood a mote received a frame of
+/*------------------------------------------------- Mote Code -----------------------------------------------------------*/
+/**
+ * @brief Keep the latest stats report of a mote
+ */
+static void
+stats_report(const rimeaddr_t *node, struct GROOT_STATS *stats){
+	uint32_t id = sim_addr_to_id(node);
+
+	if(id < config.numb_motes){
+		memcpy(&reported[id], stats, sizeof(struct GROOT_STATS));
+		stats_reports += 1;
+	}
+}
+
+static void
+boot_sink(void *arg){
+	sink_bootstrap(&sink_support);
+	sink_merge_queries(config.merge);
+	groot_stats_callback(stats_report);
+}
+
+static void
+boot_sensor(void *arg){
+	sensor_bootstrap((struct GROOT_SENSORS *)arg);
+}
+
+static void
+subscribe(void *arg){
+	uint16_t query_id = (uint16_t)(uintptr_t)arg;
+	sink_subscribe_options(query_id, config.sample_rate*(config.spread ? query_id : 1), &data_required, config.aggregator,
+		&config.options);
+}
+
+static void
+alter(void *arg){
+	uint16_t query_id = (uint16_t)(uintptr_t)arg;
+	sink_send(query_id, 2*config.sample_rate, &data_required, config.aggregator);
+}
+
+static void
+unsubscribe(void *arg){
+	sink_unsubscribe((uint16_t)(uintptr_t)arg);
+}
+
+static void
+read_results(void *arg){
+	struct GROOT_SINK_RESULT results[GROOT_SINK_STORE_LENGTH];
+	uint16_t query_id;
+
+	for(query_id = 1; query_id <= config.numb_queries; query_id++){
+		results_stored += sink_results_latest(query_id, GROOT_SINK_STORE_LENGTH, results);
+		results_last_minute += sink_results_range(query_id, clock_seconds() - 60, clock_seconds(),
+			GROOT_SINK_STORE_LENGTH, results);
+	}
+}
+
+/**
+ * @brief Add the mote's counters to the totals
+ */
+static void
+read_stats(void *arg){
+	struct GROOT_STATS stats;
+
+	groot_node_stats(&stats);
+	if(sim_current()->id != 0){
+		node_totals.readings += stats.readings;
+	}
+	node_totals.samples_sent += stats.samples_sent;
+	node_totals.samples_held += stats.samples_held;
+	node_totals.forwarded += stats.forwarded;
+	node_totals.partial_aggregates += stats.partial_aggregates;
+	node_totals.children_evicted += stats.children_evicted;
+	node_totals.parent_losses += stats.parent_losses;
+	node_totals.retransmissions += stats.retransmissions;
+	node_totals.join_timeouts += stats.join_timeouts;
+	node_totals.memb_failures += stats.memb_failures;
+	memb_peak_sum += stats.memb_peak;
+	if(stats.memb_peak > memb_peak_max){
+		memb_peak_max = stats.memb_peak;
+	}
+}
+
+/**
+ * @brief Write the mote's trace records as a frame, as a mote would on its serial line
+ * @details Runs every second on every mote. Frames are the node address, the record count
+ *          and the records.
+ */
+static void
+drain_trace(void *arg){
+	struct SIM_MOTE *mote = sim_current();
+	struct GROOT_TRACE_RECORD records[GROOT_TRACE_LENGTH];
+	uint8_t count = groot_trace_drain(records, GROOT_TRACE_LENGTH);
+
+	if(count > 0){
+		fwrite(&mote->addr, sizeof(rimeaddr_t), 1, trace_file);
+		fwrite(&count, 1, 1, trace_file);
+		fwrite(records, sizeof(struct GROOT_TRACE_RECORD), count, trace_file);
+		trace_records += count;
+	}
+	if(sim_now() + SIM_US_PER_SECOND < config.duration*SIM_US_PER_SECOND){
+		sim_call(mote->id, sim_now() + SIM_US_PER_SECOND, drain_trace, NULL);
+	} else {
+		trace_overwritten += groot_trace_overwritten();
+	}
+}
+
+/**
+ * @brief Flood a GROOT packet type belongs to
+ */
+static int
+flood_of(const void *data, uint16_t len){
+	if(len < GROOT_WIRE_HDR_BYTES){
+		return -1;
+	}
+	switch(GROOT_HDR_TYPE(data)){
+		case GROOT_SUBSCRIBE_TYPE:
+			return SIM_FLOOD_SUBSCRIBE;
+		case GROOT_ALTERATION_TYPE:
+			return SIM_FLOOD_ALTERATION;
+		case GROOT_UNSUBSCRIBE_TYPE:
+			return SIM_FLOOD_UNSUBSCRIBE;
+	}
+	return -1;
+}
+
+/**
+ * @brief Slot of the latency tables of a mote's query
+ */
+static uint32_t
+latency_slot(uint32_t mote, uint8_t handle){
+	return mote*SIM_LATENCY_QUERIES + handle % SIM_LATENCY_QUERIES;
+}
+
+/**
+ * @brief Slot of a sample without aggregation in the origin cache
+ * @details Forwarded samples are unchanged, so the query, sample id and values name them
+ */
+static uint32_t
+sample_key(const struct GROOT_BATCH_RECORD *rec){
+	uint32_t key = rec->handle*2654435761U ^ rec->query.sample_id, bits;
+
+	memcpy(&bits, &rec->data.value.co2, sizeof(bits));
+	key = key*31 + bits;
+	memcpy(&bits, &rec->data.value.temp, sizeof(bits));
+	return key*31 + bits;
+}
+
+/**
+ * @brief Time the oldest reading a record carries left its mote
+ * @details An aggregate carries the oldest reading its children sent since the mote's
+ *          last one, or the mote's own reading. A sample without aggregation keeps
+ *          the time its mote first sent it.
+ */
+static void
+record_sent(struct SIM_MOTE *mote, const struct GROOT_BATCH_RECORD *rec){
+	uint32_t slot = latency_slot(mote->id, rec->handle), key;
+
+	if(rec->query.aggregator == GROOT_NO_AGGREGATION){
+		key = sample_key(rec);
+		if(sample_origin[key % SIM_SAMPLE_CACHE].key != key){
+			sample_origin[key % SIM_SAMPLE_CACHE].key = key;
+			sample_origin[key % SIM_SAMPLE_CACHE].at = sim_now();
+		}
+		return;
+	}
+	sent_origin[slot] = (pending_origin[slot] > 0 && pending_origin[slot] < sim_now()) ? pending_origin[slot] : sim_now();
+	pending_origin[slot] = 0;
+}
+
+/**
+ * @brief Call for every publish record of a frame
+ * @return records parsed
+ */
+static uint32_t
+for_records(struct SIM_MOTE *mote, const rimeaddr_t *from, const void *data, uint16_t len,
+	void (*fn)(struct SIM_MOTE *mote, const rimeaddr_t *from, const struct GROOT_HEADER *hdr,
+	const struct GROOT_BATCH_RECORD *rec)){
+	const uint8_t *buf;
+	struct GROOT_HEADER hdr;
+	struct GROOT_BATCH_RECORD rec;
+	uint16_t left, size, rec_size;
+	uint32_t records = 0;
+
+	if(!groot_wire_is_groot(data, len)){
+		return 0;
+	}
+	size = groot_wire_hdr_read(data, &hdr);
+	buf = (const uint8_t *)data + size;
+	left = len - size;
+	if(hdr.type == GROOT_PUBLISH_TYPE && left >= GROOT_WIRE_QRY_BYTES && left >= GROOT_QRY_SIZE(buf)){
+		rec.handle = hdr.handle;
+		rimeaddr_copy(&rec.ereceiver, &hdr.ereceiver);
+		rec.depth = hdr.depth;
+		size = groot_wire_qry_read(buf, &rec.query);
+		if(groot_partial_unpack(&rec.query, buf + size, left - size, &rec.data) > 0){
+			fn(mote, from, &hdr, &rec);
+			records += 1;
+		}
+	} else if(hdr.type == GROOT_BATCH_TYPE){
+		while(left >= GROOT_WIRE_REC_BYTES && left >= GROOT_REC_SIZE(buf)){
+			rec_size = groot_wire_rec_read(buf, &rec);
+			size = groot_partial_unpack(&rec.query, buf + rec_size, left - rec_size, &rec.data);
+			if(size == 0){
+				break;
+			}
+			fn(mote, from, &hdr, &rec);
+			records += 1;
+			buf += rec_size + size;
+			left -= rec_size + size;
+		}
+	}
+	return records;
+}
+
+static void
+tx_record(struct SIM_MOTE *mote, const rimeaddr_t *from, const struct GROOT_HEADER *hdr,
+	const struct GROOT_BATCH_RECORD *rec){
+	record_sent(mote, rec);
+	energy[mote->id].depth = rec->depth;
+}
+
+/**
+ * @brief Count the frames sent for every query flood and stamp the records sent
+ */
+static void
+tx_hook(struct SIM_MOTE *mote, const void *data, uint16_t len){
+	int flood = flood_of(data, len);
+
+	if(flood >= 0){
+		flood_tx[flood] += 1;
+	}
+	for_records(mote, &mote->addr, data, len, tx_record);
+}
+
+/**
+ * @brief Handle a record addressed to a mote
+ * @details Motes take the oldest reading of their children's records into their next
+ *          aggregate. The sink counts publishes and readings, readings only once from
+ *          publishes sent to it, and how long they took.
+ */
+static void
+rx_record(struct SIM_MOTE *mote, const rimeaddr_t *from, const struct GROOT_HEADER *hdr,
+	const struct GROOT_BATCH_RECORD *rec){
+	uint32_t slot = latency_slot(mote->id, rec->handle), sender = sim_addr_to_id(from), key;
+	uint64_t origin = 0;
+
+	if(!rimeaddr_cmp(&hdr->to, &mote->addr) || sender >= config.numb_motes){
+		if(mote->id == 0 && rimeaddr_cmp(&rec->ereceiver, &mote->addr)){
+			samples_at_sink += 1;
+		}
+		return;
+	}
+	if(rec->query.aggregator == GROOT_NO_AGGREGATION){
+		key = sample_key(rec);
+		if(sample_origin[key % SIM_SAMPLE_CACHE].key == key){
+			origin = sample_origin[key % SIM_SAMPLE_CACHE].at;
+		}
+	} else {
+		origin = sent_origin[latency_slot(sender, rec->handle)];
+		if(origin > 0 && (pending_origin[slot] == 0 || origin < pending_origin[slot])){
+			pending_origin[slot] = origin;
+		}
+	}
+
+	if(mote->id != 0 || !rimeaddr_cmp(&rec->ereceiver, &mote->addr)){
+		return;
+	}
+	samples_at_sink += 1;
+	readings_at_sink += rec->data.count;
+	if(origin > 0){
+		if(latency_length == latency_size){
+			latency_size = (latency_size == 0) ? 1024 : 2*latency_size;
+			latencies = realloc(latencies, latency_size*sizeof(uint32_t));
+		}
+		latencies[latency_length++] = (uint32_t)((sim_now() - origin)/1000);
+	}
+}
+
+/**
+ * @brief Count the motes a flood reached and follow the published records
+ */
+static void
+rx_hook(struct SIM_MOTE *mote, const rimeaddr_t *from, const void *data, uint16_t len){
+	int flood = flood_of(data, len);
+
+	if(flood >= 0){
+		flood_heard[mote->id] |= 1 << flood;
+	}
+	//Floods are sent to no one in particular
+	if(groot_wire_is_groot(data, len) && (GROOT_HDR_FLAGS(data) & GROOT_WIRE_TO) &&
+		!rimeaddr_cmp(GROOT_HDR_TO(data), &mote->addr)){
+		energy[mote->id].overheard_us += (uint64_t)(len + SIM_FRAME_OVERHEAD)*SIM_BYTE_US;
+	}
+	for_records(mote, from, data, len, rx_record);
+}
+/*------------------------------------------------- Topology ------------------------------------------------------------*/
+static void
+place_motes(void){
+	uint32_t i, side;
+	double area;
+	struct SIM_MOTE *mote;
+
+	switch(config.topology){
+		case SIM_TOPOLOGY_GRID:
+			side = (uint32_t)ceil(sqrt(config.numb_motes));
+			for(i = 0; i < config.numb_motes; i++){
+				mote = sim_mote(i);
+				mote->x = i % side;
+				mote->y = i / side;
+			}
+			break;
+		case SIM_TOPOLOGY_RANDOM:
+			//Square sized so a mote has density neighbours on average
+			area = sqrt(config.numb_motes*M_PI*config.radio.range*config.radio.range/config.density);
+			for(i = 0; i < config.numb_motes; i++){
+				mote = sim_mote(i);
+				mote->x = (i == 0) ? area/2 : sim_random_unit()*area;
+				mote->y = (i == 0) ? area/2 : sim_random_unit()*area;
+			}
+			break;
+		case SIM_TOPOLOGY_LINE:
+			for(i = 0; i < config.numb_motes; i++){
+				mote = sim_mote(i);
+				mote->x = i;
+				mote->y = 0;
+			}
+			break;
+	}
+}
+/*------------------------------------------------- Results -------------------------------------------------------------*/
+static int
+compare_latency(const void *a, const void *b){
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Latency at a percentile of the sorted latencies
+ */
+static uint32_t
+latency_percentile(uint8_t percent){
+	uint32_t i;
+
+	if(latency_length == 0){
+		return 0;
+	}
+	i = (uint32_t)((uint64_t)latency_length*percent/100);
+	return latencies[(i < latency_length) ? i : latency_length - 1];
+}
+
+/**
+ * @brief Work out the energy of every mote
+ * @details The radio listens for duty percent of the time it is not sending or
+ *          receiving. Listening costs as much as receiving on the CC2420.
+ */
+static void
+account_energy(void){
+	struct SIM_MOTE *mote;
+	double run = config.duration*(double)SIM_US_PER_SECOND, listen;
+	uint32_t i;
+
+	for(i = 0; i < config.numb_motes; i++){
+		mote = sim_mote(i);
+		listen = (run - mote->tx_us - mote->rx_us)*config.duty/100;
+		energy[i].energy = (mote->tx_us*SIM_TX_MA + (mote->rx_us + listen)*SIM_RX_MA)*SIM_VOLTS/SIM_US_PER_SECOND;
+		energy[i].radio_on = (mote->tx_us + mote->rx_us + listen)/run;
+		energy_mean += energy[i].energy/config.numb_motes;
+		active_mean += (mote->tx_us + mote->rx_us)/1000.0/config.numb_motes;
+		if(mote->tx_us + mote->rx_us > sim_mote(active_max)->tx_us + sim_mote(active_max)->rx_us){
+			active_max = i;
+		}
+		if(energy[i].energy > energy[energy_max].energy){
+			energy_max = i;
+		}
+		if(energy_file != NULL){
+			fprintf(energy_file, "%u,%.2f,%.2f,%d,%.1f,%.1f,%.1f,%.1f,%.3f\n", i, mote->x, mote->y, energy[i].depth,
+				mote->tx_us/1000.0, mote->rx_us/1000.0, energy[i].overheard_us/1000.0, listen/1000, energy[i].energy);
+		}
+	}
+}
+
+/**
+ * @brief Print the energy of the motes at every tree depth
+ * @details Motes that never published have no depth and are left out
+ */
+static void
+print_levels(void){
+	double sum[SIM_ENERGY_LEVELS] = {0}, max[SIM_ENERGY_LEVELS] = {0}, tx[SIM_ENERGY_LEVELS] = {0};
+	double rx[SIM_ENERGY_LEVELS] = {0}, overheard[SIM_ENERGY_LEVELS] = {0};
+	uint32_t motes[SIM_ENERGY_LEVELS] = {0}, i;
+	int level;
+
+	for(i = 0; i < config.numb_motes; i++){
+		if(energy[i].depth < 0){
+			continue;
+		}
+		level = (energy[i].depth < SIM_ENERGY_LEVELS) ? energy[i].depth : SIM_ENERGY_LEVELS - 1;
+		motes[level] += 1;
+		sum[level] += energy[i].energy;
+		tx[level] += sim_mote(i)->tx_us/1000.0;
+		rx[level] += sim_mote(i)->rx_us/1000.0;
+		overheard[level] += energy[i].overheard_us/1000.0;
+		if(energy[i].energy > max[level]){
+			max[level] = energy[i].energy;
+		}
+	}
+	for(level = 0; level < SIM_ENERGY_LEVELS; level++){
+		if(motes[level] > 0){
+			printf("level=%d motes=%u energy_mean_mj=%.0f energy_max_mj=%.0f tx_ms_mean=%.1f rx_ms_mean=%.1f "
+				"overheard_ms_mean=%.1f\n", level, motes[level], sum[level]/motes[level], max[level],
+				tx[level]/motes[level], rx[level]/motes[level], overheard[level]/motes[level]);
+		}
+	}
+}
+
+/**
+ * @brief Print the settings and the results of the run as a CSV header and row
+ */
+static void
+print_csv(double epochs, double delivery, double latency_mean, double wall){
+	static const char *topologies[] = {"grid", "random", "line"};
+
+	printf("topology,motes,density,seed,duration,queries,aggregator,child_limit,sample_rate,"
+		"frames_tx,bytes_tx,frames_per_epoch,bytes_per_epoch,collisions,samples_at_sink,readings_at_sink,readings,"
+		"delivery_ratio,latency_mean_ms,latency_p95_ms,latency_max_ms,memb_peak_max,memb_peak_mean,memb_failures,"
+		"energy_mean_mj,energy_max_mj,wall_seconds\n");
+	printf("%s,%u,%.1f,%llu,%lu,%u,%s,%u,%u,%llu,%llu,%.1f,%.0f,%llu,%llu,%llu,%llu,%.3f,%.0f,%u,%u,%u,%.2f,%llu,"
+		"%.0f,%.0f,%.3f\n",
+		topologies[config.topology], config.numb_motes, config.density, (unsigned long long)config.seed, config.duration,
+		config.numb_queries, config.aggregator_name, GROOT_CHILD_LIMIT, config.sample_rate/CLOCK_SECOND,
+		(unsigned long long)sim_stats.frames_tx, (unsigned long long)sim_stats.bytes_tx, sim_stats.frames_tx/epochs,
+		sim_stats.bytes_tx/epochs, (unsigned long long)sim_stats.collisions, (unsigned long long)samples_at_sink,
+		(unsigned long long)readings_at_sink, (unsigned long long)node_totals.readings, delivery, latency_mean,
+		latency_percentile(95), latency_percentile(100), memb_peak_max, (double)memb_peak_sum/config.numb_motes,
+		(unsigned long long)node_totals.memb_failures, energy_mean, energy[energy_max].energy, wall);
+}
+/*------------------------------------------------- Main ----------------------------------------------------------------*/
+static void
+usage(const char *name){
+	fprintf(stderr, "Usage: %s [options]\n"
+		"  -n motes      number of motes including the sink (default 100)\n"
+		"  -S seed       random seed (default 1)\n"
+		"  -T topology   grid, random or line (default grid)\n"
+		"  -r range      radio range, grid spacing is 1 (default 1.5)\n"
+		"  -d density    mean neighbours for random topology (default 8)\n"
+		"  -m model      radio model udg or lossy (default udg)\n"
+		"  -l loss       extra loss probability per link (default 0)\n"
+		"  -C            disable collisions\n"
+		"  -c fraction   fraction of sensors with the sensors the queries need (default 1)\n"
+		"  -q queries    number of queries subscribed by the sink (default 1)\n"
+		"  -M            run every query on its own instead of merging them at the sink\n"
+		"  -R            query i samples at i times the sample rate\n"
+		"  -s seconds    sample rate (default 13)\n"
+		"  -a agg        aggregator none, max, min, avg, sum, count, var, hist or quantile (default max)\n"
+		"  -e percent    rank error of the quantile aggregator (default 10)\n"
+		"  -g low,high   range the quantile digest spans (default GROOT_HISTOGRAM_LOW,HIGH)\n"
+		"  -E epsilon    publish only values that moved more than epsilon (default 0, every epoch)\n"
+		"  -w where      predicates the readings must pass, e.g. temp>30,co2<=80\n"
+		"  -j step       readings drift at most step from the last one (default 0, drawn afresh)\n"
+		"  -A seconds    alter the queries to half the sample rate at this time\n"
+		"  -U seconds    unsubscribe the queries at this time\n"
+		"  -P seconds    motes report their counters to the sink this often (default 0, never)\n"
+		"  -t seconds    simulated time (default 600)\n"
+		"  -x file       write the binary trace of every mote to file, read it with trace-decode\n"
+		"  -W percent    radio listens this much of its idle time (default 100, always on)\n"
+		"  -L            print the energy of the motes at every tree depth\n"
+		"  -J file       write the radio time and energy of every mote to file as CSV\n"
+		"  -o            print the results as a CSV header and row\n"
+		"  -v            print mote output\n", name);
+	exit(1);
+}
+
+static uint8_t
+parse_aggregator(const char *name){
+	if(strcmp(name, "none") == 0){
+		return GROOT_NO_AGGREGATION;
+	} else if(strcmp(name, "max") == 0){
+		return GROOT_MAX;
+	} else if(strcmp(name, "min") == 0){
+		return GROOT_MIN;
+	} else if(strcmp(name, "avg") == 0){
+		return GROOT_AVG;
+	} else if(strcmp(name, "sum") == 0){
+		return GROOT_SUM;
+	} else if(strcmp(name, "count") == 0){
+		return GROOT_COUNT;
+	} else if(strcmp(name, "var") == 0){
+		return GROOT_VARIANCE;
+	} else if(strcmp(name, "hist") == 0){
+		return GROOT_HISTOGRAM;
+	} else if(strcmp(name, "quantile") == 0){
+		return GROOT_QUANTILE;
+	}
+	return 0xFF;
+}
+
+/**
+ * @brief Parse comma separated predicates of the form sensor op value
+ * @return 1 parsed 0 malformed
+ */
+static uint8_t
+parse_where(char *text, struct GROOT_WHERE *where){
+	static const char *sensors[] = {"co2", "no", "humidity", "temp"}; //By sensor type
+	static const char *ops[] = {"<=", ">=", "<", ">"};
+	static const uint8_t op_codes[] = {GROOT_WHERE_LE, GROOT_WHERE_GE, GROOT_WHERE_LT, GROOT_WHERE_GT};
+	char *term, *value;
+	uint8_t n = 0, s, o;
+
+	memset(where, 0, sizeof(struct GROOT_WHERE));
+	for(term = strtok(text, ","); term != NULL; term = strtok(NULL, ",")){
+		if(n >= GROOT_WHERE_LIMIT){
+			return 0;
+		}
+		for(s = 0; s < 4 && strncmp(term, sensors[s], strlen(sensors[s])) != 0; s++);
+		if(s == 4){
+			return 0;
+		}
+		value = term + strlen(sensors[s]);
+		for(o = 0; o < 4 && strncmp(value, ops[o], strlen(ops[o])) != 0; o++);
+		if(o == 4){
+			return 0;
+		}
+		where->term[n] = GROOT_WHERE_TERM(SENSOR_CO2 + s, op_codes[o]);
+		where->value[n] = strtol(value + strlen(ops[o]), NULL, 10);
+		n += 1;
+	}
+	return n > 0;
+}
+
+int
+main(int argc, char **argv){
+	struct timespec wall_start, wall_end;
+	double wall, epochs, delivery, latency_mean = 0;
+	uint32_t i, reached[SIM_FLOODS] = {0}, busiest = 0, motes_reported = 0;
+	uint8_t f;
+	int opt;
+
+	config.numb_motes = 100;
+	config.seed = 1;
+	config.topology = SIM_TOPOLOGY_GRID;
+	config.density = 8;
+	config.capable = 1;
+	config.numb_queries = 1;
+	config.sample_rate = 13*CLOCK_SECOND;
+	config.aggregator = GROOT_MAX;
+	config.aggregator_name = "max";
+	config.options.error = GROOT_QUANTILE_ERROR;
+	config.merge = 1;
+	config.alter_at = 0;
+	config.unsubscribe_at = 0;
+	config.duration = 600;
+	config.duty = 100;
+	config.radio.model = SIM_RADIO_UDG;
+	config.radio.range = 1.5;
+	config.radio.loss = 0;
+	config.radio.collisions = 1;
+
+	while((opt = getopt(argc, argv, "n:S:T:r:d:c:m:l:Cq:MRs:a:e:g:E:w:j:A:U:P:t:x:W:LJ:ov")) != -1){
+		switch(opt){
+			case 'n': config.numb_motes = strtoul(optarg, NULL, 10); break;
+			case 'S': config.seed = strtoull(optarg, NULL, 10); break;
+			case 'T':
+				if(strcmp(optarg, "grid") == 0){
+					config.topology = SIM_TOPOLOGY_GRID;
+				} else if(strcmp(optarg, "random") == 0){
+					config.topology = SIM_TOPOLOGY_RANDOM;
+				} else if(strcmp(optarg, "line") == 0){
+					config.topology = SIM_TOPOLOGY_LINE;
+				} else {
+					usage(argv[0]);
+				}
+				break;
+			case 'r': config.radio.range = strtod(optarg, NULL); break;
+			case 'd': config.density = strtod(optarg, NULL); break;
+			case 'c': config.capable = strtod(optarg, NULL); break;
+			case 'm':
+				if(strcmp(optarg, "udg") == 0){
+					config.radio.model = SIM_RADIO_UDG;
+				} else if(strcmp(optarg, "lossy") == 0){
+					config.radio.model = SIM_RADIO_LOSSY;
+				} else {
+					usage(argv[0]);
+				}
+				break;
+			case 'l': config.radio.loss = strtod(optarg, NULL); break;
+			case 'C': config.radio.collisions = 0; break;
+			case 'q': config.numb_queries = strtoul(optarg, NULL, 10); break;
+			case 'M': config.merge = 0; break;
+			case 'R': config.spread = 1; break;
+			case 's': config.sample_rate = strtoul(optarg, NULL, 10)*CLOCK_SECOND; break;
+			case 'a':
+				config.aggregator = parse_aggregator(optarg);
+				config.aggregator_name = optarg;
+				if(config.aggregator == 0xFF){
+					usage(argv[0]);
+				}
+				break;
+			case 'e': config.options.error = strtoul(optarg, NULL, 10); break;
+			case 'g':
+				if(sscanf(optarg, "%hd,%hd", &config.options.low, &config.options.high) != 2 ||
+					config.options.low >= config.options.high){
+					usage(argv[0]);
+				}
+				break;
+			case 'E': config.options.epsilon = strtoul(optarg, NULL, 10); break;
+			case 'j': sim_sensor_drift = strtoul(optarg, NULL, 10); break;
+			case 'w':
+				if(!parse_where(optarg, &config.options.where)){
+					usage(argv[0]);
+				}
+				break;
+			case 'A': config.alter_at = strtoul(optarg, NULL, 10); break;
+			case 'U': config.unsubscribe_at = strtoul(optarg, NULL, 10); break;
+			case 'P': sim_stats_period = strtoul(optarg, NULL, 10); break;
+			case 't': config.duration = strtoul(optarg, NULL, 10); break;
+			case 'x':
+				if((trace_file = fopen(optarg, "wb")) == NULL){
+					usage(argv[0]);
+				}
+				break;
+			case 'W': config.duty = strtoul(optarg, NULL, 10); break;
+			case 'L': config.levels = 1; break;
+			case 'J':
+				if((energy_file = fopen(optarg, "w")) == NULL){
+					usage(argv[0]);
+				}
+				fprintf(energy_file, "mote,x,y,depth,tx_ms,rx_ms,overheard_ms,listen_ms,energy_mj\n");
+				break;
+			case 'o': config.csv = 1; break;
+			case 'v': sim_verbose = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if(config.radio.range <= 0 || config.density <= 0 || config.capable < 0 || config.capable > 1 || config.duty > 100 ||
+		!sim_init(config.numb_motes, config.seed, &config.radio)){
+		usage(argv[0]);
+	}
+
+	place_motes();
+	sim_connect();
+	sim_set_rx_hook(rx_hook);
+	sim_set_tx_hook(tx_hook);
+	flood_heard = calloc(config.numb_motes, sizeof(uint8_t));
+	energy = calloc(config.numb_motes, sizeof(struct SIM_ENERGY));
+	for(i = 1; i < config.numb_motes; i++){
+		energy[i].depth = -1;
+	}
+	sent_origin = calloc(config.numb_motes*SIM_LATENCY_QUERIES, sizeof(uint64_t));
+	pending_origin = calloc(config.numb_motes*SIM_LATENCY_QUERIES, sizeof(uint64_t));
+	sample_origin = calloc(SIM_SAMPLE_CACHE, sizeof(struct SIM_SAMPLE_ORIGIN));
+	reported = calloc(config.numb_motes, sizeof(struct GROOT_STATS));
+
+	//Motes boot within the first second, the sink subscribes once they are up
+	sim_call(0, 0, boot_sink, NULL);
+	for(i = 1; i < config.numb_motes; i++){
+		sim_call(i, sim_random() % SIM_US_PER_SECOND, boot_sensor,
+			(config.capable >= 1 || sim_random_unit() < config.capable) ? &sensor_support : &other_support);
+	}
+	for(i = 0; i < config.numb_queries; i++){
+		sim_call(0, (5 + i)*SIM_US_PER_SECOND, subscribe, (void *)(uintptr_t)(i+1));
+		if(config.alter_at > 0){
+			sim_call(0, (config.alter_at + i)*SIM_US_PER_SECOND, alter, (void *)(uintptr_t)(i+1));
+		}
+		if(config.unsubscribe_at > 0){
+			sim_call(0, (config.unsubscribe_at + i)*SIM_US_PER_SECOND, unsubscribe, (void *)(uintptr_t)(i+1));
+		}
+	}
+
+	if(trace_file != NULL){
+		for(i = 0; i < config.numb_motes; i++){
+			sim_call(i, SIM_US_PER_SECOND + i % SIM_US_PER_SECOND, drain_trace, NULL);
+		}
+	}
+
+	//Read the sink's result store and the counters just before the end
+	sim_call(0, config.duration*SIM_US_PER_SECOND - 1, read_results, NULL);
+	for(i = 0; i < config.numb_motes; i++){
+		sim_call(i, config.duration*SIM_US_PER_SECOND - 1, read_stats, NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+	sim_run(config.duration*SIM_US_PER_SECOND);
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+	wall = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec)/1e9;
+
+	//Epochs of the base rate after the first subscribe
+	epochs = (config.duration > 5) ? (config.duration - 5)*(double)CLOCK_SECOND/config.sample_rate : 1;
+	delivery = (node_totals.readings > 0) ? (double)readings_at_sink/node_totals.readings : 0;
+	for(i = 0; i < latency_length; i++){
+		latency_mean += latencies[i];
+	}
+	latency_mean = (latency_length > 0) ? latency_mean/latency_length : 0;
+	qsort(latencies, latency_length, sizeof(uint32_t), compare_latency);
+	account_energy();
+
+	if(config.csv){
+		print_csv(epochs, delivery, latency_mean, wall);
+	} else {
+		printf("motes=%u seed=%llu duration=%lu queries=%u\n", config.numb_motes,
+			(unsigned long long)config.seed, config.duration, config.numb_queries);
+		printf("events=%llu wall_seconds=%.3f\n", (unsigned long long)sim_stats.events, wall);
+		printf("frames_tx=%llu bytes_tx=%llu frames_rx=%llu frames_lost=%llu collisions=%llu\n",
+			(unsigned long long)sim_stats.frames_tx, (unsigned long long)sim_stats.bytes_tx,
+			(unsigned long long)sim_stats.frames_rx, (unsigned long long)sim_stats.frames_lost,
+			(unsigned long long)sim_stats.collisions);
+		printf("runicast_sent=%llu runicast_timedout=%llu\n", (unsigned long long)sim_stats.runicast_sent,
+			(unsigned long long)sim_stats.runicast_timedout);
+		printf("samples_at_sink=%llu readings_at_sink=%llu\n", (unsigned long long)samples_at_sink,
+			(unsigned long long)readings_at_sink);
+		printf("results_stored=%u results_last_minute=%u\n", results_stored, results_last_minute);
+
+		for(i = 1; i < config.numb_motes; i++){
+			for(f = 0; f < SIM_FLOODS; f++){
+				reached[f] += (flood_heard[i] >> f) & 1;
+			}
+		}
+		printf("subscribe_tx=%llu alteration_tx=%llu unsubscribe_tx=%llu\n", (unsigned long long)flood_tx[SIM_FLOOD_SUBSCRIBE],
+			(unsigned long long)flood_tx[SIM_FLOOD_ALTERATION], (unsigned long long)flood_tx[SIM_FLOOD_UNSUBSCRIBE]);
+		printf("subscribe_reached=%u alteration_reached=%u unsubscribe_reached=%u\n", reached[SIM_FLOOD_SUBSCRIBE],
+			reached[SIM_FLOOD_ALTERATION], reached[SIM_FLOOD_UNSUBSCRIBE]);
+		printf("samples_sent=%llu samples_held=%llu forwarded=%llu partial_aggregates=%llu children_evicted=%llu\n",
+			(unsigned long long)node_totals.samples_sent, (unsigned long long)node_totals.samples_held,
+			(unsigned long long)node_totals.forwarded, (unsigned long long)node_totals.partial_aggregates,
+			(unsigned long long)node_totals.children_evicted);
+		printf("parent_losses=%llu retransmissions=%llu join_timeouts=%llu memb_failures=%llu\n",
+			(unsigned long long)node_totals.parent_losses, (unsigned long long)node_totals.retransmissions,
+			(unsigned long long)node_totals.join_timeouts, (unsigned long long)node_totals.memb_failures);
+		printf("frames_per_epoch=%.1f bytes_per_epoch=%.0f delivery_ratio=%.3f\n", sim_stats.frames_tx/epochs,
+			sim_stats.bytes_tx/epochs, delivery);
+		printf("latency_mean_ms=%.0f latency_p95_ms=%u latency_max_ms=%u memb_peak_max=%u memb_peak_mean=%.2f\n",
+			latency_mean, latency_percentile(95), latency_percentile(100), memb_peak_max,
+			(double)memb_peak_sum/config.numb_motes);
+		if(sim_stats_period > 0){
+			//Mote that forwarded the most by its last report
+			for(i = 1; i < config.numb_motes; i++){
+				motes_reported += (reported[i].samples_sent + reported[i].forwarded > 0);
+				if(reported[i].forwarded > reported[busiest].forwarded){
+					busiest = i;
+				}
+			}
+			printf("stats_reports=%u motes_reported=%u busiest_mote=%u busiest_forwarded=%u\n", stats_reports, motes_reported, busiest,
+				reported[busiest].forwarded);
+		}
+		printf("energy_mean_mj=%.0f energy_max_mj=%.0f energy_max_mote=%u energy_max_depth=%d radio_on_pct=%.1f\n",
+			energy_mean, energy[energy_max].energy, energy_max, energy[energy_max].depth,
+			100*energy[energy_max].radio_on);
+		printf("active_ms_mean=%.0f active_ms_max=%.0f active_max_mote=%u active_max_depth=%d\n", active_mean,
+			(sim_mote(active_max)->tx_us + sim_mote(active_max)->rx_us)/1000.0, active_max, energy[active_max].depth);
+		if(config.levels){
+			print_levels();
+		}
+	}
+	free(flood_heard);
+	free(reported);
+	free(sent_origin);
+	free(pending_origin);
+	free(sample_origin);
+	free(latencies);
+	free(energy);
+	if(energy_file != NULL){
+		fclose(energy_file);
+	}
+	if(trace_file != NULL){
+		printf("trace_records=%llu trace_overwritten=%llu\n", (unsigned long long)trace_records,
+			(unsigned long long)trace_overwritten);
+		fclose(trace_file);
+	}
+
+	return 0;
+}
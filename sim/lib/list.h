@@ -0,0 +1,29 @@
+/**
+ * @file
+ * 	Host stand-in for the Contiki linked list library. Items must start with a next pointer.
+ */
+#ifndef __LIST_H__
+#define __LIST_H__
+
+#define LIST_CONCAT2(s1, s2) s1##s2
+#define LIST_CONCAT(s1, s2) LIST_CONCAT2(s1, s2)
+
+#define LIST(name) \
+	static void *LIST_CONCAT(name,_list) = NULL; \
+	static list_t name = (list_t)&LIST_CONCAT(name,_list)
+
+typedef void ** list_t;
+
+void list_init(list_t list);
+void *list_head(list_t list);
+void *list_tail(list_t list);
+void *list_pop(list_t list);
+void list_push(list_t list, void *item);
+void *list_chop(list_t list);
+void list_add(list_t list, void *item);
+void list_remove(list_t list, void *item);
+int list_length(list_t list);
+void list_insert(list_t list, void *previtem, void *newitem);
+void *list_item_next(void *item);
+
+#endif /* __LIST_H__ */
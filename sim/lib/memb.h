@@ -0,0 +1,30 @@
+/**
+ * @file
+ * 	Host stand-in for the Contiki memory block allocator.
+ */
+#ifndef __MEMB_H__
+#define __MEMB_H__
+
+/**
+ * @brief Memory block pool
+ * @details Unlike Contiki the blocks are not a static array. Each simulated mote gets
+ *          its own blocks on the heap the first time memb_init() runs on it, so only
+ *          this small descriptor is part of the per mote state that is swapped.
+ */
+struct memb{
+	unsigned short size;
+	unsigned short num;
+	char *count;
+	void *mem;
+};
+
+#define MEMB(name, structure, num) \
+	static struct memb name = {sizeof(structure), num, NULL, NULL}
+
+void memb_init(struct memb *m);
+void *memb_alloc(struct memb *m);
+char memb_free(struct memb *m, void *ptr);
+int memb_inmemb(struct memb *m, void *ptr);
+int memb_numfree(struct memb *m);
+
+#endif /* __MEMB_H__ */
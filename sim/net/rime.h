@@ -0,0 +1,97 @@
+/**
+ * @file
+ * 	Host stand-in for the parts of Rime used by GROOT: addresses, packetbuf, broadcast and runicast.
+ */
+#ifndef __RIME_H__
+#define __RIME_H__
+
+#include "contiki.h"
+
+/**
+ * Addresses
+ */
+#ifndef RIMEADDR_SIZE
+	#define RIMEADDR_SIZE 2
+#endif
+
+typedef union{
+	unsigned char u8[RIMEADDR_SIZE];
+} rimeaddr_t;
+
+extern rimeaddr_t rimeaddr_node_addr;
+extern const rimeaddr_t rimeaddr_null;
+
+void rimeaddr_copy(rimeaddr_t *dest, const rimeaddr_t *from);
+int rimeaddr_cmp(const rimeaddr_t *addr1, const rimeaddr_t *addr2);
+void rimeaddr_set_node_addr(rimeaddr_t *addr);
+
+/**
+ * Packet buffer
+ */
+#ifndef PACKETBUF_SIZE
+	#define PACKETBUF_SIZE 128
+#endif
+
+#ifndef PACKETBUF_HDR_SIZE
+	#define PACKETBUF_HDR_SIZE 48
+#endif
+
+void packetbuf_clear(void);
+void *packetbuf_dataptr(void);
+void *packetbuf_hdrptr(void);
+uint16_t packetbuf_datalen(void);
+uint8_t packetbuf_hdrlen(void);
+uint16_t packetbuf_totlen(void);
+void packetbuf_set_datalen(uint16_t len);
+int packetbuf_copyfrom(const void *from, uint16_t len);
+int packetbuf_copyto(void *to);
+
+/**
+ * Broadcast
+ */
+struct broadcast_conn;
+
+struct broadcast_callbacks{
+	void (* recv)(struct broadcast_conn *ptr, const rimeaddr_t *sender);
+	void (* sent)(struct broadcast_conn *ptr, int status, int num_tx);
+};
+
+struct broadcast_conn{
+	uint16_t channel;
+	const struct broadcast_callbacks *u;
+};
+
+void broadcast_open(struct broadcast_conn *c, uint16_t channel, const struct broadcast_callbacks *u);
+void broadcast_close(struct broadcast_conn *c);
+int broadcast_send(struct broadcast_conn *c);
+
+/**
+ * Reliable unicast
+ */
+struct runicast_conn;
+
+struct runicast_callbacks{
+	void (* recv)(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno);
+	void (* sent)(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions);
+	void (* timedout)(struct runicast_conn *c, const rimeaddr_t *to, uint8_t retransmissions);
+};
+
+/**
+ * @brief Reliable unicast connection
+ * @details As in Rime only one packet can be in flight per connection. The
+ *          pending frame is owned by the simulator.
+ */
+struct runicast_conn{
+	uint16_t channel;
+	const struct runicast_callbacks *u;
+	uint8_t is_tx;
+	uint8_t sndnxt;
+	void *frame;
+};
+
+void runicast_open(struct runicast_conn *c, uint16_t channel, const struct runicast_callbacks *u);
+void runicast_close(struct runicast_conn *c);
+int runicast_send(struct runicast_conn *c, const rimeaddr_t *receiver, uint8_t max_retransmissions);
+uint8_t runicast_is_transmitting(struct runicast_conn *c);
+
+#endif /* __RIME_H__ */
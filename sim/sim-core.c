@@ -0,0 +1,485 @@
+/**
+ * @file
+ * 	GROOT simulator core. Event queue, motes, clock and callback timers.
+ * @details
+ * 	Every writable static of the GROOT sources is linked into the groot_state section
+ * 	(see groot-state.ld). Before a mote runs, the section of the previous mote is saved
+ * 	and the section of the new mote is restored, so the unchanged single mote code can
+ * 	run thousands of motes in one process.
+ */
+
+#include "sim.h"
+#include <stdarg.h>
+#include <math.h>
+
+#undef printf
+
+/**
+ * @brief Queued event. Ordered by time then by seq so runs are deterministic
+ */
+struct SIM_EVENT{
+	uint64_t time;
+	uint64_t seq;
+	void (*fn)(void *);
+	void *ptr;
+	uint32_t mote;
+	uint32_t arg;
+	uint8_t type;
+};
+
+extern char __start_groot_state[];
+extern char __stop_groot_state[];
+
+struct SIM_STATS sim_stats;
+uint8_t sim_verbose = 0;
+
+static struct SIM_MOTE *motes = NULL;
+static uint32_t numb_motes = 0;
+static struct SIM_MOTE *current = NULL;
+static char *states = NULL;
+static size_t state_size = 0;
+
+static struct SIM_EVENT *queue = NULL;
+static uint32_t queue_length = 0;
+static uint32_t queue_size = 0;
+static uint64_t queue_seq = 0;
+
+static uint64_t now = 0;
+static uint64_t rng_state = 0;
+unsigned int sim_sensor_drift = 0;
+unsigned int sim_stats_period = 0;
+static struct SIM_RADIO radio;
+static sim_rx_hook_t rx_hook = NULL;
+static sim_tx_hook_t tx_hook = NULL;
+/*------------------------------------------------- Event Queue ---------------------------------------------------------*/
+static int
+event_before(struct SIM_EVENT *a, struct SIM_EVENT *b){
+	if(a->time != b->time){
+		return a->time < b->time;
+	}
+	return a->seq < b->seq;
+}
+
+static void
+queue_push(struct SIM_EVENT *ev){
+	uint32_t i, parent;
+
+	if(queue_length == queue_size){
+		queue_size = (queue_size == 0) ? 1024 : queue_size*2;
+		queue = realloc(queue, queue_size*sizeof(struct SIM_EVENT));
+		if(queue == NULL){
+			fprintf(stderr, "sim: out of memory for event queue\n");
+			exit(1);
+		}
+	}
+
+	i = queue_length++;
+	while(i > 0){
+		parent = (i-1)/2;
+		if(!event_before(ev, &queue[parent])){
+			break;
+		}
+		queue[i] = queue[parent];
+		i = parent;
+	}
+	queue[i] = *ev;
+}
+
+static void
+queue_pop(struct SIM_EVENT *ev){
+	struct SIM_EVENT last;
+	uint32_t i = 0, child;
+
+	*ev = queue[0];
+	last = queue[--queue_length];
+	while((child = 2*i+1) < queue_length){
+		if(child+1 < queue_length && event_before(&queue[child+1], &queue[child])){
+			child += 1;
+		}
+		if(!event_before(&queue[child], &last)){
+			break;
+		}
+		queue[i] = queue[child];
+		i = child;
+	}
+	queue[i] = last;
+}
+
+uint64_t
+sim_schedule(uint8_t type, uint32_t mote, uint64_t at, void (*fn)(void *), void *ptr, uint32_t arg){
+	struct SIM_EVENT ev;
+
+	ev.time = (at < now) ? now : at;
+	ev.seq = ++queue_seq;
+	ev.type = type;
+	ev.mote = mote;
+	ev.fn = fn;
+	ev.ptr = ptr;
+	ev.arg = arg;
+	queue_push(&ev);
+
+	return ev.seq;
+}
+/*------------------------------------------------- Motes ---------------------------------------------------------------*/
+int
+sim_init(uint32_t numb, uint64_t seed, struct SIM_RADIO *r){
+	uint32_t i;
+
+	if(numb == 0 || numb >= 0xFFFF){
+		return 0;
+	}
+
+	numb_motes = numb;
+	memcpy(&radio, r, sizeof(struct SIM_RADIO));
+	rng_state = seed*0x9E3779B97F4A7C15ULL + 1;
+	srand((unsigned int)seed);
+
+	state_size = __stop_groot_state - __start_groot_state;
+	motes = calloc(numb_motes, sizeof(struct SIM_MOTE));
+	states = malloc(state_size*numb_motes + 1);
+	if(motes == NULL || states == NULL){
+		return 0;
+	}
+
+	//Every mote starts from the pristine image of the static data
+	for(i = 0; i < numb_motes; i++){
+		motes[i].id = i;
+		motes[i].addr.u8[0] = (i+1) & 0xFF;
+		motes[i].addr.u8[1] = ((i+1) >> 8) & 0xFF;
+		motes[i].state = states + i*state_size;
+		memcpy(motes[i].state, __start_groot_state, state_size);
+	}
+
+	return 1;
+}
+
+struct SIM_MOTE *
+sim_mote(uint32_t id){
+	if(id >= numb_motes){
+		return NULL;
+	}
+	return &motes[id];
+}
+
+uint32_t
+sim_numb_motes(void){
+	return numb_motes;
+}
+
+struct SIM_MOTE *
+sim_current(void){
+	return current;
+}
+
+uint32_t
+sim_addr_to_id(const rimeaddr_t *addr){
+	uint32_t id = ((uint32_t)addr->u8[1] << 8) | addr->u8[0];
+	if(id == 0 || id > numb_motes){
+		return SIM_BROADCAST;
+	}
+	return id-1;
+}
+
+/**
+ * @brief Make a mote the running one
+ * @details Saves the static data of the running mote and restores the one of the new mote.
+ *
+ * @param mote Mote to run
+ */
+void
+sim_switch(struct SIM_MOTE *mote){
+	if(mote == current){
+		return;
+	}
+	if(current != NULL){
+		memcpy(current->state, __start_groot_state, state_size);
+	}
+	memcpy(__start_groot_state, mote->state, state_size);
+	current = mote;
+	rimeaddr_copy(&rimeaddr_node_addr, &mote->addr);
+}
+
+/**
+ * @brief Reception probability of a link at a distance
+ */
+static uint16_t
+link_prr(double distance){
+	double prr = 1.0;
+
+	if(distance > radio.range){
+		return 0;
+	}
+	if(radio.model == SIM_RADIO_LOSSY && distance > radio.range/2){
+		prr = 1.0 - (distance - radio.range/2)/(radio.range/2);
+	}
+	prr *= 1.0 - radio.loss;
+
+	return (uint16_t)(prr*65535);
+}
+
+/**
+ * @brief Compute links between motes
+ * @details Motes are bucketed in a grid with cells the size of the range so only
+ *          neighbouring cells are compared.
+ */
+void
+sim_connect(void){
+	double min_x = motes[0].x, min_y = motes[0].y, max_x = motes[0].x, max_y = motes[0].y;
+	uint32_t *cell_head, *cell_next;
+	uint32_t cols, rows, i, j, c, n;
+	int cx, cy, dx, dy;
+	double dist;
+	uint16_t prr;
+
+	for(i = 1; i < numb_motes; i++){
+		min_x = fmin(min_x, motes[i].x);
+		min_y = fmin(min_y, motes[i].y);
+		max_x = fmax(max_x, motes[i].x);
+		max_y = fmax(max_y, motes[i].y);
+	}
+
+	cols = (uint32_t)((max_x - min_x)/radio.range) + 1;
+	rows = (uint32_t)((max_y - min_y)/radio.range) + 1;
+	cell_head = malloc(sizeof(uint32_t)*cols*rows);
+	cell_next = malloc(sizeof(uint32_t)*numb_motes);
+	for(c = 0; c < cols*rows; c++){
+		cell_head[c] = SIM_BROADCAST;
+	}
+	for(i = 0; i < numb_motes; i++){
+		cx = (int)((motes[i].x - min_x)/radio.range);
+		cy = (int)((motes[i].y - min_y)/radio.range);
+		c = cy*cols + cx;
+		cell_next[i] = cell_head[c];
+		cell_head[c] = i;
+	}
+
+	//Links are stored in id order so delivery order does not depend on bucketing
+	for(i = 0; i < numb_motes; i++){
+		free(motes[i].links);
+		motes[i].links = NULL;
+		motes[i].numb_links = 0;
+		n = 0;
+		cx = (int)((motes[i].x - min_x)/radio.range);
+		cy = (int)((motes[i].y - min_y)/radio.range);
+		for(dy = -1; dy <= 1; dy++){
+			for(dx = -1; dx <= 1; dx++){
+				if(cx+dx < 0 || cy+dy < 0 || cx+dx >= (int)cols || cy+dy >= (int)rows){
+					continue;
+				}
+				for(j = cell_head[(cy+dy)*cols + cx+dx]; j != SIM_BROADCAST; j = cell_next[j]){
+					if(j == i){
+						continue;
+					}
+					dist = hypot(motes[i].x - motes[j].x, motes[i].y - motes[j].y);
+					prr = link_prr(dist);
+					if(prr == 0){
+						continue;
+					}
+					if(motes[i].numb_links == n){
+						n = (n == 0) ? 8 : n*2;
+						motes[i].links = realloc(motes[i].links, n*sizeof(struct SIM_LINK));
+					}
+					motes[i].links[motes[i].numb_links].mote = j;
+					motes[i].links[motes[i].numb_links].prr = prr;
+					motes[i].numb_links += 1;
+				}
+			}
+		}
+		//Insertion sort. Neighbour lists are short
+		for(j = 1; j < motes[i].numb_links; j++){
+			struct SIM_LINK tmp = motes[i].links[j];
+			n = j;
+			while(n > 0 && motes[i].links[n-1].mote > tmp.mote){
+				motes[i].links[n] = motes[i].links[n-1];
+				n--;
+			}
+			motes[i].links[n] = tmp;
+		}
+	}
+
+	free(cell_head);
+	free(cell_next);
+}
+
+uint8_t
+sim_collisions(void){
+	return radio.collisions;
+}
+
+void
+sim_conn_register(uint8_t is_runicast, uint16_t channel, void *conn){
+	uint8_t i;
+
+	for(i = 0; i < SIM_CONN_LIMIT; i++){
+		if(current->conns[i].conn == NULL){
+			current->conns[i].is_runicast = is_runicast;
+			current->conns[i].channel = channel;
+			current->conns[i].conn = conn;
+			return;
+		}
+	}
+	fprintf(stderr, "sim: mote %u opened too many connections\n", current->id);
+}
+
+void
+sim_conn_unregister(void *conn){
+	uint8_t i;
+
+	for(i = 0; i < SIM_CONN_LIMIT; i++){
+		if(current->conns[i].conn == conn){
+			memset(&current->conns[i], 0, sizeof(struct SIM_CONN));
+		}
+	}
+}
+
+void
+sim_set_rx_hook(sim_rx_hook_t hook){
+	rx_hook = hook;
+}
+
+void
+sim_rx_hook(struct SIM_MOTE *mote, const rimeaddr_t *from, const void *data, uint16_t len){
+	if(rx_hook != NULL){
+		rx_hook(mote, from, data, len);
+	}
+}
+
+void
+sim_set_tx_hook(sim_tx_hook_t hook){
+	tx_hook = hook;
+}
+
+void
+sim_tx_hook(struct SIM_MOTE *mote, const void *data, uint16_t len){
+	if(tx_hook != NULL){
+		tx_hook(mote, data, len);
+	}
+}
+/*------------------------------------------------- Main Loop -----------------------------------------------------------*/
+void
+sim_call(uint32_t mote, uint64_t at, void (*fn)(void *), void *arg){
+	sim_schedule(SIM_EV_CALL, mote, at, fn, arg, 0);
+}
+
+void
+sim_run(uint64_t until){
+	struct SIM_EVENT ev;
+	struct ctimer *c;
+
+	while(queue_length > 0 && queue[0].time <= until){
+		queue_pop(&ev);
+		now = ev.time;
+		sim_stats.events += 1;
+
+		switch(ev.type){
+			case SIM_EV_CALL:
+				sim_switch(&motes[ev.mote]);
+				ev.fn(ev.ptr);
+				break;
+			case SIM_EV_CTIMER:
+				//Timer memory belongs to the mote so switch before looking at it
+				sim_switch(&motes[ev.mote]);
+				c = (struct ctimer *)ev.ptr;
+				if(c->id != ev.seq){
+					break;
+				}
+				c->id = 0;
+				c->f(c->ptr);
+				break;
+			case SIM_EV_FRAME:
+				sim_radio_frame_end(ev.ptr);
+				break;
+			case SIM_EV_RUNICAST:
+				sim_switch(&motes[ev.mote]);
+				sim_radio_runicast(ev.ptr, ev.arg);
+				break;
+		}
+	}
+
+	if(now < until){
+		now = until;
+	}
+}
+
+uint64_t
+sim_now(void){
+	return now;
+}
+
+uint32_t
+sim_random(void){
+	//xorshift64*
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+double
+sim_random_unit(void){
+	return sim_random() / 4294967296.0;
+}
+
+int
+sim_printf(const char *fmt, ...){
+	va_list ap;
+	int ret;
+
+	if(!sim_verbose){
+		return 0;
+	}
+	va_start(ap, fmt);
+	ret = vprintf(fmt, ap);
+	va_end(ap);
+	return ret;
+}
+/*------------------------------------------------- Clock and Timers ----------------------------------------------------*/
+uint64_t
+sim_ticks_to_us(clock_time_t ticks){
+	return ((uint64_t)ticks*SIM_US_PER_SECOND)/CLOCK_SECOND;
+}
+
+clock_time_t
+clock_time(void){
+	return (clock_time_t)((now*CLOCK_SECOND)/SIM_US_PER_SECOND);
+}
+
+unsigned long
+clock_seconds(void){
+	return (unsigned long)(now/SIM_US_PER_SECOND);
+}
+
+void
+ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr){
+	c->f = f;
+	c->ptr = ptr;
+	c->start = clock_time();
+	c->interval = t;
+	c->id = sim_schedule(SIM_EV_CTIMER, current->id, now + sim_ticks_to_us(t), NULL, c, 0);
+}
+
+/**
+ * @brief Restart the timer one interval after the last expiry
+ * @details Timers fire at their expiry time so when called from the callback,
+ *          as GROOT does, the next expiry is one interval from now.
+ */
+void
+ctimer_reset(struct ctimer *c){
+	c->start += c->interval;
+	c->id = sim_schedule(SIM_EV_CTIMER, current->id, now + sim_ticks_to_us(c->interval), NULL, c, 0);
+}
+
+void
+ctimer_restart(struct ctimer *c){
+	ctimer_set(c, c->interval, c->f, c->ptr);
+}
+
+void
+ctimer_stop(struct ctimer *c){
+	c->id = 0;
+}
+
+int
+ctimer_expired(struct ctimer *c){
+	return c->id == 0;
+}
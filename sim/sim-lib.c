@@ -0,0 +1,180 @@
+/**
+ * @file
+ * 	GROOT simulator stand-ins for the Contiki list and memb libraries.
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+
+struct list{
+	struct list *next;
+};
+/*------------------------------------------------- List ----------------------------------------------------------------*/
+void
+list_init(list_t list){
+	*list = NULL;
+}
+
+void *
+list_head(list_t list){
+	return *list;
+}
+
+void *
+list_tail(list_t list){
+	struct list *l;
+
+	if(*list == NULL){
+		return NULL;
+	}
+	for(l = *list; l->next != NULL; l = l->next);
+	return l;
+}
+
+void
+list_remove(list_t list, void *item){
+	struct list *l, *r = NULL;
+
+	for(l = *list; l != NULL; l = l->next){
+		if(l == item){
+			if(r == NULL){
+				*list = l->next;
+			} else {
+				r->next = l->next;
+			}
+			l->next = NULL;
+			return;
+		}
+		r = l;
+	}
+}
+
+void
+list_add(list_t list, void *item){
+	struct list *l;
+
+	//An item can only be in the list once
+	list_remove(list, item);
+	((struct list *)item)->next = NULL;
+
+	l = list_tail(list);
+	if(l == NULL){
+		*list = item;
+	} else {
+		l->next = item;
+	}
+}
+
+void
+list_push(list_t list, void *item){
+	list_remove(list, item);
+	((struct list *)item)->next = *list;
+	*list = item;
+}
+
+void *
+list_pop(list_t list){
+	struct list *l = *list;
+
+	if(l != NULL){
+		*list = l->next;
+	}
+	return l;
+}
+
+void *
+list_chop(list_t list){
+	struct list *l = list_tail(list);
+
+	if(l != NULL){
+		list_remove(list, l);
+	}
+	return l;
+}
+
+int
+list_length(list_t list){
+	struct list *l;
+	int n = 0;
+
+	for(l = *list; l != NULL; l = l->next){
+		n += 1;
+	}
+	return n;
+}
+
+void
+list_insert(list_t list, void *previtem, void *newitem){
+	if(previtem == NULL){
+		list_push(list, newitem);
+	} else {
+		((struct list *)newitem)->next = ((struct list *)previtem)->next;
+		((struct list *)previtem)->next = newitem;
+	}
+}
+
+void *
+list_item_next(void *item){
+	return (item == NULL) ? NULL : ((struct list *)item)->next;
+}
+/*------------------------------------------------- Memory Blocks -------------------------------------------------------*/
+void
+memb_init(struct memb *m){
+	if(m->mem == NULL){
+		m->count = calloc(m->num, 1);
+		m->mem = calloc(m->num, m->size);
+		if(m->count == NULL || m->mem == NULL){
+			fprintf(stderr, "sim: out of memory for memb\n");
+			exit(1);
+		}
+	}
+	memset(m->count, 0, m->num);
+	memset(m->mem, 0, (size_t)m->size*m->num);
+}
+
+void *
+memb_alloc(struct memb *m){
+	unsigned short i;
+
+	for(i = 0; i < m->num; i++){
+		if(m->count[i] == 0){
+			m->count[i] = 1;
+			return (char *)m->mem + (size_t)i*m->size;
+		}
+	}
+	return NULL;
+}
+
+char
+memb_free(struct memb *m, void *ptr){
+	unsigned short i;
+
+	if(!memb_inmemb(m, ptr)){
+		return -1;
+	}
+	i = ((char *)ptr - (char *)m->mem)/m->size;
+	if(m->count[i] > 0){
+		m->count[i] -= 1;
+	}
+	return m->count[i];
+}
+
+int
+memb_inmemb(struct memb *m, void *ptr){
+	return m->mem != NULL && (char *)ptr >= (char *)m->mem &&
+		(char *)ptr < (char *)m->mem + (size_t)m->size*m->num;
+}
+
+int
+memb_numfree(struct memb *m){
+	unsigned short i;
+	int numfree = 0;
+
+	for(i = 0; i < m->num; i++){
+		if(m->count[i] == 0){
+			numfree += 1;
+		}
+	}
+	return numfree;
+}
@@ -0,0 +1,381 @@
+/**
+ * @file
+ * 	GROOT simulator radio. Host stand-in for rimeaddr, packetbuf, broadcast and runicast.
+ * @details
+ * 	Frames occupy the air for their length at 250 kbit/s. Every neighbour of the sender
+ * 	receives a frame with the link reception probability. With collisions enabled two
+ * 	frames overlapping at a receiver are both lost and a transmitting mote hears nothing
+ * 	(there is no carrier sense, as with nullmac).
+ */
+
+#include "sim.h"
+
+/**
+ * Runicast Actions
+ */
+#define SIM_RUNICAST_ACKED 0x01
+#define SIM_RUNICAST_REXMIT 0x02
+#define SIM_RUNICAST_TIMEDOUT 0x03
+
+/**
+ * @brief A frame on the air
+ * @details lost has one flag per link of the sender and is stored after the frame.
+ */
+struct SIM_FRAME{
+	uint32_t src;
+	uint32_t dst;
+	uint8_t is_runicast;
+	uint8_t seqno;
+	uint8_t rxmit;
+	uint8_t max_rxmit;
+	uint8_t delivered;
+	uint16_t channel;
+	uint16_t len;
+	void *conn;
+	uint8_t *lost;
+	uint8_t data[PACKETBUF_SIZE];
+};
+
+rimeaddr_t rimeaddr_node_addr;
+const rimeaddr_t rimeaddr_null = {{0, 0}};
+
+static uint8_t packetbuf[PACKETBUF_HDR_SIZE + PACKETBUF_SIZE];
+static uint16_t buflen = 0;
+/*------------------------------------------------- Addresses -----------------------------------------------------------*/
+void
+rimeaddr_copy(rimeaddr_t *dest, const rimeaddr_t *from){
+	memcpy(dest, from, sizeof(rimeaddr_t));
+}
+
+int
+rimeaddr_cmp(const rimeaddr_t *addr1, const rimeaddr_t *addr2){
+	return memcmp(addr1, addr2, sizeof(rimeaddr_t)) == 0;
+}
+
+void
+rimeaddr_set_node_addr(rimeaddr_t *addr){
+	rimeaddr_copy(&rimeaddr_node_addr, addr);
+}
+/*------------------------------------------------- Packet Buffer -------------------------------------------------------*/
+void
+packetbuf_clear(void){
+	buflen = 0;
+}
+
+void *
+packetbuf_dataptr(void){
+	return packetbuf + PACKETBUF_HDR_SIZE;
+}
+
+void *
+packetbuf_hdrptr(void){
+	return packetbuf + PACKETBUF_HDR_SIZE;
+}
+
+uint16_t
+packetbuf_datalen(void){
+	return buflen;
+}
+
+uint8_t
+packetbuf_hdrlen(void){
+	return 0;
+}
+
+uint16_t
+packetbuf_totlen(void){
+	return buflen;
+}
+
+void
+packetbuf_set_datalen(uint16_t len){
+	buflen = (len > PACKETBUF_SIZE) ? PACKETBUF_SIZE : len;
+}
+
+int
+packetbuf_copyfrom(const void *from, uint16_t len){
+	packetbuf_set_datalen(len);
+	memcpy(packetbuf_dataptr(), from, buflen);
+	return buflen;
+}
+
+int
+packetbuf_copyto(void *to){
+	memcpy(to, packetbuf_dataptr(), buflen);
+	return buflen;
+}
+/*------------------------------------------------- Radio ---------------------------------------------------------------*/
+/**
+ * @brief Copy the packet buffer into a new frame sent by the running mote
+ */
+static struct SIM_FRAME *
+frame_new(uint8_t is_runicast, uint32_t dst, uint16_t channel, void *conn){
+	struct SIM_MOTE *src = sim_current();
+	struct SIM_FRAME *f = malloc(sizeof(struct SIM_FRAME) + src->numb_links);
+
+	memset(f, 0, sizeof(struct SIM_FRAME));
+	f->src = src->id;
+	f->dst = dst;
+	f->is_runicast = is_runicast;
+	f->channel = channel;
+	f->conn = conn;
+	f->lost = (uint8_t *)(f + 1);
+	f->len = packetbuf_datalen();
+	memcpy(f->data, packetbuf_dataptr(), f->len);
+
+	return f;
+}
+
+/**
+ * @brief Put a frame on the air
+ * @details The radio sends one frame at a time so a frame queued while the
+ *          previous one is still on the air starts when it ends.
+ */
+static void
+radio_tx(struct SIM_FRAME *f){
+	struct SIM_MOTE *src = sim_mote(f->src), *n;
+	struct SIM_FRAME *cur;
+	uint64_t start = sim_now(), end;
+	uint32_t i;
+
+	if(src->tx_until > start){
+		start = src->tx_until;
+	}
+	end = start + (uint64_t)(f->len + SIM_FRAME_OVERHEAD)*SIM_BYTE_US;
+	memset(f->lost, 0, src->numb_links);
+
+	if(sim_collisions()){
+		//Half duplex. Sending ends any reception in progress
+		if(src->rx_until > start){
+			cur = (struct SIM_FRAME *)src->rx_frame;
+			cur->lost[src->rx_link] = 1;
+			src->rx_until = start;
+		}
+
+		for(i = 0; i < src->numb_links; i++){
+			n = sim_mote(src->links[i].mote);
+			if(n->tx_until > start){
+				f->lost[i] = 1;
+				continue;
+			}
+			if(n->rx_until > start){
+				cur = (struct SIM_FRAME *)n->rx_frame;
+				if(!cur->lost[n->rx_link]){
+					cur->lost[n->rx_link] = 1;
+					sim_stats.collisions += 1;
+				}
+				f->lost[i] = 1;
+				sim_stats.collisions += 1;
+				if(end <= n->rx_until){
+					continue;
+				}
+			}
+			n->rx_until = end;
+			n->rx_frame = f;
+			n->rx_link = i;
+		}
+	}
+
+	src->tx_until = end;
+	src->tx_us += end - start;
+	sim_tx_hook(src, f->data, f->len);
+	sim_stats.frames_tx += 1;
+	sim_stats.bytes_tx += f->len + SIM_FRAME_OVERHEAD;
+	sim_schedule(SIM_EV_FRAME, f->src, end, NULL, f, 0);
+}
+
+/**
+ * @brief Hand a frame to a mote's connection
+ */
+static void
+deliver(struct SIM_MOTE *n, struct SIM_FRAME *f){
+	struct SIM_MOTE *src = sim_mote(f->src);
+	struct broadcast_conn *bc;
+	struct runicast_conn *rc;
+	uint8_t i;
+
+	for(i = 0; i < SIM_CONN_LIMIT; i++){
+		if(n->conns[i].conn != NULL && n->conns[i].is_runicast == f->is_runicast &&
+			n->conns[i].channel == f->channel){
+			break;
+		}
+	}
+	if(i == SIM_CONN_LIMIT){
+		return;
+	}
+
+	sim_switch(n);
+	packetbuf_copyfrom(f->data, f->len);
+	sim_stats.frames_rx += 1;
+	n->rx_us += (uint64_t)(f->len + SIM_FRAME_OVERHEAD)*SIM_BYTE_US;
+	sim_rx_hook(n, &src->addr, f->data, f->len);
+
+	if(f->is_runicast){
+		rc = (struct runicast_conn *)n->conns[i].conn;
+		rc->u->recv(rc, &src->addr, f->seqno);
+	} else {
+		bc = (struct broadcast_conn *)n->conns[i].conn;
+		bc->u->recv(bc, &src->addr);
+	}
+}
+
+static uint8_t
+link_ok(struct SIM_LINK *link){
+	return link->prr == 0xFFFF || (sim_random() & 0xFFFF) < link->prr;
+}
+
+/**
+ * @brief Frame left the air. Deliver to neighbours and run the runicast state machine
+ *
+ * @param frame Frame
+ */
+void
+sim_radio_frame_end(void *frame){
+	struct SIM_FRAME *f = (struct SIM_FRAME *)frame;
+	struct SIM_MOTE *src = sim_mote(f->src);
+	struct SIM_LINK *dst_link = NULL;
+	uint8_t received = 0;
+	uint32_t i;
+
+	for(i = 0; i < src->numb_links; i++){
+		if(f->is_runicast && src->links[i].mote != f->dst){
+			continue;
+		}
+		if(f->lost[i] || !link_ok(&src->links[i])){
+			sim_stats.frames_lost += 1;
+			continue;
+		}
+		if(f->is_runicast){
+			dst_link = &src->links[i];
+			received = 1;
+		} else {
+			deliver(sim_mote(src->links[i].mote), f);
+		}
+	}
+
+	if(!f->is_runicast){
+		free(f);
+		return;
+	}
+
+	//Receiver drops duplicates of a frame it already has
+	if(received && !f->delivered){
+		f->delivered = 1;
+		deliver(sim_mote(f->dst), f);
+	}
+
+	//The ack is sent whether or not it gets back
+	if(received){
+		sim_mote(f->dst)->tx_us += SIM_ACK_BYTES*SIM_BYTE_US;
+	}
+	if(received && link_ok(dst_link)){
+		src->rx_us += SIM_ACK_BYTES*SIM_BYTE_US;
+		sim_schedule(SIM_EV_RUNICAST, f->src, sim_now() + SIM_ACK_BYTES*SIM_BYTE_US, NULL, f, SIM_RUNICAST_ACKED);
+	} else if(f->rxmit < f->max_rxmit){
+		sim_schedule(SIM_EV_RUNICAST, f->src, sim_now() + sim_ticks_to_us(SIM_REXMIT_TIME), NULL, f, SIM_RUNICAST_REXMIT);
+	} else {
+		sim_schedule(SIM_EV_RUNICAST, f->src, sim_now(), NULL, f, SIM_RUNICAST_TIMEDOUT);
+	}
+}
+
+/**
+ * @brief Runicast retransmission or completion. Runs as the sender
+ *
+ * @param frame Frame in flight
+ * @param action SIM_RUNICAST_ACKED, SIM_RUNICAST_REXMIT or SIM_RUNICAST_TIMEDOUT
+ */
+void
+sim_radio_runicast(void *frame, uint32_t action){
+	struct SIM_FRAME *f = (struct SIM_FRAME *)frame;
+	struct runicast_conn *c = (struct runicast_conn *)f->conn;
+	rimeaddr_t to;
+
+	//Connection was closed while the frame was in flight
+	if(c->frame != f){
+		free(f);
+		return;
+	}
+
+	if(action == SIM_RUNICAST_REXMIT){
+		f->rxmit += 1;
+		radio_tx(f);
+		return;
+	}
+
+	memset(&to, 0, sizeof(rimeaddr_t));
+	if(f->dst != SIM_BROADCAST){
+		rimeaddr_copy(&to, &sim_mote(f->dst)->addr);
+	}
+	c->is_tx = 0;
+	c->frame = NULL;
+
+	if(action == SIM_RUNICAST_ACKED){
+		sim_stats.runicast_sent += 1;
+		if(c->u->sent != NULL){
+			c->u->sent(c, &to, f->rxmit);
+		}
+	} else {
+		sim_stats.runicast_timedout += 1;
+		if(c->u->timedout != NULL){
+			c->u->timedout(c, &to, f->rxmit);
+		}
+	}
+	free(f);
+}
+/*------------------------------------------------- Broadcast -----------------------------------------------------------*/
+void
+broadcast_open(struct broadcast_conn *c, uint16_t channel, const struct broadcast_callbacks *u){
+	c->channel = channel;
+	c->u = u;
+	sim_conn_register(0, channel, c);
+}
+
+void
+broadcast_close(struct broadcast_conn *c){
+	sim_conn_unregister(c);
+}
+
+int
+broadcast_send(struct broadcast_conn *c){
+	radio_tx(frame_new(0, SIM_BROADCAST, c->channel, c));
+	return 1;
+}
+/*------------------------------------------------- Runicast ------------------------------------------------------------*/
+void
+runicast_open(struct runicast_conn *c, uint16_t channel, const struct runicast_callbacks *u){
+	memset(c, 0, sizeof(struct runicast_conn));
+	c->channel = channel;
+	c->u = u;
+	sim_conn_register(1, channel, c);
+}
+
+void
+runicast_close(struct runicast_conn *c){
+	c->is_tx = 0;
+	c->frame = NULL;
+	sim_conn_unregister(c);
+}
+
+int
+runicast_send(struct runicast_conn *c, const rimeaddr_t *receiver, uint8_t max_retransmissions){
+	struct SIM_FRAME *f;
+
+	if(c->is_tx){
+		return 0;
+	}
+
+	f = frame_new(1, sim_addr_to_id(receiver), c->channel, c);
+	c->sndnxt += 1;
+	f->seqno = c->sndnxt;
+	f->max_rxmit = max_retransmissions;
+
+	c->is_tx = 1;
+	c->frame = f;
+	radio_tx(f);
+	return 1;
+}
+
+uint8_t
+runicast_is_transmitting(struct runicast_conn *c){
+	return c->is_tx;
+}
@@ -0,0 +1,272 @@
+/**
+ * @file
+ * 	Header file for the GROOT host simulator. A discrete event simulator that runs
+ * 	many motes in one process against host stand-ins for Contiki and Rime.
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include "contiki.h"
+#include "net/rime.h"
+
+/**
+ * General Definitions
+ */
+#define SIM_US_PER_SECOND 1000000ULL
+
+#ifndef SIM_CONN_LIMIT
+	#define SIM_CONN_LIMIT 4
+#endif
+
+/**
+ * Radio Definitions
+ */
+#ifndef SIM_BYTE_US
+	#define SIM_BYTE_US 32 //250 kbit/s
+#endif
+
+#ifndef SIM_FRAME_OVERHEAD
+	#define SIM_FRAME_OVERHEAD 23 //PHY sync and length, MAC header, FCS and Rime header
+#endif
+
+#ifndef SIM_ACK_BYTES
+	#define SIM_ACK_BYTES 5
+#endif
+
+#ifndef SIM_REXMIT_TIME
+	#define SIM_REXMIT_TIME CLOCK_SECOND
+#endif
+
+#ifndef SIM_TX_MA
+	#define SIM_TX_MA 17.4 //CC2420 current sending at 0 dBm
+#endif
+
+#ifndef SIM_RX_MA
+	#define SIM_RX_MA 19.7 //CC2420 current receiving or listening
+#endif
+
+#ifndef SIM_VOLTS
+	#define SIM_VOLTS 3.0
+#endif
+
+#define SIM_BROADCAST 0xFFFFFFFF
+
+/**
+ * Radio Models
+ */
+#ifndef SIM_RADIO_UDG
+	#define SIM_RADIO_UDG 0x00 //Unit disk. Every mote in range receives
+#endif
+
+#ifndef SIM_RADIO_LOSSY
+	#define SIM_RADIO_LOSSY 0x01 //Reception falls off linearly in the outer half of the range
+#endif
+
+/**
+ * Event Types
+ */
+#define SIM_EV_CALL 0x01
+#define SIM_EV_CTIMER 0x02
+#define SIM_EV_FRAME 0x03
+#define SIM_EV_RUNICAST 0x04
+
+/**
+ * @brief Radio range model
+ *
+ * @param model SIM_RADIO_UDG or SIM_RADIO_LOSSY
+ * @param range Communication range in topology units
+ * @param loss Extra uniform loss probability on every link
+ * @param collisions 1 when overlapping frames at a receiver are both lost
+ */
+struct SIM_RADIO{
+	uint8_t model;
+	double range;
+	double loss;
+	uint8_t collisions;
+};
+
+/**
+ * @brief A neighbour in range. prr is the reception probability scaled to 65535
+ */
+struct SIM_LINK{
+	uint32_t mote;
+	uint16_t prr;
+};
+
+/**
+ * @brief Connection opened by a mote. Pointer is only valid while the mote runs
+ */
+struct SIM_CONN{
+	uint8_t is_runicast;
+	uint16_t channel;
+	void *conn;
+};
+
+/**
+ * @brief Radio counters
+ */
+struct SIM_STATS{
+	uint64_t events;
+	uint64_t frames_tx;
+	uint64_t bytes_tx;
+	uint64_t frames_rx;
+	uint64_t frames_lost;
+	uint64_t collisions;
+	uint64_t runicast_sent;
+	uint64_t runicast_timedout;
+};
+
+/**
+ * @brief A simulated mote
+ * @details state holds the copy of the mote's GROOT static data while another mote runs.
+ */
+struct SIM_MOTE{
+	uint32_t id;
+	rimeaddr_t addr;
+	double x;
+	double y;
+	void *state;
+	struct SIM_LINK *links;
+	uint32_t numb_links;
+	struct SIM_CONN conns[SIM_CONN_LIMIT];
+	uint64_t tx_until;
+	uint64_t rx_until;
+	uint64_t tx_us; //Time spent sending frames and acks
+	uint64_t rx_us; //Time spent receiving frames handed to the mote and acks
+	void *rx_frame;
+	uint32_t rx_link;
+};
+
+/**
+ * @brief Called for every frame handed to a mote before its Rime callback runs
+ */
+typedef void (*sim_rx_hook_t)(struct SIM_MOTE *mote, const rimeaddr_t *from, const void *data, uint16_t len);
+
+/**
+ * @brief Called for every frame a mote puts on the air, retransmissions included
+ */
+typedef void (*sim_tx_hook_t)(struct SIM_MOTE *mote, const void *data, uint16_t len);
+
+extern struct SIM_STATS sim_stats;
+extern uint8_t sim_verbose;
+
+/**
+ * @brief Create the motes
+ * @details Allocates numb_motes motes with addresses 1..numb_motes. Must be called
+ *          before any mote code runs.
+ *
+ * @param numb_motes Number of motes
+ * @param seed Seed for the simulator and for rand()
+ * @param radio Radio model
+ */
+int
+sim_init(uint32_t numb_motes, uint64_t seed, struct SIM_RADIO *radio);
+
+/**
+ * @brief Compute the links between motes from their positions and the radio model
+ */
+void
+sim_connect(void);
+
+/**
+ * @brief Get mote by id
+ */
+struct SIM_MOTE *
+sim_mote(uint32_t id);
+
+/**
+ * @brief Number of motes
+ */
+uint32_t
+sim_numb_motes(void);
+
+/**
+ * @brief Run a function as a mote at a given time
+ *
+ * @param mote Mote id
+ * @param at Simulated time in microseconds
+ * @param fn Function to call
+ * @param arg Argument passed to fn
+ */
+void
+sim_call(uint32_t mote, uint64_t at, void (*fn)(void *), void *arg);
+
+/**
+ * @brief Process events until the given time
+ *
+ * @param until Simulated time in microseconds
+ */
+void
+sim_run(uint64_t until);
+
+/**
+ * @brief Current simulated time in microseconds
+ */
+uint64_t
+sim_now(void);
+
+/**
+ * @brief Deterministic simulator random number
+ */
+uint32_t
+sim_random(void);
+
+/**
+ * @brief Deterministic simulator random number in [0, 1)
+ */
+double
+sim_random_unit(void);
+
+/**
+ * @brief Set hook for received frames
+ */
+void
+sim_set_rx_hook(sim_rx_hook_t hook);
+
+/**
+ * @brief Set hook for sent frames
+ */
+void
+sim_set_tx_hook(sim_tx_hook_t hook);
+
+/**
+ * @brief Get mote id from address or SIM_BROADCAST if unknown
+ */
+uint32_t
+sim_addr_to_id(const rimeaddr_t *addr);
+
+/*------------------------------------------ Simulator Internals --------------------------------------------------------*/
+struct SIM_MOTE *
+sim_current(void);
+
+void
+sim_switch(struct SIM_MOTE *mote);
+
+uint64_t
+sim_schedule(uint8_t type, uint32_t mote, uint64_t at, void (*fn)(void *), void *ptr, uint32_t arg);
+
+uint64_t
+sim_ticks_to_us(clock_time_t ticks);
+
+void
+sim_conn_register(uint8_t is_runicast, uint16_t channel, void *conn);
+
+void
+sim_conn_unregister(void *conn);
+
+uint8_t
+sim_collisions(void);
+
+void
+sim_rx_hook(struct SIM_MOTE *mote, const rimeaddr_t *from, const void *data, uint16_t len);
+
+void
+sim_tx_hook(struct SIM_MOTE *mote, const void *data, uint16_t len);
+
+void
+sim_radio_frame_end(void *frame);
+
+void
+sim_radio_runicast(void *frame, uint32_t action);
+
+#endif /* __SIM_H__ */
@@ -0,0 +1,32 @@
+/**
+ * @file
+ * 	Host stand-in for the Contiki clock. Time is the simulated time of the mote currently running.
+ */
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#ifdef CLOCK_CONF_SECOND
+	#define CLOCK_SECOND CLOCK_CONF_SECOND
+#else
+	#define CLOCK_SECOND 128
+#endif
+
+#if SIM_CLOCK_BITS == 16
+	typedef unsigned short clock_time_t; //As on MSP430 motes. Wraps every 512 s at 128 ticks a second
+#else
+	typedef unsigned long clock_time_t;
+#endif
+
+/**
+ * @brief Current simulated time in clock ticks
+ */
+clock_time_t
+clock_time(void);
+
+/**
+ * @brief Current simulated time in seconds
+ */
+unsigned long
+clock_seconds(void);
+
+#endif /* __CLOCK_H__ */
@@ -0,0 +1,39 @@
+/**
+ * @file
+ * 	Host stand-in for Contiki callback timers. Timers are events in the simulator queue.
+ */
+#ifndef __CTIMER_H__
+#define __CTIMER_H__
+
+#include "sys/clock.h"
+
+/**
+ * @brief Callback timer
+ * @details The id is the simulator event currently armed for the timer, 0 when
+ *          the timer is expired or stopped. Stale queue entries are detected by
+ *          comparing ids so stopping and memset() of the owner are safe.
+ */
+struct ctimer{
+	clock_time_t start;
+	clock_time_t interval;
+	void (*f)(void *);
+	void *ptr;
+	unsigned long id;
+};
+
+void
+ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr);
+
+void
+ctimer_reset(struct ctimer *c);
+
+void
+ctimer_restart(struct ctimer *c);
+
+void
+ctimer_stop(struct ctimer *c);
+
+int
+ctimer_expired(struct ctimer *c);
+
+#endif /* __CTIMER_H__ */
@@ -0,0 +1,112 @@
+/**
+ * @file
+ * 	Host decoder for the GROOT binary trace.
+ * @details
+ * 	Reads the frames groot-sim -x writes: node address (2 bytes), record count (1 byte)
+ * 	and that many GROOT_TRACE_RECORD as they are in the mote's memory. With -s it reads
+ * 	a serial log instead, where groot_trace_write() puts the same frames in hex on
+ * 	TRACE lines between the mote's other output. Prints a line per record.
+ */
+
+#include "contiki.h"
+#include "groot.h"
+#include <stdlib.h>
+#include <string.h>
+
+#undef printf
+
+static const char *
+event_name(uint8_t event){
+	switch(event){
+		case GROOT_TRACE_RCV:
+			return "RCV";
+		case GROOT_TRACE_SAMPLE:
+			return "SAMPLE";
+		case GROOT_TRACE_SEND:
+			return "SEND";
+		case GROOT_TRACE_HOLD:
+			return "HOLD";
+		case GROOT_TRACE_PUBLISH:
+			return "PUBLISH";
+		case GROOT_TRACE_REBROADCAST:
+			return "REBROADCAST";
+		case GROOT_TRACE_RESULT:
+			return "RESULT";
+		case GROOT_TRACE_PARENT_LOST:
+			return "PARENT_LOST";
+	}
+	return "UNKNOWN";
+}
+
+/**
+ * @brief Turn the TRACE lines of a serial log into binary frames
+ * @return stream of the frames, NULL on error
+ */
+static FILE *
+serial_frames(FILE *in){
+	FILE *out = tmpfile();
+	static char line[2*(3 + GROOT_TRACE_LENGTH*sizeof(struct GROOT_TRACE_RECORD)) + 64];
+	char *at;
+	unsigned int byte;
+
+	if(out == NULL){
+		return NULL;
+	}
+	while(fgets(line, sizeof(line), in) != NULL){
+		if((at = strstr(line, "TRACE ")) == NULL){
+			continue;
+		}
+		for(at += 6; sscanf(at, "%2x", &byte) == 1; at += 2){
+			fputc(byte, out);
+		}
+	}
+	rewind(out);
+	return out;
+}
+
+int
+main(int argc, char **argv){
+	struct GROOT_TRACE_RECORD record;
+	rimeaddr_t node;
+	uint8_t count, i;
+	FILE *in = stdin, *serial;
+	const char *name = argv[0];
+	uint8_t is_serial = 0;
+
+	if(argc > 1 && strcmp(argv[1], "-s") == 0){
+		is_serial = 1;
+		argc -= 1;
+		argv += 1;
+	}
+	if(argc > 1 && (in = fopen(argv[1], is_serial ? "r" : "rb")) == NULL){
+		fprintf(stderr, "Usage: %s [-s] [trace file]\n", name);
+		return 1;
+	}
+	if(is_serial){
+		serial = serial_frames(in);
+		if(in != stdin){
+			fclose(in);
+		}
+		if((in = serial) == NULL){
+			fprintf(stderr, "No room for the frames\n");
+			return 1;
+		}
+	}
+
+	while(fread(&node, sizeof(rimeaddr_t), 1, in) == 1 && fread(&count, 1, 1, in) == 1){
+		for(i = 0; i < count; i++){
+			if(fread(&record, sizeof(struct GROOT_TRACE_RECORD), 1, in) != 1){
+				fprintf(stderr, "Truncated frame from %d.%d\n", node.u8[0], node.u8[1]);
+				return 1;
+			}
+			printf("%lu %d.%d %s qid=%u a=%d.%d b=%d.%d arg=%u\n", (unsigned long)record.timestamp,
+				node.u8[0], node.u8[1], event_name(record.event), record.query_id, record.a.u8[0], record.a.u8[1],
+				record.b.u8[0], record.b.u8[1], record.arg);
+		}
+	}
+
+	if(in != stdin){
+		fclose(in);
+	}
+	return 0;
+}